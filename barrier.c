@@ -0,0 +1,79 @@
+/*
+ * Spin-then-block barrier used for the rounds of every engine and for
+ * handing work to the worker pool. A thread arriving at the barrier spins
+ * on the generation counter for a while, which is all it takes when the
+ * threads are busy with the same rounds; a thread still waiting after
+ * GOL_BARRIER_SPINS checks goes to sleep on a condition variable, so an
+ * idle worker pool does not burn CPU.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <sched.h>
+#include "gol.h"
+
+#define GOL_BARRIER_SPINS (4000) // checks of the generation before sleeping
+
+/* initialize a barrier
+ * b: the barrier
+ * count: the number of threads that meet at it
+ * returns: 0 on success, 1 on error
+ */
+int gol_barrier_init(struct gol_barrier *b, int count){
+    if (count < 1){
+        return 1;
+    }
+    b->count = count;
+    b->waiting = 0;
+    b->generation = 0;
+    if (pthread_mutex_init(&b->lock, NULL) != 0){
+        return 1;
+    }
+    if (pthread_cond_init(&b->wake, NULL) != 0){
+        return 1;
+    }
+    return 0;
+}
+
+/* wait until count threads have arrived
+ * b: the barrier
+ * returns: PTHREAD_BARRIER_SERIAL_THREAD for the last thread to arrive,
+ *          0 for the others
+ */
+int gol_barrier_wait(struct gol_barrier *b){
+    unsigned gen = __atomic_load_n(&b->generation, __ATOMIC_ACQUIRE);
+    int i;
+
+    if (__atomic_add_fetch(&b->waiting, 1, __ATOMIC_ACQ_REL) == b->count){
+        /* the last one: nobody can arrive for the next generation before
+         * it is published, so resetting the count here is safe */
+        __atomic_store_n(&b->waiting, 0, __ATOMIC_RELAXED);
+        pthread_mutex_lock(&b->lock);
+        __atomic_store_n(&b->generation, gen + 1, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&b->wake);
+        pthread_mutex_unlock(&b->lock);
+        return PTHREAD_BARRIER_SERIAL_THREAD;
+    }
+    for (i = 0; i < GOL_BARRIER_SPINS; ++i){
+        if (__atomic_load_n(&b->generation, __ATOMIC_ACQUIRE) != gen){
+            return 0;
+        }
+        if (i % 64 == 63){
+            sched_yield(); // let a thread sharing this CPU get to the barrier
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    pthread_mutex_lock(&b->lock);
+    while (__atomic_load_n(&b->generation, __ATOMIC_ACQUIRE) == gen){
+        pthread_cond_wait(&b->wake, &b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+    return 0;
+}
+
+/* free the resources of a barrier nobody waits at */
+void gol_barrier_destroy(struct gol_barrier *b){
+    pthread_mutex_destroy(&b->lock);
+    pthread_cond_destroy(&b->wake);
+}
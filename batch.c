@@ -0,0 +1,413 @@
+/*
+ * Batch mode (./gol batch [options] [files]): plays many small boards,
+ * board files or random boards from a range of seeds, and prints one
+ * result line per board as CSV. Starting the worker pool and splitting a
+ * 10x10 board between threads costs more than playing it, so here every
+ * board is played whole by one thread: the threads take the next boards
+ * from a shared counter and never wait for each other.
+ *
+ * With --lanes a thread packs up to 64 consecutive boards of the same size
+ * and number of rounds into the bits of one board of 64-bit words and
+ * plays them together with the bit-sliced adders of the bits engine (see
+ * step_lanes), one word operation for the same cell of all of them. The
+ * time of a pack is split evenly over its boards.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "gol.h"
+
+#define BATCH_LANES (64) // boards in one pack of --lanes
+#define BATCH_SIZE (10)   // rows and columns of the random boards without --size
+#define BATCH_ROUNDS (100) // rounds of the random boards without --rounds
+
+struct batch_config{
+    int threads;
+    int lanes;           // 1: pack boards of the same size into the lanes of words
+    int rounds;          // --rounds (-1: as each board file says)
+    int rows;            // --size (0: the pattern's size)
+    int cols;
+    int boundary;
+    const char *rule_arg;
+    struct gol_rule rule;
+    /* the random boards of --seeds (and --size, --random, --rounds) */
+    int use_seeds;
+    unsigned long seed_first;
+    double density;
+    char **files;        // or the board files
+    long count;          // boards in the batch
+};
+
+/* what is printed for a board */
+struct batch_result{
+    int error;           // 1: the board could not be loaded
+    int rows;
+    int cols;
+    int rounds;          // the rounds played
+    long live;           // live cells after the last round
+    double seconds;      // the time of its rounds (its share of a pack's)
+    int lanes;           // boards played together with it (1: alone)
+};
+
+struct batch_pool{
+    struct batch_config *cfg;
+    struct batch_result *results;
+    long next;           // the next board nobody has taken (atomic)
+};
+
+/****************** Function Prototypes **********************/
+/* parse the batch options and the board files */
+static int parse_batch_options(struct batch_config *cfg, int argc, char **argv);
+/* a batch thread: plays boards until there are none left */
+static void *batch_worker(void *arg);
+/* read or generate board i of the batch */
+static int load_batch_board(struct batch_config *cfg, long i, struct gol_data *data);
+/* play one board alone with the dense kernels */
+static void play_board(struct gol_data *data, struct batch_result *result);
+/* play boards of the same size together in the lanes of words */
+static void play_lanes(struct batch_config *cfg, struct gol_data *boards, int n,
+                       struct batch_result *results);
+/* free what load_batch_board allocated */
+static void free_batch_board(struct gol_data *data);
+
+static void batch_usage(const char *prog){
+    printf("usage: %s batch [options] [board files]\n", prog);
+    printf("  --threads N  threads playing boards (default: the online CPUs)\n");
+    printf("  --seeds A-B  random boards from seeds A to B instead of files\n");
+    printf("  --size RxC  the random boards, or the board RLE and .cells patterns are put \
+on (default 10x10, the pattern's size)\n");
+    printf("  --random P  fraction of the random boards' cells alive at the start \
+(default 0.3)\n");
+    printf("  --rounds N  rounds of every board (default 100 for random boards, the count \
+in a gol board file; needed for patterns)\n");
+    printf("  --rule B3/S23  the rule of every board (default B3/S23)\n");
+    printf("  --boundary torus|dead  wrap around the board edges (default) or not\n");
+    printf("  --lanes  play up to 64 boards of the same size at once in the bits of words\n");
+}
+
+/* the batch mode entry point
+ * argc, argv: the command line, argv[1] is "batch"
+ * returns: 0 on success, 1 on error
+ */
+int run_batch(int argc, char **argv){
+    struct batch_config cfg;
+    struct batch_pool pool;
+    struct batch_result *res;
+    pthread_t *threads;
+    long i;
+    int j;
+
+    if (parse_batch_options(&cfg, argc, argv) != 0){
+        batch_usage(argv[0]);
+        return 1;
+    }
+
+    pool.cfg = &cfg;
+    pool.next = 0;
+    pool.results = calloc(cfg.count, sizeof(struct batch_result));
+    threads = malloc(sizeof(pthread_t) * cfg.threads);
+    if (pool.results == NULL || threads == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    for (j = 0; j < cfg.threads; ++j){
+        if (pthread_create(&threads[j], NULL, batch_worker, &pool) != 0){
+            perror("Error pthread_create\n");
+            exit(1);
+        }
+    }
+    for (j = 0; j < cfg.threads; ++j){
+        pthread_join(threads[j], NULL);
+    }
+
+    printf("board,rows,cols,rounds,live,seconds,lanes\n");
+    for (i = 0; i < cfg.count; ++i){
+        res = &pool.results[i];
+        if (cfg.use_seeds){
+            printf("%lu,", cfg.seed_first + i);
+        }
+        else{
+            printf("%s,", cfg.files[i]);
+        }
+        if (res->error){
+            printf("error\n");
+            continue;
+        }
+        printf("%d,%d,%d,%ld,%.9f,%d\n", res->rows, res->cols, res->rounds, res->live,
+               res->seconds, res->lanes);
+    }
+    free(pool.results);
+    free(threads);
+    return 0;
+}
+
+static int parse_batch_options(struct batch_config *cfg, int argc, char **argv){
+    static struct option long_options[] = {
+        {"threads", required_argument, NULL, 't'},
+        {"seeds", required_argument, NULL, 's'},
+        {"size", required_argument, NULL, 'z'},
+        {"random", required_argument, NULL, 'd'},
+        {"rounds", required_argument, NULL, 'n'},
+        {"rule", required_argument, NULL, 'u'},
+        {"boundary", required_argument, NULL, 'b'},
+        {"lanes", no_argument, NULL, 'l'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    unsigned long seed_last;
+    char *end;
+    long cpus;
+    int opt;
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg->threads = (cpus > 0) ? cpus : 1;
+    cfg->lanes = 0;
+    cfg->rounds = -1;
+    cfg->boundary = BOUNDARY_TORUS;
+    cfg->rule_arg = NULL;
+    cfg->use_seeds = 0;
+    cfg->seed_first = 0;
+    seed_last = 0;
+    cfg->rows = 0;
+    cfg->cols = 0;
+    cfg->density = 0.3;
+
+    optind = 2; // skip "batch"
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1){
+        switch (opt){
+        case 't':
+            cfg->threads = atoi(optarg);
+            break;
+        case 's':
+            if (sscanf(optarg, "%lu-%lu", &cfg->seed_first, &seed_last) != 2){
+                if (sscanf(optarg, "%lu", &cfg->seed_first) != 1){
+                    printf("Error: invalid seed range (A-B): %s\n", optarg);
+                    return 1;
+                }
+                seed_last = cfg->seed_first;
+            }
+            cfg->use_seeds = 1;
+            break;
+        case 'z':
+            if (sscanf(optarg, "%dx%d", &cfg->rows, &cfg->cols) != 2
+                || cfg->rows < 1 || cfg->cols < 1){
+                printf("Error: invalid board size (rowsxcols): %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'd':
+            cfg->density = atof(optarg);
+            break;
+        case 'n':
+            cfg->rounds = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || cfg->rounds < 0){
+                printf("Error: invalid number of rounds: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'u':
+            cfg->rule_arg = optarg;
+            break;
+        case 'b':
+            if (strcmp(optarg, "torus") == 0){
+                cfg->boundary = BOUNDARY_TORUS;
+            }
+            else if (strcmp(optarg, "dead") == 0){
+                cfg->boundary = BOUNDARY_DEAD;
+            }
+            else{
+                printf("Error: unknown boundary: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'l':
+            cfg->lanes = 1;
+            break;
+        default:
+            return 1;
+        }
+    }
+    cfg->files = argv + optind; // getopt moved the board files to the end
+    cfg->count = argc - optind;
+    if (cfg->use_seeds){
+        if (cfg->count > 0 || seed_last < cfg->seed_first){
+            return 1;
+        }
+        cfg->count = seed_last - cfg->seed_first + 1;
+    }
+    if (cfg->count < 1 || cfg->threads < 1 || cfg->density < 0 || cfg->density > 1){
+        return 1;
+    }
+    if (parse_rule(cfg->rule_arg != NULL ? cfg->rule_arg : "B3/S23", &cfg->rule) != 0){
+        printf("Error: invalid rule (B/S notation, like B36/S23): %s\n", cfg->rule_arg);
+        return 1;
+    }
+    return 0;
+}
+
+static void *batch_worker(void *arg){
+    struct batch_pool *pool = arg;
+    struct batch_config *cfg = pool->cfg;
+    struct gol_data boards[BATCH_LANES];
+    long first, i;
+    int n, k, start, chunk;
+
+    chunk = cfg->lanes ? BATCH_LANES : 1;
+    while ((first = __atomic_fetch_add(&pool->next, chunk, __ATOMIC_RELAXED)) < cfg->count){
+        n = (cfg->count - first < chunk) ? cfg->count - first : chunk;
+        for (k = 0; k < n; ++k){
+            pool->results[first + k].error = load_batch_board(cfg, first + k, &boards[k]);
+        }
+        /* runs of boards that fit into one pack, the others alone */
+        for (start = 0; start < n; start = k){
+            for (k = start + 1; k < n && !pool->results[first + start].error
+                 && !pool->results[first + k].error
+                 && boards[k].rows == boards[start].rows && boards[k].cols == boards[start].cols
+                 && boards[k].iters - boards[k].round == boards[start].iters - boards[start].round; ++k){
+            }
+            if (k - start > 1){
+                play_lanes(cfg, boards + start, k - start, pool->results + first + start);
+            }
+            else if (!pool->results[first + start].error){
+                play_board(&boards[start], &pool->results[first + start]);
+            }
+        }
+        for (i = 0; i < n; ++i){
+            free_batch_board(&boards[i]);
+        }
+    }
+    return NULL;
+}
+
+static int load_batch_board(struct batch_config *cfg, long i, struct gol_data *data){
+    unsigned long long state;
+    int r, c;
+
+    memset(data, 0, sizeof(struct gol_data));
+    data->num_threads = 1;
+    data->engine = ENGINE_DENSE;
+    data->partition = PARTITION_ROWS;
+    data->boundary = cfg->boundary;
+    data->rounds = cfg->rounds;
+    data->pattern_rows = cfg->rows;
+    data->pattern_cols = cfg->cols;
+    data->rule_arg = cfg->rule_arg;
+    data->rule = cfg->rule;
+    init_stencil(data, NULL); // the widest kernel, always there
+    if (cfg->use_seeds){ // the board bench draws for --seed
+        data->rows = (cfg->rows > 0) ? cfg->rows : BATCH_SIZE;
+        data->cols = (cfg->cols > 0) ? cfg->cols : BATCH_SIZE;
+        data->iters = (cfg->rounds >= 0) ? cfg->rounds : BATCH_ROUNDS;
+        alloc_board(data);
+        state = cfg->seed_first + i;
+        for (r = 0; r < data->rows; ++r){
+            for (c = 0; c < data->cols; ++c){
+                if (draw_alive(&state, cfg->density)){
+                    set_cell(data, r, c);
+                }
+            }
+        }
+        finish_board(data);
+    }
+    else if (is_snapshot(cfg->files[i])){
+        if (init_game_data_from_snapshot(data, cfg->files[i]) != 0){
+            return 1;
+        }
+    }
+    else if (init_game_data_from_file(data, cfg->files[i]) != 0){
+        return 1;
+    }
+    data->thread_row_end = data->rows - 1;
+    data->thread_col_end = data->cols - 1;
+    return 0;
+}
+
+static void play_board(struct gol_data *data, struct batch_result *result){
+    long long start;
+    long live;
+    int r, c, changed;
+    uint8_t *temp;
+
+    start = monotonic_ns();
+    live = 0;
+    for (r = 0; r < data->rows; ++r){
+        for (c = 0; c < data->cols; ++c){
+            live += data->world[dense_index(data, r, c)];
+        }
+    }
+    result->rounds = data->iters - data->round;
+    for (; data->round < data->iters; ++data->round){
+        live = 0;
+        for (r = 0; r < data->rows; ++r){
+            live += step_dense_row(data, r, 0, data->cols - 1, &changed);
+        }
+        temp = data->world; // swapping worlds around
+        data->world = data->next_world;
+        data->next_world = temp;
+        refresh_halo(data, 0, data->rows - 1, 0, data->cols - 1);
+    }
+    result->seconds = (monotonic_ns() - start) / 1e9;
+    result->rows = data->rows;
+    result->cols = data->cols;
+    result->live = live;
+    result->lanes = 1;
+}
+
+static void play_lanes(struct batch_config *cfg, struct gol_data *boards, int n,
+                       struct batch_result *results){
+    uint64_t *world, *next, *temp, bits, used;
+    size_t cells = (size_t)boards[0].rows * boards[0].cols, i;
+    long long start;
+    double seconds;
+    int k, r, c, round, rounds = boards[0].iters - boards[0].round;
+
+    world = calloc(cells, sizeof(uint64_t));
+    next = calloc(cells, sizeof(uint64_t));
+    if (world == NULL || next == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    start = monotonic_ns();
+    for (k = 0; k < n; ++k){
+        for (r = 0; r < boards[k].rows; ++r){
+            for (c = 0; c < boards[k].cols; ++c){
+                world[(size_t)r * boards[k].cols + c] |=
+                    (uint64_t)boards[k].world[dense_index(&boards[k], r, c)] << k;
+            }
+        }
+        results[k].live = 0;
+    }
+    for (round = 0; round < rounds; ++round){
+        step_lanes(&cfg->rule, world, next, boards[0].rows, boards[0].cols, cfg->boundary);
+        temp = world;
+        world = next;
+        next = temp;
+    }
+    /* under a B0 rule the lanes of no board come alive too */
+    used = (n == BATCH_LANES) ? ~(uint64_t)0 : ((uint64_t)1 << n) - 1;
+    for (i = 0; i < cells; ++i){
+        for (bits = world[i] & used; bits != 0; bits &= bits - 1){
+            results[__builtin_ctzll(bits)].live++;
+        }
+    }
+    seconds = (monotonic_ns() - start) / 1e9;
+    for (k = 0; k < n; ++k){
+        results[k].seconds = seconds / n;
+        results[k].rows = boards[k].rows;
+        results[k].cols = boards[k].cols;
+        results[k].rounds = rounds;
+        results[k].lanes = n;
+    }
+    free(world);
+    free(next);
+}
+
+static void free_batch_board(struct gol_data *data){
+    free(data->world);
+    free(data->next_world);
+    free(data->live_counts);
+    free(data->population);
+    free(data->round_ns);
+}
@@ -0,0 +1,333 @@
+/*
+ * Bench mode (./gol bench ...): runs a random board of the given size
+ * and density (drawn by the workers of every run, see --random) with
+ * every combination of the given engines, partitions and thread counts
+ * through run_gol, and prints one result line per combination as CSV or
+ * JSON.
+ *
+ * Each combination is run --warmup times untimed and then --reps times.
+ * The times come from the monotonic clock at the end of every round
+ * (see reduce_live), so they leave out reading the board and starting
+ * the threads. Reported per combination: cell updates per second over the
+ * median run, and the median and 95th percentile of the time one round
+ * took across all timed runs. Engines that skip rounds (hashlife,
+ * temporal blocking) spread a jump evenly over the rounds it covers.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include "gol.h"
+
+#define BENCH_MAX_LIST (16) // entries in --engines, --partitions and --threads
+
+struct bench_config{
+    int rows;            // --size
+    int cols;
+    int rounds;
+    double density;      // --random
+    int warmup;
+    int reps;
+    unsigned long seed;
+    int json;
+    const char *engines[BENCH_MAX_LIST];
+    int num_engines;
+    int partitions[BENCH_MAX_LIST];
+    int num_partitions;
+    int threads[BENCH_MAX_LIST];
+    int num_threads;
+    const char *extra; // one more option for every run, e.g. --temporal-depth=4
+};
+
+/****************** Function Prototypes **********************/
+/* parse the bench options */
+static int parse_bench_options(struct bench_config *cfg, int argc, char **argv);
+/* run one combination and print its result line */
+static void bench_one(struct bench_config *cfg, const char *engine,
+                      int partition, int threads, int first);
+
+static void bench_usage(const char *prog){
+    printf("usage: %s bench [options]\n", prog);
+    printf("  --size RxC  board size (default 1024x1024)\n");
+    printf("  --random P  fraction of cells alive at the start (default 0.3)\n");
+    printf("  --rounds N  rounds per run (default 100)\n");
+    printf("  --warmup N  untimed runs before the timed ones (default 1)\n");
+    printf("  --reps N  timed runs (default 5)\n");
+    printf("  --engines LIST  comma separated engines (default dense,bits)\n");
+    printf("  --partitions LIST  comma separated partition flags (default 0)\n");
+    printf("  --threads LIST  comma separated thread counts (default 1)\n");
+    printf("  --seed N  seed of the random board (default 1)\n");
+    printf("  --format csv|json  output format (default csv)\n");
+    printf("  --extra OPTION  pass one more option to every run, e.g. --extra=--boundary=dead\n");
+}
+
+/* the bench mode entry point
+ * argc, argv: the command line, argv[1] is "bench"
+ * returns: 0 on success, 1 on error
+ */
+int run_bench(int argc, char **argv){
+    struct bench_config cfg;
+    int e, p, t, first;
+
+    if (parse_bench_options(&cfg, argc, argv) != 0){
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    if (cfg.json){
+        printf("[\n");
+    }
+    else{
+        printf("engine,partition,threads,rows,cols,density,rounds,reps,seconds_median,"
+               "cell_updates_per_sec,round_median_us,round_p95_us\n");
+    }
+    first = 1;
+    for (e = 0; e < cfg.num_engines; ++e){
+        for (p = 0; p < cfg.num_partitions; ++p){
+            /* only the dense engine steals tiles, only rows for sparse and delta */
+            if (cfg.partitions[p] == PARTITION_STEAL && strcmp(cfg.engines[e], "dense") != 0){
+                continue;
+            }
+            if (cfg.partitions[p] != PARTITION_ROWS && (strcmp(cfg.engines[e], "sparse") == 0
+                                                       || strcmp(cfg.engines[e], "delta") == 0)){
+                continue;
+            }
+            for (t = 0; t < cfg.num_threads; ++t){
+                bench_one(&cfg, cfg.engines[e], cfg.partitions[p], cfg.threads[t], first);
+                first = 0;
+            }
+        }
+    }
+    if (cfg.json){
+        printf("\n]\n");
+    }
+    return 0;
+}
+
+/* split a comma separated list in place
+ * returns: the number of entries, -1 if there are too many */
+static int split_list(char *list, char **out){
+    int n = 0;
+    char *item;
+
+    for (item = strtok(list, ","); item != NULL; item = strtok(NULL, ",")){
+        if (n == BENCH_MAX_LIST){
+            return -1;
+        }
+        out[n++] = item;
+    }
+    return n;
+}
+
+static int parse_bench_options(struct bench_config *cfg, int argc, char **argv){
+    static struct option long_options[] = {
+        {"size", required_argument, NULL, 'z'},
+        {"random", required_argument, NULL, 'd'},
+        {"rounds", required_argument, NULL, 'r'},
+        {"warmup", required_argument, NULL, 'w'},
+        {"reps", required_argument, NULL, 'n'},
+        {"engines", required_argument, NULL, 'e'},
+        {"partitions", required_argument, NULL, 'p'},
+        {"threads", required_argument, NULL, 't'},
+        {"seed", required_argument, NULL, 's'},
+        {"format", required_argument, NULL, 'f'},
+        {"extra", required_argument, NULL, 'x'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    char *items[BENCH_MAX_LIST];
+    int opt, i, n;
+
+    cfg->rows = 1024;
+    cfg->cols = 1024;
+    cfg->rounds = 100;
+    cfg->density = 0.3;
+    cfg->warmup = 1;
+    cfg->reps = 5;
+    cfg->seed = 1;
+    cfg->json = 0;
+    cfg->engines[0] = "dense";
+    cfg->engines[1] = "bits";
+    cfg->num_engines = 2;
+    cfg->partitions[0] = PARTITION_ROWS;
+    cfg->num_partitions = 1;
+    cfg->threads[0] = 1;
+    cfg->num_threads = 1;
+    cfg->extra = NULL;
+
+    optind = 2; // skip "bench"
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1){
+        switch (opt){
+        case 'z':
+            if (sscanf(optarg, "%dx%d", &cfg->rows, &cfg->cols) != 2){
+                printf("Error: invalid board size (rowsxcols): %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'd':
+            cfg->density = atof(optarg);
+            break;
+        case 'r':
+            cfg->rounds = atoi(optarg);
+            break;
+        case 'w':
+            cfg->warmup = atoi(optarg);
+            break;
+        case 'n':
+            cfg->reps = atoi(optarg);
+            break;
+        case 's':
+            cfg->seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'e':
+            n = split_list(optarg, items);
+            if (n <= 0){
+                return 1;
+            }
+            for (i = 0; i < n; ++i){
+                cfg->engines[i] = items[i];
+            }
+            cfg->num_engines = n;
+            break;
+        case 'p':
+        case 't':
+            n = split_list(optarg, items);
+            if (n <= 0){
+                return 1;
+            }
+            for (i = 0; i < n; ++i){
+                if (opt == 'p'){
+                    cfg->partitions[i] = atoi(items[i]);
+                }
+                else{
+                    cfg->threads[i] = atoi(items[i]);
+                }
+            }
+            if (opt == 'p'){
+                cfg->num_partitions = n;
+            }
+            else{
+                cfg->num_threads = n;
+            }
+            break;
+        case 'f':
+            if (strcmp(optarg, "json") == 0){
+                cfg->json = 1;
+            }
+            else if (strcmp(optarg, "csv") != 0){
+                printf("Error: unknown format: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'x':
+            cfg->extra = optarg;
+            break;
+        default:
+            return 1;
+        }
+    }
+    if (optind < argc || cfg->rows < 1 || cfg->cols < 1 || cfg->rounds < 1
+        || cfg->reps < 1 || cfg->warmup < 0 || cfg->density <= 0 || cfg->density > 1){
+        return 1;
+    }
+    for (i = 0; i < cfg->num_threads; ++i){
+        if (cfg->threads[i] < 1){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int compare_doubles(const void *a, const void *b){
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* the value below which a fraction q of the sorted values lie */
+static double percentile(const double *sorted, long n, double q){
+    long i = (long)(q * (n - 1) + 0.5);
+    return sorted[i];
+}
+
+static void bench_one(struct bench_config *cfg, const char *engine,
+                      int partition, int threads, int first){
+    char threads_arg[16], partition_arg[16], engine_arg[64];
+    char random_arg[64], seed_arg[64], size_arg[64], rounds_arg[64];
+    char *args[13];
+    struct gol_run run;
+    double *totals, *rounds, median, updates;
+    long num_rounds, last;
+    int argc, i, r, k;
+
+    snprintf(threads_arg, sizeof(threads_arg), "%d", threads);
+    snprintf(partition_arg, sizeof(partition_arg), "%d", partition);
+    snprintf(engine_arg, sizeof(engine_arg), "--engine=%s", engine);
+    snprintf(random_arg, sizeof(random_arg), "--random=%.17g", cfg->density);
+    snprintf(seed_arg, sizeof(seed_arg), "--seed=%lu", cfg->seed);
+    snprintf(size_arg, sizeof(size_arg), "--size=%dx%d", cfg->rows, cfg->cols);
+    snprintf(rounds_arg, sizeof(rounds_arg), "--rounds=%d", cfg->rounds);
+    argc = 0;
+    args[argc++] = "gol";
+    args[argc++] = "random";
+    args[argc++] = "0";
+    args[argc++] = threads_arg;
+    args[argc++] = partition_arg;
+    args[argc++] = "0";
+    args[argc++] = engine_arg;
+    args[argc++] = random_arg;
+    args[argc++] = seed_arg;
+    args[argc++] = size_arg;
+    args[argc++] = rounds_arg;
+    if (cfg->extra != NULL){
+        args[argc++] = (char *)cfg->extra;
+    }
+    args[argc] = NULL;
+
+    totals = malloc(sizeof(double) * cfg->reps);
+    rounds = malloc(sizeof(double) * cfg->reps * cfg->rounds);
+    if (totals == NULL || rounds == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    num_rounds = 0;
+    for (i = -cfg->warmup; i < cfg->reps; ++i){
+        run_gol(argc, args, &run);
+        if (i >= 0){
+            totals[i] = run.seconds;
+            /* a jump over k rounds counts as k rounds of a k-th of its time */
+            last = 0;
+            for (r = 1; r <= cfg->rounds; ++r){
+                if (run.round_ns[r] == 0){
+                    continue;
+                }
+                for (k = last; k < r; ++k){
+                    rounds[num_rounds++] = (run.round_ns[r] - run.round_ns[last]) / 1e3 / (r - last);
+                }
+                last = r;
+            }
+        }
+        free(run.round_ns);
+    }
+    qsort(totals, cfg->reps, sizeof(double), compare_doubles);
+    qsort(rounds, num_rounds, sizeof(double), compare_doubles);
+    median = percentile(totals, cfg->reps, 0.5);
+    updates = (median > 0) ? (double)cfg->rows * cfg->cols * cfg->rounds / median : 0.0;
+
+    if (cfg->json){
+        printf("%s  {\"engine\": \"%s\", \"partition\": %d, \"threads\": %d, \"rows\": %d, "
+               "\"cols\": %d, \"density\": %g, \"rounds\": %d, \"reps\": %d, "
+               "\"seconds_median\": %.6f, \"cell_updates_per_sec\": %.0f, "
+               "\"round_median_us\": %.3f, \"round_p95_us\": %.3f}",
+               first ? "" : ",\n", engine, partition, threads, cfg->rows, cfg->cols,
+               cfg->density, cfg->rounds, cfg->reps, median, updates,
+               percentile(rounds, num_rounds, 0.5), percentile(rounds, num_rounds, 0.95));
+    }
+    else{
+        printf("%s,%d,%d,%d,%d,%g,%d,%d,%.6f,%.0f,%.3f,%.3f\n", engine, partition, threads,
+               cfg->rows, cfg->cols, cfg->density, cfg->rounds, cfg->reps, median, updates,
+               percentile(rounds, num_rounds, 0.5), percentile(rounds, num_rounds, 0.95));
+    }
+    fflush(stdout);
+    free(totals);
+    free(rounds);
+}
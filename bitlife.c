@@ -0,0 +1,386 @@
+/*
+ * Bit-packed engine: every row of the board is stored as packed 64-bit
+ * words (one bit per cell) and the next generation is computed with
+ * bit-sliced adders, so 64 cells are updated by a handful of word
+ * operations instead of 64 calls to check_alive_cells/set_cell_cond.
+ * Uses the same board boundary, partitioning and barriers as play_gol.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include "gol.h"
+
+/****************** Function Prototypes **********************/
+/* compute one row of the next generation for the words w_start..w_end,
+ * one instance per rule kind */
+static long (*const step_bits_kernels[RULE_KINDS])(struct gol_data *, int, int, int);
+
+/* allocate the two bit-packed boards (all cells dead)
+ * data: pointer to gol_data struct with rows and cols set
+ * returns: 0 on success, 1 on error
+ */
+int init_bits_world(struct gol_data *data){
+    data->words = (data->cols + 63) / 64;
+    data->bits_world = calloc((size_t)data->rows * data->words, sizeof(uint64_t));
+    if (data->bits_world == NULL){
+        return 1;
+    }
+    data->bits_next = calloc((size_t)data->rows * data->words, sizeof(uint64_t));
+    if (data->bits_next == NULL){
+        return 1;
+    }
+    data->bits_zero = calloc(data->words, sizeof(uint64_t));
+    if (data->bits_zero == NULL){
+        return 1;
+    }
+    return 0;
+}
+
+/* set a cell of the current bit-packed board alive
+ * data: pointer to gol_data struct
+ * row: the row of the cell
+ * col: the column of the cell
+ * returns: none
+ */
+void set_bits_cell(struct gol_data *data, int row, int col){
+    data->bits_world[(size_t)row * data->words + col / 64] |= (uint64_t)1 << (col % 64);
+}
+
+/* read a cell of the current bit-packed board
+ * data: pointer to gol_data struct
+ * row: the row of the cell
+ * col: the column of the cell
+ * returns: 1 if the cell is alive, 0 otherwise
+ */
+int get_bits_cell(struct gol_data *data, int row, int col){
+    return (data->bits_world[(size_t)row * data->words + col / 64] >> (col % 64)) & 1;
+}
+
+/* the bit-packed gol main loop, same structure as play_gol: each thread
+ * computes its band of rows (or its band of 64-column words), publishes its
+ * live count for thread 0 to sum and meets the others at the barrier.
+ *   arg: pointer to a struct gol_data initialized with all GOL game state
+ *  returns: nothing--void function
+ */
+void *play_gol_bits(void *arg){
+    struct gol_data *data = ((struct gol_data *)arg);
+    int x, w_start, w_end, row_difference, col_difference, ret1, ret2;
+    long cell;
+    long (*step_row)(struct gol_data *, int, int, int) = step_bits_kernels[data->rule.kind];
+    uint64_t *temp;
+
+    cell = 0;
+    w_start = data->thread_col_start / 64;
+    w_end = data->thread_col_end / 64;
+    row_difference = data->thread_row_end - data->thread_row_start + 1;
+    col_difference = data->thread_col_end - data->thread_col_start + 1;
+    if (data->partition_yes_no == 1 && data->first_batch){ //checks to print partition info
+        printf("tid %d: rows: %d:%d (%d) cols: %d:%d (%d)\n", data->thread_id, data->thread_row_start, data->thread_row_end, row_difference,
+               data->thread_col_start, data->thread_col_end, col_difference);
+    }
+    start_rounds(data);
+    data->first_batch = 0;
+    TRACE_MARK(data, TRACE_START);
+    while (data->round < data->iters){
+        if (data->cycle != NULL){
+            hash_part(data);
+        }
+        for (x = data->thread_row_start; x <= data->thread_row_end; ++x){
+            cell += step_row(data, x, w_start, w_end);
+        }
+        publish_live(data, cell);
+        temp = data->bits_world; // swapping worlds around
+        data->bits_world = data->bits_next;
+        data->bits_next = temp;
+
+        TRACE_MARK(data, TRACE_COMPUTE);
+        ret1 = gol_barrier_wait(&data->sim->barrier);
+        if(ret1 != 0 && ret1 != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("pthread_barrier_wait");
+            exit(1);
+        }
+        TRACE_MARK(data, TRACE_BARRIER);
+        if (data->thread_id == 0){
+            reduce_live(data, 1);
+            if(data->output_mode == OUTPUT_ASCII){
+                render_frame(data);
+            }
+            else if(data->output_mode == OUTPUT_VISI){
+                visi_round(data, 1);
+            }
+            if (data->cycle != NULL){
+                cycle_round(data);
+            }
+            if (data->sim->record != NULL){
+                record_round(data);
+            }
+            if (data->sim->publisher != NULL){
+                share_round(data);
+            }
+            TRACE_MARK(data, TRACE_SERIAL);
+        }
+        ret2 = gol_barrier_wait(&data->sim->barrier);
+        if(ret2 != 0 && ret2 != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("pthread_barrier_wait");
+            exit(1);
+        }
+        TRACE_MARK(data, TRACE_RELEASE);
+        if (data->output_mode == OUTPUT_VISI){
+            visi_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->sim->record != NULL){
+            record_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->sim->publisher != NULL){
+            share_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->cycle != NULL && data->cycle->end >= 0){
+            data->iters = data->cycle->end; // the board repeats, see cycle.c
+        }
+        cell = 0;
+        data->round += 1;
+    }
+    return NULL;
+}
+
+/* next state of 64 cells from their 8 neighbor words. The neighbors are
+ * summed with full adders into a ones bit plus four bits of weight two;
+ * under B3/S23 a cell is alive next round when the weight-two bits hold
+ * exactly one and either the ones bit is set (3) or the cell is alive (2).
+ * The other rules add the weight-two bits up into the four bits of the
+ * count s3..s0 and test those (kind is a constant in every instance, see
+ * step_bits_row).
+ * returns: the next generation word
+ */
+static inline __attribute__((always_inline))
+uint64_t rule_word(int kind, const struct gol_rule *rule,
+                   uint64_t a_w, uint64_t a, uint64_t a_e,
+                   uint64_t b_w, uint64_t b, uint64_t b_e,
+                   uint64_t c_w, uint64_t c, uint64_t c_e){
+    uint64_t t, ones_a, twos_a, ones_b, twos_b, ones_c, twos_c;
+    uint64_t ones, twos_0, t0, t1;
+    uint64_t s0, s1, s2, s3, carry, is_n, next;
+    int n;
+
+    t = a_w ^ a;
+    ones_a = t ^ a_e;
+    twos_a = (a_w & a) | (t & a_e);
+    ones_b = b_w ^ b_e;
+    twos_b = b_w & b_e;
+    t = c_w ^ c;
+    ones_c = t ^ c_e;
+    twos_c = (c_w & c) | (t & c_e);
+
+    t = ones_a ^ ones_b;
+    ones = t ^ ones_c;
+    twos_0 = (ones_a & ones_b) | (t & ones_c);
+
+    t = twos_a ^ twos_b;
+    t0 = t ^ twos_c;
+    t1 = (twos_a & twos_b) | (t & twos_c);
+
+    if (kind == RULE_LIFE){
+        return (t0 ^ twos_0) & ~t1 & (ones | b);
+    }
+    /* the count is ones + 2 * (twos_0 + t0) + 4 * t1 */
+    s0 = ones;
+    s1 = twos_0 ^ t0;
+    carry = twos_0 & t0;
+    s2 = carry ^ t1;
+    s3 = carry & t1;
+    switch (kind){
+    case RULE_HIGHLIFE: // 3, 2 and alive, 6 and dead
+        return (s1 & ~s2 & ~s3 & (s0 | b)) | (~s0 & s1 & s2 & ~b);
+    case RULE_DAYNIGHT: // 3, 6 to 8, 4 and alive
+        return (s0 & s1 & ~s2 & ~s3) | (s2 & s1) | s3 | (~s0 & ~s1 & s2 & b);
+    case RULE_SEEDS: // 2 and dead
+        return ~s0 & s1 & ~s2 & ~s3 & ~b;
+    default:
+        next = 0;
+        for (n = 0; n <= 8; ++n){
+            is_n = ((n & 1) ? s0 : ~s0) & ((n & 2) ? s1 : ~s1)
+                 & ((n & 4) ? s2 : ~s2) & ((n & 8) ? s3 : ~s3);
+            next |= is_n & ((-(uint64_t)((rule->birth >> n) & 1) & ~b)
+                            | (-(uint64_t)((rule->survive >> n) & 1) & b));
+        }
+        return next;
+    }
+}
+
+/* the words west and east of word w of a row: every cell shifted so that
+ * it lines up with its left (west) or right (east) neighbor, wrapping around
+ * the board at column 0 and column cols-1 (or shifting in dead cells there
+ * with BOUNDARY_DEAD).
+ */
+static inline uint64_t west_word(struct gol_data *data, const uint64_t *line, int w){
+    uint64_t carry;
+    if (w > 0){
+        carry = line[w - 1] >> 63;
+    }
+    else if (data->boundary == BOUNDARY_DEAD){
+        carry = 0;
+    }
+    else{
+        carry = (line[data->words - 1] >> ((data->cols - 1) % 64)) & 1;
+    }
+    return (line[w] << 1) | carry;
+}
+
+static inline uint64_t east_word(struct gol_data *data, const uint64_t *line, int w){
+    int tail = data->cols % 64;
+    if (w < data->words - 1){
+        return (line[w] >> 1) | (line[w + 1] << 63);
+    }
+    if (data->boundary == BOUNDARY_DEAD){
+        return line[w] >> 1;
+    }
+    if (tail == 0){
+        return (line[w] >> 1) | (line[0] << 63);
+    }
+    return (line[w] >> 1) | ((line[0] & 1) << (tail - 1));
+}
+
+/* compute one row of bits_next from bits_world for words w_start..w_end
+ * kind: the rule kind this instance is compiled for
+ * data: pointer to gol_data struct
+ * row: the row to compute
+ * w_start: the first word of the row to compute
+ * w_end: the last word of the row to compute
+ * returns: the number of live cells in the computed part of the row
+ */
+static inline __attribute__((always_inline))
+long step_bits_row(int kind, struct gol_data *data, int row, int w_start, int w_end){
+    const uint64_t *up, *mid, *down;
+    uint64_t *out, next, last_mask;
+    int w;
+    long cell;
+
+    up = data->bits_world + (size_t)((row - 1 + data->rows) % data->rows) * data->words;
+    mid = data->bits_world + (size_t)row * data->words;
+    down = data->bits_world + (size_t)((row + 1) % data->rows) * data->words;
+    if (data->boundary == BOUNDARY_DEAD){
+        if (row == 0){
+            up = data->bits_zero;
+        }
+        if (row == data->rows - 1){
+            down = data->bits_zero;
+        }
+    }
+    out = data->bits_next + (size_t)row * data->words;
+    last_mask = (data->cols % 64 == 0) ? ~(uint64_t)0 : ((uint64_t)1 << (data->cols % 64)) - 1;
+    cell = 0;
+
+    for (w = w_start; w <= w_end; ++w){
+        next = rule_word(kind, &data->rule,
+                         west_word(data, up, w), up[w], east_word(data, up, w),
+                         west_word(data, mid, w), mid[w], east_word(data, mid, w),
+                         west_word(data, down, w), down[w], east_word(data, down, w));
+        if (w == data->words - 1){
+            next &= last_mask; // keep the padding past the last column dead
+        }
+        out[w] = next;
+        cell += __builtin_popcountll(next);
+    }
+    return cell;
+}
+
+/* step_bits_row compiled for every rule kind, in RULE_* order */
+static long step_bits_table(struct gol_data *data, int row, int w_start, int w_end){
+    return step_bits_row(RULE_TABLE, data, row, w_start, w_end);
+}
+static long step_bits_life(struct gol_data *data, int row, int w_start, int w_end){
+    return step_bits_row(RULE_LIFE, data, row, w_start, w_end);
+}
+static long step_bits_highlife(struct gol_data *data, int row, int w_start, int w_end){
+    return step_bits_row(RULE_HIGHLIFE, data, row, w_start, w_end);
+}
+static long step_bits_daynight(struct gol_data *data, int row, int w_start, int w_end){
+    return step_bits_row(RULE_DAYNIGHT, data, row, w_start, w_end);
+}
+static long step_bits_seeds(struct gol_data *data, int row, int w_start, int w_end){
+    return step_bits_row(RULE_SEEDS, data, row, w_start, w_end);
+}
+static long (*const step_bits_kernels[RULE_KINDS])(struct gol_data *, int, int, int) = {
+    step_bits_table, step_bits_life, step_bits_highlife, step_bits_daynight, step_bits_seeds
+};
+
+/* one round of up to 64 boards of the same size in the bits of one
+ * board of words (the lanes of the batch mode): bit k of
+ * cells[r * cols + c] is cell r, c of board k, so the neighbors of 64
+ * cells are whole words and only the boundary needs care
+ * kind: the rule kind this instance is compiled for
+ * rule: the rule
+ * world: the boards this round
+ * next: the boards next round
+ * rows, cols: the size of every board
+ * boundary: BOUNDARY_TORUS or BOUNDARY_DEAD
+ * returns: none
+ */
+static inline __attribute__((always_inline))
+void step_lanes_kind(int kind, const struct gol_rule *rule, const uint64_t *world,
+                     uint64_t *next, int rows, int cols, int boundary){
+    const uint64_t *up, *mid, *down;
+    uint64_t m_up, m_down, m_w, m_e;
+    int r, c, w, e;
+
+    for (r = 0; r < rows; ++r){
+        up = world + (size_t)((r == 0) ? rows - 1 : r - 1) * cols;
+        mid = world + (size_t)r * cols;
+        down = world + (size_t)((r == rows - 1) ? 0 : r + 1) * cols;
+        m_up = (boundary == BOUNDARY_DEAD && r == 0) ? 0 : ~(uint64_t)0;
+        m_down = (boundary == BOUNDARY_DEAD && r == rows - 1) ? 0 : ~(uint64_t)0;
+        for (c = 0; c < cols; ++c){
+            w = (c == 0) ? cols - 1 : c - 1;
+            e = (c == cols - 1) ? 0 : c + 1;
+            m_w = (boundary == BOUNDARY_DEAD && c == 0) ? 0 : ~(uint64_t)0;
+            m_e = (boundary == BOUNDARY_DEAD && c == cols - 1) ? 0 : ~(uint64_t)0;
+            next[(size_t)r * cols + c] = rule_word(kind, rule,
+                up[w] & m_up & m_w, up[c] & m_up, up[e] & m_up & m_e,
+                mid[w] & m_w, mid[c], mid[e] & m_e,
+                down[w] & m_down & m_w, down[c] & m_down, down[e] & m_down & m_e);
+        }
+    }
+}
+
+/* step_lanes_kind compiled for every rule kind, in RULE_* order */
+static void step_lanes_table(const struct gol_rule *rule, const uint64_t *world,
+                             uint64_t *next, int rows, int cols, int boundary){
+    step_lanes_kind(RULE_TABLE, rule, world, next, rows, cols, boundary);
+}
+static void step_lanes_life(const struct gol_rule *rule, const uint64_t *world,
+                            uint64_t *next, int rows, int cols, int boundary){
+    step_lanes_kind(RULE_LIFE, rule, world, next, rows, cols, boundary);
+}
+static void step_lanes_highlife(const struct gol_rule *rule, const uint64_t *world,
+                                uint64_t *next, int rows, int cols, int boundary){
+    step_lanes_kind(RULE_HIGHLIFE, rule, world, next, rows, cols, boundary);
+}
+static void step_lanes_daynight(const struct gol_rule *rule, const uint64_t *world,
+                                uint64_t *next, int rows, int cols, int boundary){
+    step_lanes_kind(RULE_DAYNIGHT, rule, world, next, rows, cols, boundary);
+}
+static void step_lanes_seeds(const struct gol_rule *rule, const uint64_t *world,
+                             uint64_t *next, int rows, int cols, int boundary){
+    step_lanes_kind(RULE_SEEDS, rule, world, next, rows, cols, boundary);
+}
+static void (*const step_lanes_kernels[RULE_KINDS])(const struct gol_rule *, const uint64_t *,
+                                                    uint64_t *, int, int, int) = {
+    step_lanes_table, step_lanes_life, step_lanes_highlife, step_lanes_daynight, step_lanes_seeds
+};
+
+/* one round of up to 64 boards packed into lanes (see step_lanes_kind)
+ * rule: the rule of every board
+ * world: the boards this round, rows * cols words
+ * next: the boards next round
+ * rows, cols: the size of every board
+ * boundary: BOUNDARY_TORUS or BOUNDARY_DEAD
+ * returns: none
+ */
+void step_lanes(const struct gol_rule *rule, const uint64_t *world, uint64_t *next,
+                int rows, int cols, int boundary){
+    step_lanes_kernels[rule->kind](rule, world, next, rows, cols, boundary);
+}
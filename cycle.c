@@ -0,0 +1,199 @@
+/*
+ * Still lifes and oscillators (--cycles P): stop a run early once the
+ * board repeats with a period of at most P rounds. At the top of every
+ * round each thread hashes its own part of the current board (which
+ * nobody writes while the next one is computed) into its live count slot;
+ * between the barriers thread 0 adds the parts up into the hash of the
+ * board and looks for it among the hashes of the P rounds before.
+ *
+ * When round t repeats round t - p, every later board repeats with period
+ * p, so the workers only play on to the next round that is as far from
+ * the end of the run as a multiple of p: that board is the one the run
+ * would have ended on. gol_wait fills in the population of the rounds
+ * left out (with --population). A board is matched by a 64-bit hash alone, so a collision
+ * (about one in 2^64 per round compared) would stop a run wrongly.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "gol.h"
+
+/****************** Function Prototypes **********************/
+/* scramble the bits of a 64-bit value (the splitmix64 finalizer) */
+static uint64_t mix64(uint64_t x);
+
+/* allocate the hashes of the rounds --cycles looks back at
+ * data: pointer to gol_data struct, with the options parsed
+ * returns: 0 on success, 1 on error
+ */
+int init_cycle(struct gol_data *data){
+    data->cycle = calloc(1, sizeof(struct gol_cycle));
+    if (data->cycle == NULL){
+        printf("Error: malloc failed\n");
+        return 1;
+    }
+    data->cycle->hashes = malloc(sizeof(uint64_t) * (data->cycle_max + 1));
+    data->cycle->rounds = malloc(sizeof(long) * (data->cycle_max + 1));
+    if (data->cycle->hashes == NULL || data->cycle->rounds == NULL){
+        printf("Error: malloc failed\n");
+        free_cycle(data);
+        return 1;
+    }
+    clear_cycle(data);
+    return 0;
+}
+
+/* forget the rounds seen so far (a new board was loaded)
+ * data: pointer to gol_data struct
+ * returns: none
+ */
+void clear_cycle(struct gol_data *data){
+    int i;
+
+    if (data->cycle == NULL){
+        return;
+    }
+    for (i = 0; i <= data->cycle_max; ++i){
+        data->cycle->rounds[i] = -1;
+    }
+    data->cycle->period = 0;
+    data->cycle->found = -1;
+    data->cycle->end = -1;
+    data->cycle->skipped = 0;
+}
+
+/* free the hashes
+ * data: pointer to gol_data struct
+ * returns: none
+ */
+void free_cycle(struct gol_data *data){
+    if (data->cycle == NULL){
+        return;
+    }
+    free(data->cycle->hashes);
+    free(data->cycle->rounds);
+    free(data->cycle);
+    data->cycle = NULL;
+}
+
+/* hash n words, keyed by where they are on the board
+ * words: the words
+ * n: how many
+ * key: the position of the first word (different for every part)
+ * returns: the hash
+ */
+uint64_t hash_words(const uint64_t *words, long n, uint64_t key){
+    uint64_t h = mix64(key);
+    long i;
+
+    for (i = 0; i < n; ++i){
+        h = (h ^ words[i]) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 32;
+    }
+    return mix64(h);
+}
+
+/* every worker, at the top of a round: hash its part of the current board
+ * into its live count slot (the hash of the board is the sum of the parts)
+ * data: the worker's struct gol_data
+ * returns: none
+ */
+void hash_part(struct gol_data *data){
+    const uint8_t *row;
+    uint64_t sum = 0, word, h;
+    int r, c, len;
+
+    if (data->engine == ENGINE_SPARSE){
+        sum = hash_sparse_band(data);
+    }
+    else if (data->engine == ENGINE_BITS){
+        for (r = data->thread_row_start; r <= data->thread_row_end; ++r){
+            sum += hash_words(data->bits_world + (size_t)r * data->words + data->thread_col_start / 64,
+                              data->thread_col_end / 64 - data->thread_col_start / 64 + 1,
+                              ((uint64_t)r << 32) | data->thread_col_start);
+        }
+    }
+    else{
+        len = data->thread_col_end - data->thread_col_start + 1;
+        for (r = data->thread_row_start; r <= data->thread_row_end; ++r){
+            row = data->world + dense_index(data, r, data->thread_col_start);
+            h = mix64(((uint64_t)r << 32) | data->thread_col_start);
+            for (c = 0; c + 8 <= len; c += 8){ // the dense rows are not aligned to words
+                memcpy(&word, row + c, sizeof(word));
+                h = (h ^ word) * 0x9e3779b97f4a7c15ULL;
+                h ^= h >> 32;
+            }
+            for (; c < len; ++c){
+                h = (h ^ row[c]) * 0x9e3779b97f4a7c15ULL;
+            }
+            sum += mix64(h);
+        }
+    }
+    data->live_counts[data->thread_id].hash = sum;
+}
+
+/* thread 0, between the barriers of a round: add up the hash of the board
+ * the round started from and look for it among the rounds before; on a
+ * repeat set the round the workers stop at
+ * data: thread 0's struct gol_data (data->round the round being played)
+ * returns: none
+ */
+void cycle_round(struct gol_data *data){
+    struct gol_cycle *cycle = data->cycle;
+    uint64_t hash = 0;
+    long end;
+    int i, p, slot;
+
+    for (i = 0; i < data->num_threads; ++i){
+        hash += data->live_counts[i].hash;
+    }
+    if (cycle->end < 0){
+        for (p = 1; p <= data->cycle_max && p <= data->round; ++p){
+            slot = (data->round - p) % (data->cycle_max + 1);
+            if (cycle->rounds[slot] == data->round - p && cycle->hashes[slot] == hash){
+                /* the round just computed is round + 1, the run is to end
+                 * on a board as many periods on */
+                end = data->round + 1 + (data->iters - data->round - 1) % p;
+                cycle->period = p;
+                cycle->found = data->round;
+                cycle->end = end;
+                break;
+            }
+        }
+    }
+    slot = data->round % (data->cycle_max + 1);
+    cycle->hashes[slot] = hash;
+    cycle->rounds[slot] = data->round;
+}
+
+/* after a batch cut short by a cycle: the population of the rounds left
+ * out repeats the period before them, and the batch ends when its last
+ * played round did (the rounds in between are marked skipped)
+ * sim: the simulation, the workers done with the batch
+ * returns: none
+ */
+void finish_cycle(struct gol_sim *sim){
+    struct gol_data *data = &sim->data;
+    long end = sim->threads[0].round, i;
+
+    if (data->cycle == NULL || end >= data->iters){
+        return;
+    }
+    for (i = end; i < data->iters && data->population != NULL; ++i){
+        data->population[i] = data->population[i - data->cycle->period];
+        data->round_ns[i + 1] = 0;
+    }
+    if (data->round_ns != NULL){
+        data->round_ns[data->iters] = data->round_ns[end];
+    }
+    data->cycle->skipped += data->iters - end;
+}
+
+static uint64_t mix64(uint64_t x){
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
@@ -0,0 +1,423 @@
+/*
+ * Delta engine: a cell only changes when a cell of its 3x3 neighborhood
+ * changed the round before, so a round only visits the neighborhoods of
+ * the cells that flipped, and costs as much as the board's activity
+ * instead of its area. The board is the dense one (world, one byte per
+ * cell), but a byte holds 2 * live neighbors + 1 if the cell is alive,
+ * kept up to date as cells flip, so deciding a cell is one rule lookup.
+ *
+ * Every thread owns a band of rows and only ever writes the bytes of its
+ * band. A round of a band: add the flips the neighboring bands made on
+ * their edge rows last round into the counts of its cells next to them,
+ * then visit the cells around its own flips and the neighbors' edge flips
+ * (each once, a mark bit), flip the ones the rule says, and add its new
+ * flips into the counts of its own cells around them. The flips on the
+ * band's first and last row go into an edge list too, for the neighbors
+ * to add in the next round. Each band has two of each list, for even and
+ * odd rounds, so a thread writes the next round's while the others still
+ * read the current one.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "gol.h"
+
+#define DELTA_ALIVE (0x01) // the cell is alive, the rest of the byte 2 * live neighbors
+#define DELTA_MARK (0x80)  // the cell was visited this round
+
+struct delta_cell{
+    int row;
+    int col;
+    int born;           // 1: the cell came alive, 0: it died
+};
+
+struct delta_list{
+    struct delta_cell *cells;
+    long count;
+    long cap;
+};
+
+struct delta_band{
+    int row_start;      // the rows of the board this band holds
+    int row_end;
+    struct delta_list flips[2]; // the cells that flipped, by parity of the round
+    struct delta_list edge[2];  // the flips on row_start and row_end
+    struct delta_list visit;    // the cells marked this round
+    long live;          // live cells in the band
+    char pad[64];       // keep neighboring bands on separate cache lines
+};
+
+/****************** Function Prototypes **********************/
+/* a neighbor of a cell on the board: wraps it around the torus
+ * returns: 0 when it is off a dead-boundary board */
+static inline int wrap_cell(struct gol_data *data, int *row, int *col);
+/* add a cell to a list, growing it as needed */
+static void push_cell(struct delta_list *list, int row, int col, int born);
+/* the band holding a row of the board, NULL when the row is not on it */
+static struct delta_band *row_band(struct gol_data *data, int row);
+/* the other bands next to a band (NULL when there is none) */
+static void next_bands(struct gol_data *data, struct delta_band *band,
+                       struct delta_band **above, struct delta_band **below);
+/* add flips into the counts of the cells around them that lie in a band */
+static void count_flips(struct gol_data *data, struct delta_band *band,
+                        const struct delta_list *flips);
+/* mark the cells around flips that lie in a band and are not marked yet */
+static void visit_flips(struct gol_data *data, struct delta_band *band,
+                        const struct delta_list *flips);
+
+/* allocate one (empty) band per thread
+ * data: pointer to gol_data struct with num_threads set
+ * returns: 0 on success, 1 on error
+ */
+int init_delta(struct gol_data *data){
+    data->deltas = calloc(data->num_threads, sizeof(struct delta_band));
+    if (data->deltas == NULL){
+        return 1;
+    }
+    data->delta_now = 0;
+    return 0;
+}
+
+/* free the bands */
+void free_delta(struct gol_data *data){
+    int i, p;
+    for (i = 0; i < data->num_threads; ++i){
+        for (p = 0; p < 2; ++p){
+            free(data->deltas[i].flips[p].cells);
+            free(data->deltas[i].edge[p].cells);
+        }
+        free(data->deltas[i].visit.cells);
+    }
+    free(data->deltas);
+}
+
+/* fill in the neighbor counts of a board whose live cells are set (as 1)
+ * data: pointer to gol_data struct with the board filled in
+ * returns: none
+ */
+void count_delta_board(struct gol_data *data){
+    int row, col, dy, dx, y, x;
+
+    for (row = 0; row < data->rows; ++row){
+        for (col = 0; col < data->cols; ++col){
+            if (!(data->world[dense_index(data, row, col)] & DELTA_ALIVE)){
+                continue;
+            }
+            for (dy = -1; dy <= 1; ++dy){
+                for (dx = -1; dx <= 1; ++dx){
+                    y = row + dy;
+                    x = col + dx;
+                    if ((dy == 0 && dx == 0) || !wrap_cell(data, &y, &x)){
+                        continue;
+                    }
+                    data->world[dense_index(data, y, x)] += 2;
+                }
+            }
+        }
+    }
+}
+
+static void push_cell(struct delta_list *list, int row, int col, int born){
+    struct delta_cell *cells;
+    long cap;
+
+    if (list->count == list->cap){
+        cap = list->cap ? list->cap * 2 : 1024;
+        cells = realloc(list->cells, sizeof(struct delta_cell) * cap);
+        if (cells == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+        list->cells = cells;
+        list->cap = cap;
+    }
+    list->cells[list->count].row = row;
+    list->cells[list->count].col = col;
+    list->cells[list->count].born = born;
+    list->count++;
+}
+
+static struct delta_band *row_band(struct gol_data *data, int row){
+    int t;
+
+    if (data->boundary == BOUNDARY_TORUS){
+        row = (row + data->rows) % data->rows;
+    }
+    for (t = 0; t < data->num_threads; ++t){
+        if (row >= data->deltas[t].row_start && row <= data->deltas[t].row_end){
+            return &data->deltas[t];
+        }
+    }
+    return NULL;
+}
+
+static void next_bands(struct gol_data *data, struct delta_band *band,
+                       struct delta_band **above, struct delta_band **below){
+    *above = NULL;
+    *below = NULL;
+    if (band->row_start > 0 || data->boundary == BOUNDARY_TORUS){
+        *above = row_band(data, band->row_start - 1);
+    }
+    if (band->row_end < data->rows - 1 || data->boundary == BOUNDARY_TORUS){
+        *below = row_band(data, band->row_end + 1);
+    }
+    if (*above == band){
+        *above = NULL;
+    }
+    if (*below == band || *below == *above){ // a board of one or two bands wraps onto it
+        *below = NULL;
+    }
+}
+
+static inline int wrap_cell(struct gol_data *data, int *row, int *col){
+    if (*row < 0 || *row >= data->rows || *col < 0 || *col >= data->cols){
+        if (data->boundary == BOUNDARY_DEAD){
+            return 0;
+        }
+        *row = (*row < 0) ? *row + data->rows : (*row >= data->rows) ? *row - data->rows : *row;
+        *col = (*col < 0) ? *col + data->cols : (*col >= data->cols) ? *col - data->cols : *col;
+    }
+    return 1;
+}
+
+static void count_flips(struct gol_data *data, struct delta_band *band,
+                        const struct delta_list *flips){
+    const struct delta_cell *cell;
+    uint8_t diff;
+    long i;
+    int dy, dx, y, x;
+
+    for (i = 0; i < flips->count; ++i){
+        cell = &flips->cells[i];
+        diff = cell->born ? 2 : (uint8_t)-2;
+        for (dy = -1; dy <= 1; ++dy){
+            for (dx = -1; dx <= 1; ++dx){
+                y = cell->row + dy;
+                x = cell->col + dx;
+                if ((dy == 0 && dx == 0) || !wrap_cell(data, &y, &x)
+                    || y < band->row_start || y > band->row_end){
+                    continue;
+                }
+                data->world[dense_index(data, y, x)] += diff;
+            }
+        }
+    }
+}
+
+static void visit_flips(struct gol_data *data, struct delta_band *band,
+                        const struct delta_list *flips){
+    const struct delta_cell *cell;
+    uint8_t *byte;
+    long i;
+    int dy, dx, y, x;
+
+    for (i = 0; i < flips->count; ++i){
+        cell = &flips->cells[i];
+        for (dy = -1; dy <= 1; ++dy){
+            for (dx = -1; dx <= 1; ++dx){
+                y = cell->row + dy;
+                x = cell->col + dx;
+                if (!wrap_cell(data, &y, &x) || y < band->row_start || y > band->row_end){
+                    continue;
+                }
+                byte = &data->world[dense_index(data, y, x)];
+                if (!(*byte & DELTA_MARK)){
+                    *byte |= DELTA_MARK;
+                    push_cell(&band->visit, y, x, 0);
+                }
+            }
+        }
+    }
+}
+
+/* take in the neighbors' edge flips of the last round: after this the
+ * bytes of the calling thread's band hold the counts of the current board
+ * data: pointer to gol_data struct of the calling thread
+ * returns: none
+ */
+static void settle_band(struct gol_data *data){
+    struct delta_band *band = &data->deltas[data->thread_id];
+    struct delta_band *above, *below;
+
+    if (band->row_start > band->row_end){
+        return;
+    }
+    next_bands(data, band, &above, &below);
+    if (above != NULL){
+        count_flips(data, band, &above->edge[data->delta_now]);
+    }
+    if (below != NULL){
+        count_flips(data, band, &below->edge[data->delta_now]);
+    }
+}
+
+/* compute one round of the calling thread's band, its counts settled
+ * data: pointer to gol_data struct of the calling thread
+ * returns: the number of live cells in the band after this round
+ */
+static long step_delta_band(struct gol_data *data){
+    struct delta_band *band = &data->deltas[data->thread_id];
+    struct delta_band *above, *below;
+    int now = data->delta_now, next = now ^ 1;
+    const struct delta_cell *cell;
+    uint8_t *byte;
+    uint32_t rule;
+    long i;
+    int k, alive;
+
+    band->flips[next].count = 0;
+    band->edge[next].count = 0;
+    band->visit.count = 0;
+    if (band->row_start > band->row_end){
+        return 0;
+    }
+
+    /* only the cells around last round's flips can change */
+    next_bands(data, band, &above, &below);
+    visit_flips(data, band, &band->flips[now]);
+    if (above != NULL){
+        visit_flips(data, band, &above->edge[now]);
+    }
+    if (below != NULL){
+        visit_flips(data, band, &below->edge[now]);
+    }
+
+    /* the rule as one bit per byte value, 2 * neighbors + alive (see
+     * sparse.c); a dead cell with no live neighbor is never visited, which
+     * check_rule makes sure is right (no B0) */
+    rule = 0;
+    for (k = 0; k <= 8; ++k){
+        rule |= (uint32_t)data->rule.next[0][k] << (2 * k);
+        rule |= (uint32_t)data->rule.next[1][k] << (2 * k + 1);
+    }
+    for (i = 0; i < band->visit.count; ++i){
+        cell = &band->visit.cells[i];
+        byte = &data->world[dense_index(data, cell->row, cell->col)];
+        *byte &= ~DELTA_MARK;
+        alive = (rule >> *byte) & 1;
+        if (alive != (*byte & DELTA_ALIVE)){
+            *byte ^= DELTA_ALIVE;
+            band->live += alive ? 1 : -1;
+            push_cell(&band->flips[next], cell->row, cell->col, alive);
+            if (cell->row == band->row_start || cell->row == band->row_end){
+                push_cell(&band->edge[next], cell->row, cell->col, alive);
+            }
+        }
+    }
+    count_flips(data, band, &band->flips[next]);
+    return band->live;
+}
+
+/* the delta gol main loop, same structure as play_gol: each thread
+ * computes its band of rows, publishes its live count for thread 0 to sum and
+ * meets the others at the barrier.
+ *   arg: pointer to a struct gol_data initialized with all GOL game state
+ *  returns: nothing--void function
+ */
+void *play_gol_delta(void *arg){
+    struct gol_data *data = ((struct gol_data *)arg);
+    struct delta_band *band = &data->deltas[data->thread_id];
+    int row_difference, col_difference, ret1, ret2, row, col, settled;
+    long cell;
+
+    row_difference = data->thread_row_end - data->thread_row_start + 1;
+    col_difference = data->thread_col_end - data->thread_col_start + 1;
+    if (data->partition_yes_no == 1 && data->first_batch){ //checks to print partition info
+        printf("tid %d: rows: %d:%d (%d) cols: %d:%d (%d)\n", data->thread_id, data->thread_row_start, data->thread_row_end, row_difference,
+               data->thread_col_start, data->thread_col_end, col_difference);
+    }
+
+    /* the first round after a load visits the cells around every live
+     * cell: they go in as the band's flips, already counted (later
+     * batches of rounds go on from the lists of the last round) */
+    settled = data->first_batch;
+    if (data->first_batch){
+        band->row_start = data->thread_row_start;
+        band->row_end = data->thread_row_end;
+        band->live = 0;
+        band->flips[data->delta_now].count = 0;
+        band->edge[data->delta_now].count = 0;
+        for (row = band->row_start; row <= band->row_end; ++row){
+            for (col = 0; col < data->cols; ++col){
+                if (data->world[dense_index(data, row, col)] & DELTA_ALIVE){
+                    band->live++;
+                    push_cell(&band->flips[data->delta_now], row, col, 1);
+                    if (row == band->row_start || row == band->row_end){
+                        push_cell(&band->edge[data->delta_now], row, col, 1);
+                    }
+                }
+            }
+        }
+        ret1 = gol_barrier_wait(&data->sim->barrier); // every band's lists are in place
+        if(ret1 != 0 && ret1 != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("gol_barrier_wait");
+            exit(1);
+        }
+    }
+    start_rounds(data);
+    data->first_batch = 0;
+    TRACE_MARK(data, TRACE_START);
+
+    while (data->round < data->iters){
+        if (!settled){
+            settle_band(data);
+        }
+        settled = 0;
+        if (data->cycle != NULL){
+            hash_part(data);
+        }
+        cell = step_delta_band(data);
+        publish_live(data, cell);
+        data->delta_now ^= 1; // swapping lists around
+
+        TRACE_MARK(data, TRACE_COMPUTE);
+        ret1 = gol_barrier_wait(&data->sim->barrier);
+        if(ret1 != 0 && ret1 != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("gol_barrier_wait");
+            exit(1);
+        }
+        TRACE_MARK(data, TRACE_BARRIER);
+        if (data->thread_id == 0){
+            reduce_live(data, 1);
+            if(data->output_mode == OUTPUT_ASCII){
+                render_frame(data);
+            }
+            else if(data->output_mode == OUTPUT_VISI){
+                visi_round(data, 1);
+            }
+            if (data->cycle != NULL){
+                cycle_round(data);
+            }
+            if (data->sim->record != NULL){
+                record_round(data);
+            }
+            if (data->sim->publisher != NULL){
+                share_round(data);
+            }
+            TRACE_MARK(data, TRACE_SERIAL);
+        }
+        ret2 = gol_barrier_wait(&data->sim->barrier);
+        if(ret2 != 0 && ret2 != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("gol_barrier_wait");
+            exit(1);
+        }
+        TRACE_MARK(data, TRACE_RELEASE);
+        if (data->output_mode == OUTPUT_VISI){
+            visi_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->sim->record != NULL){
+            record_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->sim->publisher != NULL){
+            share_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->cycle != NULL && data->cycle->end >= 0){
+            data->iters = data->cycle->end; // the board repeats, see cycle.c
+        }
+        data->round += 1;
+    }
+    return NULL;
+}
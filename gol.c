@@ -0,0 +1,1378 @@
+/*
+ * The simulator as a library (libgol.a, see libgol.h): reading a board,
+ * the dense game loop and the pool of worker threads that plays the
+ * rounds. A simulation starts its workers once in gol_init, pins each to
+ * one of the CPUs the process may run on, and hands them batches of rounds
+ * through two barriers; between batches the workers sleep, so the board
+ * can be read, stepped again or replaced without creating threads.
+ */
+#define _GNU_SOURCE // pthread_setaffinity_np, sched_getaffinity
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <getopt.h>
+#include "gol.h"
+
+/****************** Function Prototypes **********************/
+/* making an arrtay that each partition should have*/
+int *number_partition(struct gol_data *data);
+/* the main gol game playing loop (prototype must match this) */
+void *play_gol(void *arg);
+/* parse the optional --flags of the gol command line */
+int parse_options(struct gol_data *data, int argc, char **argv);
+/* dynamically init matrix from the input file */
+void init_matrix(struct gol_data *data);
+/* make room for the population and round times up to a round */
+static int grow_history(struct gol_data *data, long rounds);
+/* free everything gol_load allocated */
+static void free_board(struct gol_sim *sim);
+/* split the board between the workers */
+static void assign_partitions(struct gol_sim *sim);
+/* pool job: count the live cells of the worker's part of the board */
+static void *count_part(void *arg);
+/* choose the grid of PARTITION_BLOCKS */
+static void block_grid(struct gol_data *data, int units);
+/* split n cells into parts at multiples of unit (less shift) */
+static int split_point(int n, int parts, int i, int unit, int shift);
+/* a worker of the pool: plays the batches of rounds it is handed */
+static void *worker_main(void *arg);
+/* pool job that does nothing */
+static void *worker_ready(void *arg);
+
+/* create a simulation: check the configuration, parse the options and
+ * start the worker pool, each worker pinned to one of the CPUs chosen by
+ * init_placement (in turn, when there are more workers than CPUs)
+ *   config: the thread configuration and the --options
+ *   returns: the simulation, NULL on error
+ */
+struct gol_sim *gol_init(const struct gol_config *config){
+    struct gol_sim *sim;
+    char **args;
+    int i, j, ret;
+
+    if (config->num_threads < 1){ // checking thread validity
+        printf("Error: invalid number of threads: %d\n", config->num_threads);
+        return NULL;
+    }
+    if (config->partition < 0 || config->partition > 2){ // checking partition validity
+        printf("Error: invalid partition mode: %d\n", config->partition);
+        return NULL;
+    }
+    if (config->output_mode < 0 || config->output_mode > 2){ // checking output validity
+        printf("Error: invalid output mode: %d\n", config->output_mode);
+        return NULL;
+    }
+    if (config->print_partition < 0 || config->print_partition > 1){ // checking print partition validity
+        printf("Error: invalid print partition mode: %d\n", config->print_partition);
+        return NULL;
+    }
+
+    sim = calloc(1, sizeof(struct gol_sim));
+    if (sim == NULL){
+        printf("Error: malloc failed\n");
+        return NULL;
+    }
+    sim->data.num_threads = config->num_threads;
+    sim->data.partition = config->partition;
+    sim->data.output_mode = config->output_mode;
+    sim->data.partition_yes_no = config->print_partition;
+    sim->data.sim = sim;
+
+    /* getopt wants the options after a program name */
+    args = malloc(sizeof(char *) * (config->argc + 2));
+    if (args == NULL){
+        printf("Error: malloc failed\n");
+        free(sim);
+        return NULL;
+    }
+    args[0] = "gol";
+    for (i = 0; i < config->argc; ++i){
+        args[i + 1] = config->argv[i];
+    }
+    args[config->argc + 1] = NULL;
+    ret = parse_options(&sim->data, config->argc + 1, args);
+    free(args);
+    if (ret != 0){
+        free(sim);
+        return NULL;
+    }
+
+    /* the CPUs the workers are pinned to */
+    if (init_placement(sim) != 0){
+        free(sim->cpus);
+        free(sim->cpu_node);
+        free(sim);
+        return NULL;
+    }
+
+    if (sim->data.trace_file != NULL && init_trace(&sim->data) != 0){
+        free(sim->cpus);
+        free(sim->cpu_node);
+        free(sim);
+        return NULL;
+    }
+
+    if (sim->data.cycle_max > 0 && init_cycle(&sim->data) != 0){
+        free_trace(&sim->data);
+        free(sim->cpus);
+        free(sim->cpu_node);
+        free(sim);
+        return NULL;
+    }
+
+    if (sim->data.output_mode == OUTPUT_ASCII && init_render(sim) != 0){
+        free_trace(&sim->data);
+        free_cycle(&sim->data);
+        free(sim->cpus);
+        free(sim->cpu_node);
+        free(sim);
+        return NULL;
+    }
+
+    if (gol_barrier_init(&sim->barrier, sim->data.num_threads) != 0
+        || gol_barrier_init(&sim->go, sim->data.num_threads + 1) != 0
+        || gol_barrier_init(&sim->done, sim->data.num_threads + 1) != 0){
+        printf("Error: barrier init failed\n");
+        exit(1);
+    }
+    sim->threads = calloc(sim->data.num_threads, sizeof(struct gol_data));
+    sim->workers = malloc(sim->data.num_threads * sizeof(pthread_t));
+    if (sim->threads == NULL || sim->workers == NULL){
+        perror("malloc: pthread_t array");
+        exit(1);
+    }
+    for (j = 0; j < sim->data.num_threads; j++){
+        sim->threads[j].thread_id = j;
+        sim->threads[j].sim = sim;
+        ret = pthread_create(&sim->workers[j], NULL, worker_main, &sim->threads[j]);
+        if (ret){
+            perror("Error pthread_create\n");
+            exit(1);
+        } //checks to see if the thread is valid
+    }
+    /* the workers read their gol_data while they start up; gol_load
+     * rewrites it, so let them all get to the go barrier first */
+    run_workers(sim, worker_ready);
+    return sim;
+}
+
+static void *worker_ready(void *arg){
+    return arg;
+}
+
+/* a worker of the pool: pins itself, then sleeps at the go barrier until
+ * it is handed rounds, plays them with the engine's game loop and reports
+ * at the done barrier
+ *   arg: the worker's own struct gol_data (sim->threads[thread_id])
+ *   returns: NULL
+ */
+static void *worker_main(void *arg){
+    struct gol_data *data = ((struct gol_data *)arg);
+    struct gol_sim *sim = data->sim;
+    int id = data->thread_id;
+    cpu_set_t mask;
+    int ret;
+
+    if (sim->num_cpus > 0){
+        CPU_ZERO(&mask);
+        CPU_SET(sim->cpus[id % sim->num_cpus], &mask);
+        pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask); // only a hint
+    }
+    while (1){
+        ret = gol_barrier_wait(&sim->go);
+        if(ret != 0 && ret != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("gol_barrier_wait");
+            exit(1);
+        }
+        if (sim->quit){
+            break;
+        }
+        sim->thread_main(data);
+        ret = gol_barrier_wait(&sim->done);
+        if(ret != 0 && ret != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("gol_barrier_wait");
+            exit(1);
+        }
+    }
+    return NULL;
+}
+
+/* read a board file or a snapshot written by gol_save, replacing the
+ * board loaded before (if any), and split it between the workers
+ *   sim: the simulation
+ *   path: name of the board file or snapshot
+ *   returns: 0 on success, 1 on error
+ */
+int gol_load(struct gol_sim *sim, const char *path){
+    struct gol_data *data = &sim->data;
+    long live;
+    int j;
+
+    if (sim->busy){
+        printf("Error: gol_load while rounds are running\n");
+        return 1;
+    }
+    free_board(sim);
+    data->random_fill = 0;
+    clear_trace(data);
+    clear_cycle(data);
+    /* back to --rule, a file naming its rule changes it while it loads */
+    parse_rule(data->rule_arg != NULL ? data->rule_arg : "B3/S23", &data->rule);
+    if (is_snapshot(path)){
+        if (init_game_data_from_snapshot(data, path) != 0){
+            return 1;
+        }
+    }
+    else if (strcmp(path, "random") == 0){
+        if (init_game_data_random(data) != 0){
+            return 1;
+        }
+    }
+    else if (init_game_data_from_file(data, path) != 0){
+        return 1;
+    }
+    if (sim->render != NULL){
+        render_board(sim);
+    }
+    sim->thread_main = play_gol;
+    if (data->engine == ENGINE_BITS){
+        sim->thread_main = play_gol_bits;
+    }
+    else if (data->engine == ENGINE_HASHLIFE){
+        sim->thread_main = play_gol_hashlife;
+    }
+    else if (data->engine == ENGINE_SPARSE){
+        sim->thread_main = play_gol_sparse;
+    }
+    else if (data->engine == ENGINE_DELTA){
+        sim->thread_main = play_gol_delta;
+    }
+    sim->file_iters = data->iters;
+    sim->start_ns = 0;
+    sim->end_ns = 0;
+    data->iters = data->round; // the workers play the rounds gol_start asks for
+    data->first_batch = 1;
+
+    assign_partitions(sim);
+    /* the live cells before the first round, counted by the workers */
+    if (data->engine == ENGINE_SPARSE){
+        live = data->sparse_count;
+    }
+    else if (data->engine == ENGINE_HASHLIFE){
+        live = get_hashlife_cells(data, NULL);
+    }
+    else{
+        run_workers(sim, count_part);
+        live = 0;
+        for (j = 0; j < data->num_threads; ++j){
+            live += data->live_counts[j].live;
+        }
+    }
+    sim->live = live;
+
+    if (data->partition_yes_no == 1 && data->partition == PARTITION_BLOCKS){
+        printf("grid: %d x %d blocks (rows x cols)\n", data->grid_rows, data->grid_cols);
+    }
+    if (data->partition_yes_no == 1){
+        run_workers(sim, place_worker);
+        print_placement(sim);
+    }
+    sim->loaded = 1;
+    if (data->record_file != NULL && start_record(sim) != 0){
+        free_board(sim);
+        return 1;
+    }
+    if (data->share_name != NULL && start_share(sim) != 0){
+        free_board(sim);
+        return 1;
+    }
+    return 0;
+}
+
+/* split the board between the workers and give each its copy of the
+ * game data
+ *   sim: the simulation, with the board allocated
+ */
+static void assign_partitions(struct gol_sim *sim){
+    struct gol_data *data = &sim->data;
+    int *result;
+    int j, r, unit, shift, gy, gx;
+
+    /* block columns start on cache lines: every 64 cells of the dense board
+     * (cell c is byte c + 1 of its row), every 8 words of the bit-packed one */
+    unit = (data->engine == ENGINE_BITS) ? 512 : 64;
+    shift = (data->engine == ENGINE_BITS) ? 0 : 1;
+    if (data->partition == PARTITION_BLOCKS){
+        block_grid(data, (data->cols + shift + unit - 1) / unit);
+    }
+    result = number_partition(data); // partitioning info
+    r = 0;
+    for (j = 0; j < data->num_threads; j++){ // create thread ids
+        data->thread_id = j;
+        if (data->partition == PARTITION_BLOCKS){
+            gy = j / data->grid_cols;
+            gx = j % data->grid_cols;
+            data->thread_row_start = split_point(data->rows, data->grid_rows, gy, 1, 0);
+            data->thread_row_end = split_point(data->rows, data->grid_rows, gy + 1, 1, 0) - 1;
+            data->thread_col_start = split_point(data->cols, data->grid_cols, gx, unit, shift);
+            data->thread_col_end = split_point(data->cols, data->grid_cols, gx + 1, unit, shift) - 1;
+        }
+        else{
+            data->thread_row_start = result[r];
+            data->thread_row_end = result[r + 1];
+            data->thread_col_start = 0;
+            data->thread_col_end = data->cols - 1;
+        }
+        r += 2;
+        sim->threads[j] = *data;
+    }
+    data->thread_id = 0;
+    free(result);
+}
+
+/* choose the grid of PARTITION_BLOCKS: of the ways to factor the thread
+ * count into rows x cols of blocks, the one that cuts the board the least
+ * (every cut is a line of halo cells read from the next block), with no
+ * more blocks down than rows or across than column units
+ * data: pointer to gol_data struct, sets grid_rows and grid_cols
+ * units: the column units (cache lines of a row) the blocks are made of
+ * returns: none
+ */
+static void block_grid(struct gol_data *data, int units){
+    long cut, best = -1;
+    int gx, gy;
+
+    data->grid_rows = data->num_threads; // no grid fits: bands of rows, some empty
+    data->grid_cols = 1;
+    for (gx = 1; gx <= data->num_threads; ++gx){
+        gy = data->num_threads / gx;
+        if (data->num_threads % gx != 0 || gx > units || gy > data->rows){
+            continue;
+        }
+        cut = (long)(gy - 1) * data->cols + (long)(gx - 1) * data->rows;
+        if (best < 0 || cut < best){
+            best = cut;
+            data->grid_rows = gy;
+            data->grid_cols = gx;
+        }
+    }
+}
+
+/* the first cell of part i when n cells are split into parts that start
+ * on multiples of unit, less shift (part parts starts at n, parts past
+ * the last unit are empty)
+ */
+static int split_point(int n, int parts, int i, int unit, int shift){
+    long units = ((long)n + shift + unit - 1) / unit;
+
+    if (i == 0){
+        return 0;
+    }
+    if (i >= parts || i >= units){
+        return n;
+    }
+    return (int)(unit * (i * units / parts) - shift);
+}
+
+static void *count_part(void *arg){
+    struct gol_data *data = ((struct gol_data *)arg);
+    long live = 0;
+    int r, c;
+
+    for (r = data->thread_row_start; r <= data->thread_row_end; ++r){
+        for (c = data->thread_col_start; c <= data->thread_col_end; ++c){
+            live += gol_cell(data, r, c);
+        }
+    }
+    data->live_counts[data->thread_id].live = live;
+    return NULL;
+}
+
+/* run a job on every worker of the pool (instead of the game loop) and
+ * wait until all of them are done with it
+ *   sim: the simulation, no rounds running
+ *   job: called with each worker's struct gol_data
+ */
+void run_workers(struct gol_sim *sim, void *(*job)(void *)){
+    void *(*thread_main)(void *) = sim->thread_main;
+    int ret;
+
+    sim->thread_main = job;
+    ret = gol_barrier_wait(&sim->go);
+    if(ret != 0 && ret != PTHREAD_BARRIER_SERIAL_THREAD) {
+        perror("gol_barrier_wait");
+        exit(1);
+    }
+    ret = gol_barrier_wait(&sim->done);
+    if(ret != 0 && ret != PTHREAD_BARRIER_SERIAL_THREAD) {
+        perror("gol_barrier_wait");
+        exit(1);
+    }
+    sim->thread_main = thread_main;
+}
+
+/* free everything gol_load allocated, the simulation has no board after
+ *   sim: the simulation (the workers must be asleep)
+ */
+static void free_board(struct gol_sim *sim){
+    struct gol_data *data = &sim->data;
+    int j;
+
+    if (!sim->loaded){
+        return;
+    }
+    finish_record(sim, 0); // the stream of this board ends here
+    finish_share(sim);
+    for (j = 0; j < data->num_threads; j++){
+        free(sim->threads[j].piece_live);
+        free(sim->threads[j].wave);
+        sim->threads[j].piece_live = NULL;
+        sim->threads[j].wave = NULL;
+    }
+    if (data->partition == PARTITION_STEAL){
+        free_steal(data);
+    }
+    if (data->tile_size > 0){
+        free_tiles(data);
+    }
+    if (data->engine == ENGINE_SPARSE){
+        free_sparse(data);
+    }
+    if (data->engine == ENGINE_DELTA){
+        free_delta(data);
+    }
+    if (data->engine == ENGINE_HASHLIFE){
+        free_hashlife(data);
+    }
+    if (data->board_bytes > 0){
+        free_untouched(data->world, data->board_bytes);
+        free_untouched(data->next_world, data->board_bytes);
+    }
+    else{
+        free(data->world);
+        free(data->next_world);
+    }
+    free(data->bits_world);
+    free(data->bits_next);
+    free(data->bits_zero);
+    free(data->live_counts);
+    free(data->population);
+    free(data->round_ns);
+    sim->loaded = 0;
+}
+
+/* hand the workers some rounds; they play them while the caller goes on
+ *   sim: the simulation
+ *   rounds: the number of rounds to advance the board
+ *   returns: 0 on success, 1 on error
+ */
+int gol_start(struct gol_sim *sim, long rounds){
+    long round;
+    int j, ret;
+
+    if (!sim->loaded || sim->busy || rounds < 0){
+        printf("Error: gol_start needs a loaded board, no running rounds and rounds >= 0\n");
+        return 1;
+    }
+    round = sim->data.round;
+    if (sim->data.keep_history && round + rounds > sim->data.history){
+        /* at least double, so stepping one round at a time stays cheap */
+        if (grow_history(&sim->data, (round + rounds > 2 * sim->data.history) ?
+                         round + rounds : 2 * sim->data.history) != 0){
+            printf("Error: malloc failed\n");
+            return 1;
+        }
+    }
+    sim->data.iters = round + rounds;
+    if (sim->data.cycle != NULL){
+        sim->data.cycle->end = -1; // look for a cycle again
+    }
+    for (j = 0; j < sim->data.num_threads; j++){
+        sim->threads[j].population = sim->data.population;
+        sim->threads[j].round_ns = sim->data.round_ns;
+        sim->threads[j].history = sim->data.history;
+        sim->threads[j].iters = round + rounds;
+    }
+    sim->busy = 1;
+    ret = gol_barrier_wait(&sim->go);
+    if(ret != 0 && ret != PTHREAD_BARRIER_SERIAL_THREAD) {
+        perror("gol_barrier_wait");
+        exit(1);
+    }
+    return 0;
+}
+
+/* wait for the rounds handed out by gol_start
+ *   sim: the simulation
+ *   returns: 0 on success, 1 on error
+ */
+int gol_wait(struct gol_sim *sim){
+    int j, ret;
+
+    if (!sim->busy){
+        printf("Error: gol_wait without gol_start\n");
+        return 1;
+    }
+    ret = gol_barrier_wait(&sim->done);
+    if(ret != 0 && ret != PTHREAD_BARRIER_SERIAL_THREAD) {
+        perror("gol_barrier_wait");
+        exit(1);
+    }
+    sim->busy = 0;
+    if (sim->render != NULL){
+        render_drain(sim); // the last round on the terminal before the caller prints
+    }
+    finish_cycle(sim); // a cycle may have ended the workers' rounds early
+    /* hashlife only runs on thread 0, the others are left behind */
+    sim->data.round = sim->data.iters;
+    for (j = 0; j < sim->data.num_threads; j++){
+        sim->threads[j].round = sim->data.iters;
+    }
+    return 0;
+}
+
+/* advance the board some rounds
+ *   sim: the simulation
+ *   rounds: the number of rounds
+ *   returns: 0 on success, 1 on error
+ */
+int gol_step(struct gol_sim *sim, long rounds){
+    if (gol_start(sim, rounds) != 0){
+        return 1;
+    }
+    return gol_wait(sim);
+}
+
+/* the live cells on the board after the last round played */
+long gol_population(struct gol_sim *sim){
+    return sim->live;
+}
+
+/* the rounds played since the board was loaded */
+long gol_round(struct gol_sim *sim){
+    return sim->data.round;
+}
+
+int gol_rows(struct gol_sim *sim){
+    return sim->data.rows;
+}
+
+int gol_cols(struct gol_sim *sim){
+    return sim->data.cols;
+}
+
+/* copy the board, one byte per cell, row after row
+ *   sim: the simulation
+ *   cells: room for rows * cols bytes, set to 1 (alive) or 0 (dead)
+ *   returns: 0 on success, 1 on error
+ */
+int gol_snapshot(struct gol_sim *sim, uint8_t *cells){
+    struct gol_data *data = &sim->threads[0]; // has the current world pointers
+    int i, j;
+
+    if (!sim->loaded || sim->busy){
+        printf("Error: gol_snapshot needs a loaded board and no running rounds\n");
+        return 1;
+    }
+    for (i = 0; i < data->rows; ++i){
+        for (j = 0; j < data->cols; ++j){
+            cells[(size_t)i * data->cols + j] = gol_cell(data, i, j);
+        }
+    }
+    return 0;
+}
+
+/* stop the worker pool and free the simulation
+ *   sim: the simulation (NULL is ignored)
+ */
+void gol_free(struct gol_sim *sim){
+    int j;
+
+    if (sim == NULL){
+        return;
+    }
+    if (sim->busy){
+        gol_wait(sim);
+    }
+    sim->quit = 1;
+    gol_barrier_wait(&sim->go); // the workers see quit and exit
+    for (j = 0; j < sim->data.num_threads; j++){
+        pthread_join(sim->workers[j], NULL);
+    }
+    free_render(sim);
+    free_board(sim);
+    free_trace(&sim->data);
+    free_cycle(&sim->data);
+    gol_barrier_destroy(&sim->barrier);
+    gol_barrier_destroy(&sim->go);
+    gol_barrier_destroy(&sim->done);
+    free(sim->threads);
+    free(sim->workers);
+    free(sim->cpus);
+    free(sim->cpu_node);
+    free(sim);
+}
+
+/* read one cell of the current board of any engine
+ *   data: gol game specific data (of a worker, for its world pointers)
+ *   row, col: the cell
+ *   returns: 1 if the cell is alive, 0 if it is dead
+ */
+int gol_cell(struct gol_data *data, int row, int col){
+    if (data->engine == ENGINE_BITS){
+        return get_bits_cell(data, row, col);
+    }
+    if (data->engine == ENGINE_SPARSE){
+        return get_sparse_cell(data, row, col);
+    }
+    if (data->engine == ENGINE_HASHLIFE){
+        return get_hashlife_cell(data, row, col);
+    }
+    return data->world[dense_index(data, row, col)] & 1; // (ENGINE_DELTA: and the counts)
+}
+
+/* make room in the population and round time history up to a round; the
+ * new rounds are marked skipped (-1, 0)
+ *   data: the game data that owns the history
+ *   rounds: the last round to make room for
+ *   returns: 0 on success, 1 on error
+ */
+static int grow_history(struct gol_data *data, long rounds){
+    long *population;
+    long long *round_ns;
+    long i;
+
+    if (rounds <= data->history){
+        return 0;
+    }
+    population = realloc(data->population, sizeof(long) * (rounds + 1));
+    if (population == NULL){
+        return 1;
+    }
+    data->population = population;
+    round_ns = realloc(data->round_ns, sizeof(long long) * (rounds + 1));
+    if (round_ns == NULL){
+        return 1;
+    }
+    data->round_ns = round_ns;
+    for (i = data->history + 1; i <= rounds; ++i){
+        population[i] = -1;
+        round_ns[i] = 0;
+    }
+    data->history = rounds;
+    return 0;
+}
+
+/* figures out how to spilt up the function for the board printing/playing
+ * data: pointer to gol_data struct to initialize
+ * returns: result, an array of ints with partitioning information 
+ */
+int *number_partition(struct gol_data *data){
+    int num_threads = data->num_threads;
+    int *result = malloc(sizeof(int) * num_threads);
+    int *final_result = malloc(sizeof(int) * num_threads * 2);
+    int partition, left_over;
+    int count = 0;
+    int result_count = 0;
+    partition = data->rows / num_threads;
+    left_over = data->rows % num_threads;
+    for (int i = 0; i < num_threads; i++)
+    {
+        result[i] = partition;
+    }
+    if (left_over != 0)
+    {
+        for (int j = 0; j < left_over; j++)
+        {
+            result[j] = result[j] + 1;
+        }
+    }
+    final_result[0] = 0;
+    for (int x = 1; x < num_threads * 2; ++x)
+    {
+        if (x % 2 == 0)
+        {
+            count += 1;
+            final_result[x] = count;
+        }
+        else
+        {
+            count += result[result_count] - 1;
+            final_result[x] = count;
+            result_count++;
+        }
+    }
+    free(result);
+    return final_result;
+}
+
+/* allocate the board of the engine in data (all cells dead); with
+ * --numa the workers zero their own parts of the dense boards
+ * data: pointer to gol_data struct with rows, cols and the options set
+ * returns: none (errors exit)
+ */
+void alloc_board(struct gol_data *data){
+    data->world = NULL;
+    data->next_world = NULL;
+    data->board_bytes = 0;
+    data->bits_world = NULL;
+    data->bits_next = NULL;
+    data->bits_zero = NULL;
+    data->sparse_cells = NULL;
+    data->sparse_count = 0;
+    data->sparse_cap = 0;
+    data->bands = NULL;
+    data->deltas = NULL;
+    data->hashlife = NULL;
+    if (data->engine == ENGINE_BITS){
+        if (init_bits_world(data) != 0){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+    }
+    else if (data->engine == ENGINE_SPARSE){
+        // no board at all, memory grows with the live cells
+        if (init_sparse(data) != 0){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+    }
+    else if (data->engine == ENGINE_HASHLIFE){
+        // the board is a tree, built from the cells once they are loaded
+        if (init_hashlife(data) != 0){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+    }
+    else{
+        if (data->engine == ENGINE_DELTA && init_delta(data) != 0){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+        // one halo column on each side, rows padded to whole cache lines
+        data->stride = (data->cols + 2 + 63) & ~63;
+        if (data->first_touch){
+            // untouched pages, each worker zeroes its own part so it lands on its node
+            data->board_bytes = sizeof(uint8_t) * (size_t)(data->rows + 2) * (data->stride);
+            data->world = alloc_untouched(data->board_bytes);
+            if (data->engine != ENGINE_DELTA){ // the delta engine updates world in place
+                data->next_world = alloc_untouched(data->board_bytes);
+            }
+            if (data->world == NULL || (data->next_world == NULL && data->engine != ENGINE_DELTA)){
+                printf("Error: malloc failed\n");
+                exit(1);
+            }
+            assign_partitions(data->sim);
+            data->sim->touch = 1;
+            run_workers(data->sim, place_worker);
+            data->sim->touch = 0;
+        }
+        else{
+            data->world = aligned_alloc(64, sizeof(uint8_t) * (size_t)(data->rows + 2) * (data->stride));
+            if (data->world == NULL){
+                printf("Error: malloc failed\n");
+                exit(1);
+            }
+            if (data->engine != ENGINE_DELTA){
+                data->next_world = aligned_alloc(64, sizeof(uint8_t) * (size_t)(data->rows + 2) * (data->stride));
+            }
+            if (data->next_world == NULL && data->engine != ENGINE_DELTA){
+                printf("Error: malloc failed\n");
+                exit(1);
+            }
+            init_matrix(data);
+        }
+    }
+    if (data->random_fill){
+        // the workers draw their own parts of the board
+        assign_partitions(data->sim);
+        run_workers(data->sim, random_part);
+        if (data->engine == ENGINE_SPARSE || data->engine == ENGINE_HASHLIFE){
+            gather_random_cells(data->sim);
+        }
+    }
+}
+
+/* get a board whose live cells are set ready for the first round: fill
+ * the halo, sort the sparse cells, build the hashlife tree, set up the
+ * tiles and the history
+ * data: pointer to gol_data struct with the board filled in and round set
+ * returns: none (errors exit)
+ */
+void finish_board(struct gol_data *data){
+    if (data->engine == ENGINE_DENSE){
+        refresh_halo(data, 0, data->rows - 1, 0, data->cols - 1);
+    }
+    if (data->engine == ENGINE_SPARSE){
+        sort_sparse_cells(data);
+    }
+    if (data->engine == ENGINE_HASHLIFE){
+        build_hashlife(data);
+    }
+    if (data->engine == ENGINE_DELTA){
+        count_delta_board(data);
+    }
+    data->piece_live = NULL;
+    data->wave = NULL;
+    data->tiles_computed = 0;
+    data->tiles_skipped = 0;
+    data->tiles_stolen = 0;
+    if (data->partition == PARTITION_STEAL && data->tile_size == 0){
+        data->tile_size = 64; // tiles to schedule, without skipping any
+    }
+    if (data->tile_size > 0 && init_tiles(data) != 0){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    if (data->partition == PARTITION_STEAL && init_steal(data) != 0){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    data->live_counts = aligned_alloc(64, sizeof(struct live_count) * data->num_threads);
+    data->population = NULL;
+    data->round_ns = NULL;
+    data->history = -1;
+    if (data->live_counts == NULL
+        || (data->keep_history && grow_history(data, data->iters) != 0)){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+}
+
+/* parse the optional flags (given after the five positional arguments of
+ * the gol command line)
+ *       --engine dense|bits|hashlife|sparse: how the board is stored and computed
+ *       --rule B3/S23: the rule in B/S notation (default: the board file's or B3/S23)
+ *       --hashlife-nodes N: the node store size hashlife stays near
+ *       --active-tiles N: skip the NxN tiles of the dense board that cannot change
+ *       --temporal-depth K: advance the dense board K rounds between barriers
+ *       --population FILE: write the live cells after every round to FILE
+ *       --numa: spread the workers over the NUMA nodes, each first-touches its rows
+ *       --cpus LIST: pin the workers to these CPUs in turn (e.g. 0-3,8)
+ *       --checkpoint N: save a snapshot of the board every N rounds
+ *       --checkpoint-file FILE: where to save it (default: the board file .ckpt)
+ *       --restart: start from the checkpoint if there is one
+ *       --rounds N: the rounds to run (patterns have no count, overrides the gol format's)
+ *       --size RxC: the board of an RLE or .cells pattern (default: the pattern's size)
+ *       --offset R,C: the pattern's top left cell (default: the pattern centered)
+ *       --random P: draw the board around the pattern at random, P of the cells alive
+ *       --seed N: the seed of the random board (default 1)
+ *       --ascii-fit: scale the ASCII animation down to the terminal
+ *       --fps N: frames a second of the ParaVis animation, rounds in between are skipped
+ *       --cycles P: stop early once the board repeats with a period of at most P
+ *       --trace FILE: write a Chrome trace of every round's phases (make TRACE=1)
+ *       --record FILE: write every round's board to a compressed stream (gol replay)
+ *       --keyframe N: rounds between the whole boards of the stream (default 64)
+ *       --share NAME: publish every round's board in the shared memory object NAME
+ *       --kernel avx2|sse2|scalar: force the dense row kernel (default: best available)
+ *       --boundary torus|dead: wrap around the edges (default) or treat them as dead
+ * data: pointer to gol_data struct to initialize
+ * argc: number of command line args
+ * argv: command line args, the options start at argv[1]
+ * returns: 0 on success, 1 on error
+ */
+int parse_options(struct gol_data *data, int argc, char **argv){
+    static struct option long_options[] = {
+        {"engine", required_argument, NULL, 'e'},
+        {"rule", required_argument, NULL, 'u'},
+        {"kernel", required_argument, NULL, 'k'},
+        {"boundary", required_argument, NULL, 'b'},
+        {"hashlife-nodes", required_argument, NULL, 'H'},
+        {"active-tiles", required_argument, NULL, 't'},
+        {"temporal-depth", required_argument, NULL, 'T'},
+        {"population", required_argument, NULL, 'p'},
+        {"numa", no_argument, NULL, 'N'},
+        {"cpus", required_argument, NULL, 'c'},
+        {"checkpoint", required_argument, NULL, 'C'},
+        {"checkpoint-file", required_argument, NULL, 'F'},
+        {"restart", no_argument, NULL, 'R'},
+        {"rounds", required_argument, NULL, 'r'},
+        {"size", required_argument, NULL, 's'},
+        {"offset", required_argument, NULL, 'o'},
+        {"random", required_argument, NULL, 'D'},
+        {"seed", required_argument, NULL, 'S'},
+        {"ascii-fit", no_argument, NULL, 'a'},
+        {"fps", required_argument, NULL, 'f'},
+        {"cycles", required_argument, NULL, 'y'},
+        {"trace", required_argument, NULL, 'x'},
+        {"record", required_argument, NULL, 'w'},
+        {"keyframe", required_argument, NULL, 'K'},
+        {"share", required_argument, NULL, 'M'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    const char *kernel = NULL;
+    char *end;
+
+    data->engine = ENGINE_DENSE;
+    data->boundary = BOUNDARY_TORUS;
+    data->hashlife_nodes = 1 << 22;
+    data->tile_size = 0;
+    data->track_tiles = 0;
+    data->temporal_depth = 1;
+    data->population_file = NULL;
+    data->first_touch = 0;
+    data->cpu_list = NULL;
+    data->checkpoint_every = 0;
+    data->checkpoint_file = NULL;
+    data->restart = 0;
+    data->rounds = -1;
+    data->pattern_rows = 0;
+    data->pattern_cols = 0;
+    data->offset_set = 0;
+    data->random_density = 0;
+    data->random_seed = 1;
+    data->random_fill = 0;
+    data->rule_arg = NULL;
+    data->ascii_fit = 0;
+    data->visi_fps = 1000000 / SLEEP_USECS;
+    data->trace_file = NULL;
+    data->trace = NULL;
+    data->cycle_max = 0;
+    data->cycle = NULL;
+    data->record_file = NULL;
+    data->keyframe_every = 64;
+    data->share_name = NULL;
+    data->keep_history = 0;
+
+    optind = 0; // start over at argv[1]
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1){
+        switch (opt){
+        case 'e':
+            if (strcmp(optarg, "dense") == 0){
+                data->engine = ENGINE_DENSE;
+            }
+            else if (strcmp(optarg, "bits") == 0){
+                data->engine = ENGINE_BITS;
+            }
+            else if (strcmp(optarg, "hashlife") == 0){
+                data->engine = ENGINE_HASHLIFE;
+            }
+            else if (strcmp(optarg, "sparse") == 0){
+                data->engine = ENGINE_SPARSE;
+            }
+            else if (strcmp(optarg, "delta") == 0){
+                data->engine = ENGINE_DELTA;
+            }
+            else{
+                printf("Error: unknown engine: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'u':
+            data->rule_arg = optarg;
+            break;
+        case 'k':
+            kernel = optarg;
+            break;
+        case 't':
+            if (atoi(optarg) < 0){
+                printf("Error: invalid tile size: %s\n", optarg);
+                return 1;
+            }
+            data->tile_size = atoi(optarg);
+            data->track_tiles = (data->tile_size > 0);
+            break;
+        case 'T':
+            if (atoi(optarg) < 1){
+                printf("Error: invalid temporal depth: %s\n", optarg);
+                return 1;
+            }
+            data->temporal_depth = atoi(optarg);
+            break;
+        case 'p':
+            data->population_file = optarg;
+            data->keep_history = 1;
+            break;
+        case 'N':
+            data->first_touch = 1;
+            break;
+        case 'c':
+            data->cpu_list = optarg;
+            break;
+        case 'C':
+            if (atoi(optarg) < 1){
+                printf("Error: invalid checkpoint interval: %s\n", optarg);
+                return 1;
+            }
+            data->checkpoint_every = atoi(optarg);
+            break;
+        case 'F':
+            data->checkpoint_file = optarg;
+            break;
+        case 'R':
+            data->restart = 1;
+            break;
+        case 'r':
+            data->rounds = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || data->rounds < 0){
+                printf("Error: invalid number of rounds: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 's':
+            if (sscanf(optarg, "%dx%d", &data->pattern_rows, &data->pattern_cols) != 2
+                || data->pattern_rows < 1 || data->pattern_cols < 1){
+                printf("Error: invalid board size (rowsxcols): %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'o':
+            if (sscanf(optarg, "%d,%d", &data->offset_row, &data->offset_col) != 2){
+                printf("Error: invalid offset (row,col): %s\n", optarg);
+                return 1;
+            }
+            data->offset_set = 1;
+            break;
+        case 'D':
+            if (atof(optarg) <= 0 || atof(optarg) > 1){
+                printf("Error: invalid density (0 < P <= 1): %s\n", optarg);
+                return 1;
+            }
+            data->random_density = atof(optarg);
+            break;
+        case 'S':
+            data->random_seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'a':
+            data->ascii_fit = 1;
+            break;
+        case 'f':
+            if (atoi(optarg) < 1){
+                printf("Error: invalid frame rate: %s\n", optarg);
+                return 1;
+            }
+            data->visi_fps = atoi(optarg);
+            break;
+        case 'y':
+            if (atoi(optarg) < 1){
+                printf("Error: invalid cycle period: %s\n", optarg);
+                return 1;
+            }
+            data->cycle_max = atoi(optarg);
+            break;
+        case 'w':
+            data->record_file = optarg;
+            break;
+        case 'K':
+            if (atoi(optarg) < 1){
+                printf("Error: invalid keyframe interval: %s\n", optarg);
+                return 1;
+            }
+            data->keyframe_every = atoi(optarg);
+            break;
+        case 'M':
+            if (optarg[0] != '/' || strchr(optarg + 1, '/') != NULL){
+                printf("Error: invalid shared memory name (like /gol): %s\n", optarg);
+                return 1;
+            }
+            data->share_name = optarg;
+            break;
+        case 'x':
+#ifdef GOL_TRACE
+            data->trace_file = optarg;
+            break;
+#else
+            printf("Error: --trace needs gol built with make TRACE=1\n");
+            return 1;
+#endif
+        case 'H':
+            if (atoll(optarg) < 1024){
+                printf("Error: invalid hashlife node limit: %s\n", optarg);
+                return 1;
+            }
+            data->hashlife_nodes = atoll(optarg);
+            break;
+        case 'b':
+            if (strcmp(optarg, "torus") == 0){
+                data->boundary = BOUNDARY_TORUS;
+            }
+            else if (strcmp(optarg, "dead") == 0){
+                data->boundary = BOUNDARY_DEAD;
+            }
+            else{
+                printf("Error: unknown boundary: %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            return 1;
+        }
+    }
+    if (optind < argc){
+        printf("Error: unexpected argument: %s\n", argv[optind]);
+        return 1;
+    }
+    if (data->engine == ENGINE_HASHLIFE && data->boundary == BOUNDARY_DEAD){
+        printf("Error: the hashlife engine only supports the torus boundary\n");
+        return 1;
+    }
+    if (data->engine == ENGINE_HASHLIFE && data->output_mode != OUTPUT_NONE){
+        printf("Error: the hashlife engine skips rounds, use output mode 0\n");
+        return 1;
+    }
+    if (data->track_tiles && data->engine != ENGINE_DENSE){
+        printf("Error: active tiles need the dense engine\n");
+        return 1;
+    }
+    if (data->temporal_depth > 1 && (data->engine != ENGINE_DENSE || data->track_tiles)){
+        printf("Error: temporal blocking needs the dense engine without active tiles\n");
+        return 1;
+    }
+    if (data->temporal_depth > 1 && data->output_mode != OUTPUT_NONE){
+        printf("Error: temporal blocking skips rounds, use output mode 0\n");
+        return 1;
+    }
+    if (data->partition == PARTITION_STEAL && data->engine != ENGINE_DENSE){
+        printf("Error: work-stealing tiles need the dense engine\n");
+        return 1;
+    }
+    if (data->partition != PARTITION_ROWS && data->engine == ENGINE_SPARSE){
+        printf("Error: the sparse engine partitions by rows\n");
+        return 1;
+    }
+    if (data->partition != PARTITION_ROWS && data->engine == ENGINE_DELTA){
+        printf("Error: the delta engine partitions by rows\n");
+        return 1;
+    }
+    if (data->partition != PARTITION_ROWS && data->temporal_depth > 1){
+        printf("Error: temporal blocking partitions by rows\n");
+        return 1;
+    }
+    if (data->checkpoint_every > 0 && data->output_mode == OUTPUT_VISI){
+        printf("Error: checkpoints run the rounds in batches, use output mode 0 or 1\n");
+        return 1;
+    }
+    if (data->cycle_max > 0 && (data->engine == ENGINE_HASHLIFE || data->temporal_depth > 1)){
+        printf("Error: --cycles needs every round, not hashlife or temporal blocking\n");
+        return 1;
+    }
+    if (data->cycle_max > 0 && data->output_mode == OUTPUT_VISI){
+        printf("Error: --cycles ends runs early, use output mode 0 or 1\n");
+        return 1;
+    }
+    if (data->record_file != NULL && (data->engine == ENGINE_HASHLIFE || data->temporal_depth > 1
+                                      || data->cycle_max > 0)){
+        printf("Error: --record needs every round, not hashlife, temporal blocking or --cycles\n");
+        return 1;
+    }
+    if (data->share_name != NULL && (data->engine == ENGINE_HASHLIFE || data->temporal_depth > 1
+                                     || data->cycle_max > 0)){
+        printf("Error: --share needs every round, not hashlife, temporal blocking or --cycles\n");
+        return 1;
+    }
+    if (parse_rule(data->rule_arg != NULL ? data->rule_arg : "B3/S23", &data->rule) != 0){
+        printf("Error: invalid rule (B/S notation, like B36/S23): %s\n", data->rule_arg);
+        return 1;
+    }
+    if (check_rule(data, &data->rule) != 0){
+        return 1;
+    }
+    if (init_stencil(data, kernel) != 0){
+        printf("Error: kernel not supported on this machine: %s\n", kernel);
+        return 1;
+    }
+    return 0;
+}
+
+/* initialize two matrices (and their halo) using the row and columns stored in data
+ * data: pointer to gol_data struct to initialize
+ * returns: none
+ */
+void init_matrix(struct gol_data *data){
+    size_t bytes = sizeof(uint8_t) * (size_t)(data->rows + 2) * data->stride;
+
+    memset(data->world, 0, bytes);
+    if (data->next_world != NULL){
+        memset(data->next_world, 0, bytes);
+    }
+}
+
+/* the gol application main loop function:
+ *  runs rounds of GOL,
+ *    * updates program state for next round (world and sim->live)
+ *    * performs any animation step based on the output/run mode
+ *    * uses threading to partition the game 
+ *
+ *   data: pointer to a struct gol_data  initialized with
+ *         all GOL game playing state
+ *  returns: nothing--void function 
+ */
+
+void *play_gol(void *arg){
+    struct gol_data *data = ((struct gol_data *)arg);
+    int steps, row_difference, col_difference, ret1, ret2;
+    long cell;
+    cell = 0;
+    row_difference = data->thread_row_end - data->thread_row_start + 1;
+    col_difference = data->thread_col_end - data->thread_col_start + 1;
+    if (data->partition_yes_no == 1 && data->first_batch){ //checks to print partition info
+        printf("tid %d: rows: %d:%d (%d) cols: %d:%d (%d)\n", data->thread_id, data->thread_row_start, data->thread_row_end, row_difference,
+               data->thread_col_start, data->thread_col_end, col_difference);
+    }
+    start_rounds(data);
+    data->first_batch = 0;
+    TRACE_MARK(data, TRACE_START);
+    while (data->round < data->iters){
+        steps = 1;
+        if (data->cycle != NULL){
+            hash_part(data);
+        }
+        if (data->temporal_depth > 1){
+            steps = (data->iters - data->round < data->temporal_depth) ? data->iters - data->round : data->temporal_depth;
+            cell = step_dense_temporal(data, steps);
+        }
+        else if (data->partition == PARTITION_STEAL){
+            cell = step_dense_steal(data);
+        }
+        else if (data->track_tiles){
+            cell = step_dense_tiles(data);
+        }
+        else{
+            cell = step_dense_block(data);
+        }
+        publish_live(data, cell);
+        data->temp = data->world;        // swapping worlds around
+        data->world = data->next_world;
+        data->next_world = data->temp;
+        TRACE_MARK(data, TRACE_COMPUTE);
+
+
+        ret1 = gol_barrier_wait(&data->sim->barrier);
+        if(ret1 != 0 && ret1 != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("gol_barrier_wait");
+            exit(1);
+            }
+        TRACE_MARK(data, TRACE_BARRIER);
+        if (data->thread_id == 0){
+            reduce_live(data, steps);
+            if(data->output_mode == 1){
+                render_frame(data);
+            }
+            else if(data->output_mode == 2){
+                visi_round(data, steps);
+            }
+            if (data->cycle != NULL){
+                cycle_round(data);
+            }
+            if (data->sim->record != NULL){
+                record_round(data);
+            }
+            if (data->sim->publisher != NULL){
+                share_round(data);
+            }
+            TRACE_MARK(data, TRACE_SERIAL);
+        }
+        // every thread copies its own edges into the halo of the new world
+        refresh_halo(data, data->thread_row_start, data->thread_row_end,
+                     data->thread_col_start, data->thread_col_end);
+        if (data->partition == PARTITION_STEAL){
+            fill_deque(data); // nobody steals until the next round starts
+        }
+        TRACE_MARK(data, TRACE_HALO);
+        ret2 = gol_barrier_wait(&data->sim->barrier);
+        if(ret2 != 0 && ret2 != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("gol_barrier_wait");
+            exit(1);
+            }
+        TRACE_MARK(data, TRACE_RELEASE);
+        if (data->output_mode == 2){
+            visi_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->sim->record != NULL){
+            record_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->sim->publisher != NULL){
+            share_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->cycle != NULL && data->cycle->end >= 0){
+            data->iters = data->cycle->end; // the board repeats, see cycle.c
+        }
+        cell = 0;
+        data->round += steps;
+    }
+    return NULL;
+}
+
+/* store the calling thread's live count of the round it just computed.
+ * Every thread writes only its own slot, so no lock is needed; the
+ * barrier that follows makes the slots visible to thread 0.
+ *   data: gol game specific data of the calling thread
+ *   cell: the live cells the thread computed
+ */
+void publish_live(struct gol_data *data, long cell){
+    data->live_counts[data->thread_id].live = cell;
+}
+
+/* sum the counts the threads published into sim->live and record it as
+ * the population after the last of the rounds just computed (with
+ * --population) and the time it ended. Called by
+ * thread 0 between the two barriers of a round.
+ *   data: gol game specific data of thread 0
+ *   steps: the number of rounds the threads just advanced
+ */
+void reduce_live(struct gol_data *data, int steps){
+    long sum = 0;
+    int i;
+
+    for (i = 0; i < data->num_threads; ++i){
+        sum += data->live_counts[i].live;
+    }
+    data->sim->live = sum;
+    data->sim->end_ns = monotonic_ns();
+    if (data->population != NULL){
+        data->population[data->round + steps - 1] = sum;
+        data->round_ns[data->round + steps] = data->sim->end_ns;
+    }
+}
+
+/* wait until every thread is running, then (thread 0) note the time the
+ * first round of the batch starts, so the timing leaves out waking up the
+ * workers
+ *   data: gol game specific data of the calling thread
+ */
+void start_rounds(struct gol_data *data){
+    int ret;
+
+    ret = gol_barrier_wait(&data->sim->barrier);
+    if(ret != 0 && ret != PTHREAD_BARRIER_SERIAL_THREAD) {
+        perror("gol_barrier_wait");
+        exit(1);
+    }
+    if (data->thread_id == 0){
+        note_start(data);
+    }
+}
+
+/* thread 0: note the time the batch's first round starts, and the start
+ * of the run if it is the first batch since the load
+ *   data: gol game specific data of thread 0
+ */
+void note_start(struct gol_data *data){
+    long long now = monotonic_ns();
+
+    if (data->round_ns != NULL){
+        data->round_ns[data->round] = now;
+    }
+    if (data->sim->start_ns == 0){
+        data->sim->start_ns = now;
+        data->sim->end_ns = now;
+    }
+}
+
+/* the time on the monotonic clock
+ *   returns: nanoseconds since an arbitrary fixed point
+ */
+long long monotonic_ns(void){
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
@@ -0,0 +1,563 @@
+#ifndef __GOL_H__
+#define __GOL_H__
+
+#include <pthreadGridVisi.h>
+#include <pthread.h>
+#include <stdint.h>
+#include "libgol.h"
+
+struct tile_deque;
+struct sparse_band;
+struct delta_band;
+struct hl_store;
+struct gol_render;
+struct gol_visi;
+struct gol_record;
+struct gol_publisher;
+
+/* Shared definitions for the simulator: the game state struct, the engines
+ * and the synchronization objects every engine's thread loop uses. The
+ * public interface of the library is libgol.h. */
+
+/****************** Definitions **********************/
+/* Three possible modes in which the GOL simulation can run */
+#define OUTPUT_NONE (0)  // with no animation
+#define OUTPUT_ASCII (1) // with ascii animation
+#define OUTPUT_VISI (2)  // with ParaVis animation
+
+/* Engines that can compute the generations (selected with --engine) */
+#define ENGINE_DENSE (0) // one byte per cell, play_gol
+#define ENGINE_BITS (1)  // one bit per cell in 64-bit words, play_gol_bits
+#define ENGINE_HASHLIFE (2) // hash-consed quadtree jumping 2^k rounds, play_gol_hashlife
+#define ENGINE_SPARSE (3) // sorted arrays of the live cells only, play_gol_sparse
+#define ENGINE_DELTA (4)  // neighbor counts updated around the cells that flip, play_gol_delta
+
+/* How the board is split between threads (argv[4]) */
+#define PARTITION_ROWS (0)  // one band of rows per thread
+#define PARTITION_BLOCKS (1) // one block of a grid of blocks per thread
+#define PARTITION_STEAL (2) // tiles in per-thread deques, idle threads steal
+
+/* What lies beyond the edges of the board (selected with --boundary) */
+#define BOUNDARY_TORUS (0) // the board wraps around
+#define BOUNDARY_DEAD (1)  // everything outside the board is dead
+
+/* Rules the engines have compiled kernels for (selected with --rule);
+ * every other B/S rule runs on the table kernels */
+#define RULE_TABLE (0)    // any rule, looked up in gol_rule.next
+#define RULE_LIFE (1)     // B3/S23
+#define RULE_HIGHLIFE (2) // B36/S23
+#define RULE_DAYNIGHT (3) // B3678/S34678
+#define RULE_SEEDS (4)    // B2/S
+#define RULE_KINDS (5)
+
+/* Widths of the dense engine's row kernels (selected with --kernel) */
+#define KERNEL_SCALAR (0)
+#define KERNEL_SSE2 (1)   // 16 cells per step
+#define KERNEL_AVX2 (2)   // 32 cells per step
+#define KERNELS (3)
+
+/* The phases of a round --trace records (make TRACE=1), each marked at
+ * its end by TRACE_MARK */
+#define TRACE_START (0)   // a batch of rounds starts (no phase ends)
+#define TRACE_COMPUTE (1) // the thread computed its part of the round
+#define TRACE_BARRIER (2) // waited at the first barrier for the slowest thread
+#define TRACE_SERIAL (3)  // thread 0: summed the live counts, handed over the frame
+#define TRACE_HALO (4)    // copied its edges into the halo, refilled its deque
+#define TRACE_RELEASE (5) // waited at the second barrier (for thread 0)
+#define TRACE_COPY (6)    // copied its part of the round for the animation or the recorder
+#define TRACE_PHASES (7)
+#define TRACE_EVENTS (1 << 16) // events a thread's ring holds (a power of two)
+
+// #define SLEEP_USECS  (100) (feel free to change this to be as slow or fast as you'd like)
+#define SLEEP_USECS (100000)
+
+/* one thread's live count of the round it just computed (and with
+ * --cycles the hash of its part of the board the round started from),
+ * alone on its cache line so the threads do not share lines when they
+ * store it */
+struct live_count{
+    long live;
+    uint64_t hash;
+    char pad[64 - sizeof(long) - sizeof(uint64_t)];
+};
+
+/* --cycles: the hashes of the last rounds' boards, by round % (P + 1) */
+struct gol_cycle{
+    uint64_t *hashes;
+    long *rounds;    // the round each hash is of (-1: none)
+    int period;      // the period of the cycle found (0: none)
+    long found;      // the round that repeated the one period before (-1: none)
+    long end;        // the round the batch stops at instead (-1: its own end)
+    long skipped;    // rounds left out since the board was loaded
+};
+
+/* one TRACE_MARK: the phase that ended, when and in which round */
+struct trace_event{
+    long long ns;
+    long round;
+    int phase;
+};
+
+/* one thread's ring of trace events, alone on its cache line */
+struct trace_ring{
+    struct trace_event *events; // TRACE_EVENTS, the newest overwrite the oldest
+    unsigned long next;         // events recorded, the next goes to next % TRACE_EVENTS
+    char pad[64 - sizeof(struct trace_event *) - sizeof(unsigned long)];
+};
+
+/* a barrier that spins for a while before it sleeps: the rounds of a game
+ * are short, so the threads usually meet again within the spin, without
+ * the futex calls of pthread_barrier_wait. Returns like pthread_barrier_wait. */
+struct gol_barrier{
+    int count;           // threads that meet at the barrier
+    int waiting;         // threads that arrived in this generation
+    unsigned generation; // bumped by the last thread to arrive
+    pthread_mutex_t lock; // for the threads that stop spinning and sleep
+    pthread_cond_t wake;
+};
+
+/* what run_gol hands back to the benchmark instead of printing it */
+struct gol_run{
+    double seconds;      // from the first round's start to the last round's end
+    long live;           // live cells after the last round
+    long long *round_ns; // see gol_data.round_ns, now owned by the caller
+};
+
+/* an outer-totalistic rule, parsed from B/S notation by parse_rule */
+struct gol_rule{
+    int birth;          // bit n set: a dead cell with n live neighbors comes alive
+    int survive;        // bit n set: a live cell with n live neighbors stays alive
+    uint8_t next[2][16]; // the same as a table: next[alive][live neighbors] (padded for pshufb)
+    int kind;           // RULE_LIFE, ... or RULE_TABLE
+    char name[24];      // the rule written out, "B3/S23"
+};
+
+struct gol_data{
+    int rows;        // the row dimension
+    int cols;        // the column dimension
+    long iters;      // number of iterations to run the gol simulation
+    int output_mode; // set to:  OUTPUT_NONE, OUTPUT_ASCII, or OUTPUT_VISI
+    uint8_t *world;  // one byte per cell: 1 alive, 0 dead, with a halo border
+    uint8_t *next_world;
+    uint8_t *temp;   // temporary pointer to hold data for when we switch boards
+    int init_cells;
+    int num_threads;
+    int thread_id;
+    int thread_row_start;
+    int thread_row_end;
+    int thread_col_start;
+    int thread_col_end;
+    int partition_yes_no;
+    int partition;   // set to: PARTITION_ROWS, PARTITION_BLOCKS or PARTITION_STEAL
+    int grid_rows;   // PARTITION_BLOCKS: the blocks down the board
+    int grid_cols;   // PARTITION_BLOCKS: the blocks across the board
+    long round;
+    int engine;      // set to: ENGINE_DENSE, ENGINE_BITS, ENGINE_HASHLIFE, ENGINE_SPARSE
+                     // or ENGINE_DELTA
+    int boundary;    // set to: BOUNDARY_TORUS or BOUNDARY_DEAD
+    int stride;      // bytes per row of world: cols plus the two halo columns, padded
+                     // to a cache line (rows start on one, world is aligned)
+    int kernel;      // the dense row kernels: KERNEL_SCALAR, KERNEL_SSE2 or KERNEL_AVX2
+    int strip_cols;  // step_dense_block: columns per strip, set from the L2 size
+    /* bit-packed board used by ENGINE_BITS (bit i of word w in a row is column 64*w + i) */
+    uint64_t *bits_world;
+    uint64_t *bits_next;
+    uint64_t *bits_zero; // an all dead row, above and below a BOUNDARY_DEAD board
+    int words;       // number of 64-bit words per row
+    uint64_t hashlife_nodes; // ENGINE_HASHLIFE keeps its node store near this many nodes
+    struct hl_store *hashlife; // ENGINE_HASHLIFE: the node store, whose tree is the board
+    /* tiles of ENGINE_DENSE, for active-region tracking and PARTITION_STEAL */
+    int tile_size;   // side of a square tile in cells (0: no tiles)
+    int track_tiles; // 1: skip the tiles that cannot change
+    int tile_rows;   // number of tiles down the board
+    int tile_cols;   // number of tiles across the board
+    long *tile_changed[2]; // last round each tile changed, by parity of the round written
+    long *piece_live; // this thread: live cells of each tile piece it owns
+    long tiles_computed; // this thread: tile pieces computed
+    long tiles_skipped;  // this thread: tile pieces skipped
+    long tiles_stolen;   // this thread: tiles taken from other threads' deques
+    struct tile_deque *deques; // PARTITION_STEAL: one deque of tiles per thread
+    long *tile_live; // PARTITION_STEAL: live cells of each tile
+    int temporal_depth; // ENGINE_DENSE: rounds advanced between barriers
+    uint8_t *wave;   // this thread: rows of the rounds inside a temporal block
+    /* live cells of ENGINE_SPARSE (and the cells ENGINE_HASHLIFE builds its
+     * tree from), keys are row * cols + col */
+    uint64_t *sparse_cells; // the cells read from the input file, sorted
+    long sparse_count;
+    long sparse_cap;
+    struct sparse_band *bands; // one band of rows per thread
+    int sparse_now;  // which of a band's two cell arrays is the current round
+    /* ENGINE_DELTA keeps its board in world, 2 * live neighbors + alive per cell */
+    struct delta_band *deltas; // one band of rows per thread, with its flipped cells
+    int delta_now;   // which of a band's two flip lists is the last round's
+    const char *trace_file; // --trace: where the per-round trace goes (NULL: no trace)
+    struct trace_ring *trace; // one ring per thread, NULL when not tracing
+    int cycle_max;   // --cycles: the longest period to stop at (0: do not look)
+    struct gol_cycle *cycle; // shared by the threads, NULL without --cycles
+    struct live_count *live_counts; // one per thread, summed by thread 0 every round
+    long *population; // live cells after each round (-1: round skipped by the engine)
+    const char *population_file; // --population: where to write the population history
+    long long *round_ns; // monotonic ns at the start (0) and the end of round r (r + 1), 0: skipped
+    long history;    // rounds population and round_ns have room for
+    int keep_history; // keep population and round_ns (--population, the benchmark), else NULL
+    int first_batch; // this thread: the first rounds since the board was loaded
+    int first_touch; // --numa: the workers zero (and so place) their part of the dense boards
+    const char *cpu_list; // --cpus: the CPUs to pin the workers to, in order
+    size_t board_bytes; // bytes of world and next_world when first_touch mapped them
+    int checkpoint_every; // --checkpoint: rounds between snapshots (0: none)
+    const char *checkpoint_file; // --checkpoint-file: where the snapshots go
+    int restart;     // --restart: load the checkpoint instead of the board file
+    long rounds;     // --rounds: the rounds to run (-1: as the board file says)
+    int pattern_rows; // --size: the board of an RLE or .cells pattern (0: the pattern's size)
+    int pattern_cols;
+    int offset_row;  // --offset: where the pattern's top left cell goes
+    int offset_col;
+    int offset_set;  // 0: center the pattern
+    double random_density; // --random: the fraction of cells alive on a random board (0: none)
+    unsigned long long random_seed; // --seed: the seed of the random board
+    int random_fill; // this load: alloc_board fills the board at random
+    int hole_row;    // the pattern's rectangle, which the random fill leaves dead
+    int hole_col;
+    int hole_rows;
+    int hole_cols;
+    const char *record_file; // --record: where the generation stream goes (NULL: none)
+    int keyframe_every; // --keyframe: rounds between the stream's whole boards
+    const char *share_name; // --share: the shared memory object the boards go to (NULL: none)
+    int ascii_fit;   // --ascii-fit: scale the ASCII animation down to the terminal
+    int visi_fps;    // --fps: frames a second of the ParaVis animation
+    const char *rule_arg; // --rule (NULL: B3/S23 unless the board file names a rule)
+    struct gol_rule rule; // the rule the board is computed with
+    int cpu;         // this thread: the CPU it ran on at load (print partition)
+    int page_node;   // this thread: the node its part of world is on (-1: unknown)
+    struct gol_sim *sim; // the simulation the thread works for
+    /* fields used by ParaVis library (when run in OUTPUT_VISI mode). */
+    visi_handle handle;
+    color3 *image_buff;
+};
+
+/* a simulation and its pool of worker threads (see libgol.h) */
+struct gol_sim{
+    struct gol_data data;     // the game as loaded, copied to every worker
+    struct gol_data *threads; // each worker's own copy, which it plays
+    pthread_t *workers;
+    void *(*thread_main)(void *); // the engine's game loop
+    struct gol_barrier go;    // the caller and the workers: start rounds
+    struct gol_barrier done;  // the caller and the workers: rounds finished
+    int quit;                 // the workers exit at the next go
+    int loaded;               // a board has been loaded
+    int busy;                 // rounds handed out and not waited for
+    long file_iters;          // the rounds asked for by the loaded file
+    int *cpus;                // the CPUs the workers are pinned to, in turn
+    int num_cpus;
+    int *cpu_node;            // the NUMA node of every CPU
+    int touch;                // place_worker zeroes the worker's part of the boards
+    struct gol_render *render; // the ASCII animation's thread (output mode 1)
+    struct gol_visi *visi;    // the ParaVis animation's thread (output mode 2)
+    struct gol_record *record; // --record: the generation stream's writer thread
+    struct gol_publisher *publisher; // --share: the shared board
+    struct gol_barrier barrier; // the workers: between the phases of every round
+    long live;                // live cells after the last round played
+    long long start_ns;       // monotonic ns at the start of the first round since the load
+    long long end_ns;         // and at the end of the last round played (0: none yet)
+};
+
+/* index of a cell in world/next_world; rows -1 and rows, columns -1 and
+ * cols are the halo around the board */
+static inline size_t dense_index(struct gol_data *data, int row, int col){
+    return (size_t)(row + 1) * data->stride + (col + 1);
+}
+
+/* the next cell of a random board (splitmix64): alive when the draw, a
+ * number in [0, 1), is below the density */
+static inline int draw_alive(unsigned long long *state, double density){
+    unsigned long long x = (*state += 0x9e3779b97f4a7c15ull);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return (x >> 11) * (1.0 / 9007199254740992.0) < density;
+}
+
+/* any cell of a random board, counter-based: cell index (row * cols + col)
+ * gets draw index + 1 from state seed, the board bench draws row by row */
+static inline int random_alive(unsigned long long seed, unsigned long long index, double density){
+    unsigned long long state = seed + index * 0x9e3779b97f4a7c15ull;
+    return draw_alive(&state, density);
+}
+
+/****************** Function Prototypes **********************/
+/* gol.c: game setup, the dense game loop and the worker pool */
+/* read one cell of the current board of any engine */
+int gol_cell(struct gol_data *data, int row, int col);
+/* the time on the monotonic clock in ns */
+long long monotonic_ns(void);
+/* wait for all threads, then note the time the first round starts */
+void start_rounds(struct gol_data *data);
+/* store the calling thread's live count for the round (before the barrier) */
+void publish_live(struct gol_data *data, long cell);
+/* thread 0: note the time the rounds start */
+void note_start(struct gol_data *data);
+/* thread 0: sum the published counts into sim->live and the history */
+void reduce_live(struct gol_data *data, int steps);
+
+/* allocate the engine's board, all cells dead */
+void alloc_board(struct gol_data *data);
+/* get a filled in board ready for its first round */
+void finish_board(struct gol_data *data);
+/* run a job on every worker of the pool and wait for it */
+void run_workers(struct gol_sim *sim, void *(*job)(void *));
+
+/* numa.c: placement of the workers and the dense boards */
+/* parse a CPU list like "0-3,8" */
+int parse_cpu_list(const char *list, int *cpus, int max);
+/* choose the CPUs to pin the workers to */
+int init_placement(struct gol_sim *sim);
+/* allocate a board without touching its pages */
+uint8_t *alloc_untouched(size_t bytes);
+/* free a board from alloc_untouched */
+void free_untouched(uint8_t *board, size_t bytes);
+/* pool job: first-touch the worker's part of the boards, note its CPU */
+void *place_worker(void *arg);
+/* print the CPU and node of every worker */
+void print_placement(struct gol_sim *sim);
+
+/* loader.c: the gol format, RLE and .cells board files */
+/* read a board file */
+int init_game_data_from_file(struct gol_data *data, const char *path);
+/* initialize the gol game state with a random board and no pattern */
+int init_game_data_random(struct gol_data *data);
+/* pool job: fill the worker's part of the board at random */
+void *random_part(void *arg);
+/* collect the random cells the workers drew for the sparse engine */
+void gather_random_cells(struct gol_sim *sim);
+/* set one cell of a board being loaded alive */
+int set_cell(struct gol_data *data, int row, int col);
+
+/* snapshot.c: binary snapshots of the board */
+/* does a file start like a snapshot */
+int is_snapshot(const char *path);
+/* read a snapshot */
+int init_game_data_from_snapshot(struct gol_data *data, const char *path);
+/* write a bit-packed board to a snapshot */
+int save_bits(const char *path, const uint64_t *bits, int rows, int cols, long round,
+              long iters, const char *rule, int boundary);
+
+/* rule.c: B/S rules */
+/* parse a rule in B/S notation */
+int parse_rule(const char *text, struct gol_rule *rule);
+/* can the engine run the rule */
+int check_rule(struct gol_data *data, const struct gol_rule *rule);
+/* take the rule a board file names */
+int use_file_rule(struct gol_data *data, const char *text, const char *path);
+
+/* render.c: the ASCII animation on its own thread */
+/* start the renderer thread */
+int init_render(struct gol_sim *sim);
+/* size the frames for the loaded board */
+void render_board(struct gol_sim *sim);
+/* thread 0: hand the board of the round just computed to the renderer */
+void render_frame(struct gol_data *data);
+/* wait until the frames handed over are drawn */
+void render_drain(struct gol_sim *sim);
+/* stop the renderer thread */
+void free_render(struct gol_sim *sim);
+
+/* visi.c: the ParaVis animation on its own thread */
+/* start the visi thread for the rounds of one run */
+int start_visi(struct gol_sim *sim, long frames);
+/* thread 0: should the workers copy this round for the animation */
+void visi_round(struct gol_data *data, int steps);
+/* every worker: copy its part of the round for the animation */
+void visi_copy(struct gol_data *data);
+/* wait for the visi thread to finish the run's frames */
+void stop_visi(struct gol_sim *sim, long *rounds, long *dropped);
+
+/* record.c: the generation stream (--record FILE) */
+/* open the stream and record the loaded board */
+int start_record(struct gol_sim *sim);
+/* thread 0: take a slot of the ring for the board just computed */
+void record_round(struct gol_data *data);
+/* every worker: pack its part of the board into the slot */
+void record_copy(struct gol_data *data);
+/* write the frames left and the index, close the stream */
+int finish_record(struct gol_sim *sim, int verbose);
+/* the replay mode: one round of a stream as a snapshot */
+int run_replay(int argc, char **argv);
+/* every worker: pack its part of the board, 64 cells a word */
+void pack_part(struct gol_data *data, uint64_t *bits, int words);
+
+/* share.c: the board in shared memory for other processes (--share NAME) */
+/* create the shared memory object and publish the loaded board */
+int start_share(struct gol_sim *sim);
+/* thread 0: mark the shared board as being written */
+void share_round(struct gol_data *data);
+/* every worker: pack its part of the board into it */
+void share_copy(struct gol_data *data);
+/* mark the shared board closed and remove the object */
+void finish_share(struct gol_sim *sim);
+
+/* trace.c: per-round instrumentation (make TRACE=1, --trace FILE) */
+/* allocate and touch one ring of events per thread */
+int init_trace(struct gol_data *data);
+/* forget the events recorded so far */
+void clear_trace(struct gol_data *data);
+/* free the rings */
+void free_trace(struct gol_data *data);
+/* write the Chrome trace, print the phase times and the load imbalance */
+int write_trace(struct gol_sim *sim, int verbose);
+
+/* note the end of a phase of the calling thread's round; nothing at all
+ * unless built with GOL_TRACE */
+#ifdef GOL_TRACE
+static inline void trace_mark(struct gol_data *data, int phase){
+    struct trace_ring *ring;
+    struct trace_event *event;
+
+    if (data->trace == NULL){
+        return;
+    }
+    ring = &data->trace[data->thread_id];
+    event = &ring->events[ring->next++ & (TRACE_EVENTS - 1)];
+    event->ns = monotonic_ns();
+    event->round = data->round;
+    event->phase = phase;
+}
+#define TRACE_MARK(data, phase) trace_mark((data), (phase))
+#else
+#define TRACE_MARK(data, phase) do {} while (0)
+#endif
+
+/* cycle.c: still lifes and oscillators end a run early (--cycles) */
+/* allocate the hashes of the rounds looked back at */
+int init_cycle(struct gol_data *data);
+/* forget the rounds seen so far */
+void clear_cycle(struct gol_data *data);
+/* free the hashes */
+void free_cycle(struct gol_data *data);
+/* hash words keyed by their position on the board */
+uint64_t hash_words(const uint64_t *words, long n, uint64_t key);
+/* every worker: hash its part of the current board */
+void hash_part(struct gol_data *data);
+/* thread 0: combine the hashes, note a repeat and where to stop */
+void cycle_round(struct gol_data *data);
+/* fill in the rounds a cycle left out of a batch */
+void finish_cycle(struct gol_sim *sim);
+
+/* barrier.c: spin-then-block barrier */
+int gol_barrier_init(struct gol_barrier *b, int count);
+int gol_barrier_wait(struct gol_barrier *b);
+void gol_barrier_destroy(struct gol_barrier *b);
+
+/* main.c, bench.c, batch.c, serve.c: the gol program */
+/* run one game as given on the command line */
+int run_gol(int argc, char **argv, struct gol_run *run);
+/* the bench mode: time generated boards over engines and thread counts */
+int run_bench(int argc, char **argv);
+/* the batch mode: many small boards, each played whole by one thread */
+int run_batch(int argc, char **argv);
+/* the server mode: a simulation driven over a Unix domain socket */
+int run_serve(int argc, char **argv);
+/* the client of the server mode */
+int run_client(int argc, char **argv);
+
+/* stencil.c: row-span kernels for the dense engine */
+/* pick the AVX2, SSE2 or scalar kernel of a board (NULL: best the CPU supports) */
+int init_stencil(struct gol_data *data, const char *name);
+/* the name of the board's kernel */
+const char *stencil_name(struct gol_data *data);
+/* compute columns col_start..col_end of one row of next_world */
+long step_dense_row(struct gol_data *data, int row, int col_start, int col_end,
+                    int *changed);
+/* compute the thread's block of next_world in strips that fit in L2 */
+long step_dense_block(struct gol_data *data);
+/* compute one whole row from explicit row pointers */
+long step_span(struct gol_data *data, const uint8_t *up, const uint8_t *mid,
+               const uint8_t *down, uint8_t *out);
+/* pack the alive bits of a row of cells into 64-bit words */
+void pack_dense_row(struct gol_data *data, const uint8_t *cells, uint64_t *bits,
+                    int w_first, int w_last);
+/* copy the edges of an owned rectangle of world into the halo */
+void refresh_halo(struct gol_data *data, int row_start, int row_end,
+                  int col_start, int col_end);
+
+/* tiles.c: active-region tracking for the dense engine */
+/* allocate the per-tile change records */
+int init_tiles(struct gol_data *data);
+/* free the per-tile change records */
+void free_tiles(struct gol_data *data);
+/* compute one round of the thread's rectangle, skipping unchanged tiles */
+long step_dense_tiles(struct gol_data *data);
+/* does a tile have to be computed this round */
+int tile_active(struct gol_data *data, int ty, int tx);
+
+/* temporal.c: temporal blocking for the dense engine */
+/* advance the thread's band of rows several rounds in one pass */
+long step_dense_temporal(struct gol_data *data, int steps);
+
+/* steal.c: work-stealing tile scheduler for the dense engine */
+/* allocate the deques and hand out the tiles */
+int init_steal(struct gol_data *data);
+/* free the deques */
+void free_steal(struct gol_data *data);
+/* put the calling thread's tiles back into its deque */
+void fill_deque(struct gol_data *data);
+/* compute one round from the own deque, then by stealing */
+long step_dense_steal(struct gol_data *data);
+
+/* bitlife.c: bit-packed engine */
+/* allocate the bit-packed boards for ENGINE_BITS */
+int init_bits_world(struct gol_data *data);
+/* set one cell of the bit-packed board alive */
+void set_bits_cell(struct gol_data *data, int row, int col);
+/* read one cell of the bit-packed board */
+int get_bits_cell(struct gol_data *data, int row, int col);
+/* the bit-packed gol game playing loop */
+void *play_gol_bits(void *arg);
+/* one round of up to 64 same-size boards packed into the bits of words */
+void step_lanes(const struct gol_rule *rule, const uint64_t *world, uint64_t *next,
+                int rows, int cols, int boundary);
+
+/* sparse.c: sparse engine */
+/* allocate one band of live cells per thread */
+int init_sparse(struct gol_data *data);
+/* free the bands */
+void free_sparse(struct gol_data *data);
+/* add one cell read from the input file */
+int add_sparse_cell(struct gol_data *data, int row, int col);
+/* sort the cells read from the input file */
+void sort_sparse_cells(struct gol_data *data);
+/* read one cell of the current generation */
+int get_sparse_cell(struct gol_data *data, int row, int col);
+/* copy the live cells of the current generation */
+long get_sparse_cells(struct gol_data *data, uint64_t *out);
+/* hash the calling thread's band of the current generation */
+uint64_t hash_sparse_band(struct gol_data *data);
+/* write the calling thread's band into a bit-packed board */
+void pack_sparse_band(struct gol_data *data, uint64_t *bits, int words);
+/* the sparse gol game playing loop */
+void *play_gol_sparse(void *arg);
+
+/* delta.c: incremental neighbor-count engine */
+/* allocate one band of flip lists per thread */
+int init_delta(struct gol_data *data);
+/* free the bands */
+void free_delta(struct gol_data *data);
+/* fill in the neighbor counts of a loaded board */
+void count_delta_board(struct gol_data *data);
+/* the delta gol game playing loop */
+void *play_gol_delta(void *arg);
+
+/* hashlife.c: HashLife engine */
+/* allocate the node store of a board about to be loaded */
+int init_hashlife(struct gol_data *data);
+/* free the node store */
+void free_hashlife(struct gol_data *data);
+/* build the tree of the board from the loaded cells */
+void build_hashlife(struct gol_data *data);
+/* read one cell of the board */
+int get_hashlife_cell(struct gol_data *data, int row, int col);
+/* copy the live cells of the board */
+long get_hashlife_cells(struct gol_data *data, uint64_t *out);
+/* the HashLife gol game playing loop (runs on thread 0) */
+void *play_gol_hashlife(void *arg);
+
+#endif
@@ -0,0 +1,876 @@
+/*
+ * HashLife engine: the board is a quadtree whose nodes are hash-consed
+ * (every distinct square of cells exists exactly once) and each node
+ * memoizes its RESULT, the center half of the square advanced
+ * 2^(level-2) generations. Patterns that repeat in space or in time are
+ * then computed once, so a run jumps 2^k generations at a time instead of
+ * stepping every cell of every round.
+ *
+ * The board is the root of the tree, a square of side 2^level at least as
+ * large as the board with the cells past the last row and column dead; it
+ * is built from the loaded live cells and is all there is of the board,
+ * so its memory follows the pattern rather than the area of the board.
+ * Cells are only expanded one by one for a snapshot or gol_save.
+ *
+ * The board is a torus, which a quadtree over the infinite plane does not
+ * know about. Each jump of s = 2^k generations therefore covers the board
+ * with output blocks of side 2s; the input of a block is the 4s square
+ * around it read from the (wrapped) board, whose RESULT is exactly that
+ * block s generations later. Equal input squares are the same node, so
+ * blocks whose input is dead are never visited, and the periodic copies
+ * of a small board cost nothing. The output blocks are joined into the
+ * tree of the next board.
+ *
+ * The tree and the memoized results live as long as the board, across
+ * batches and gol_step calls. The store is kept near --hashlife-nodes:
+ * once it is past half the limit after a jump, the nodes the board cannot
+ * reach (and, if that is not enough, the memoized results) are dropped and
+ * the rest moved down so the store shrinks. A jump can only add nodes, so
+ * the jumps start at one round and double while each adds little; a jump
+ * that adds more than half the limit halves the ones after it. The limit
+ * cannot go below the nodes of the board itself.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "gol.h"
+
+#define HL_NONE (0xffffffffu) // no node / no memoized result yet
+#define HL_MAX_LEVEL (40)
+#define HL_MEMO_LEVEL (4)     // build squares of this level or more are memoized
+
+struct hl_node{
+    uint64_t live;           // live cells in the square
+    uint32_t nw, ne, sw, se; // children, level-1 nodes (unused by the leaves)
+    uint32_t result;         // memoized RESULT, HL_NONE if not computed yet
+    uint32_t next;           // next node in the hash chain (or free list)
+    uint8_t level;           // the node is a square of 2^level cells
+    uint8_t mark;            // reached by the garbage collector
+};
+
+/* a memoized square of the board a jump reads: level and top-left cell -> node */
+struct hl_build{
+    long y, x;
+    int level;               // -1: unused slot
+    uint32_t node;
+};
+
+struct hl_store{
+    struct hl_node *nodes;
+    uint32_t capacity;
+    uint32_t count;          // nodes in use, the slots below count
+    uint32_t peak;           // the most nodes there ever were
+    uint32_t *buckets;
+    uint32_t bucket_mask;
+    uint32_t empty[HL_MAX_LEVEL + 1];
+    uint8_t level2_result[1 << 16]; // 4x4 square -> its 2x2 center one generation later
+    uint64_t limit;
+    int max_k;               // log2 of the longest jump allowed next
+    int collections;
+    struct hl_build *builds;
+    uint64_t build_mask;
+    uint64_t build_count;
+    long rows, cols;         // the torus
+    int level;               // the board is a square of side 2^level
+    uint32_t root;           // the board
+    uint32_t old;            // the board the jump being computed reads
+};
+
+/****************** Function Prototypes **********************/
+/* the unique node with these four children */
+static uint32_t hl_join(struct hl_store *hl, uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+/* the RESULT of a node of level 2 or more */
+static uint32_t hl_result(struct hl_store *hl, uint32_t n);
+/* the node of a sorted run of cells given as Morton codes */
+static uint32_t hl_from_cells(struct hl_store *hl, const uint64_t *z, long n, int level);
+/* the square of side 2^level at y, x inside node n of level m */
+static uint32_t hl_extract(struct hl_store *hl, uint32_t n, int m, int level, long y, long x);
+/* the square of side 2^level at y, x of the (wrapped) old board */
+static uint32_t hl_build(struct hl_store *hl, int level, long y, long x);
+/* the cells of a node in its top-left h x w corner, the rest dead */
+static uint32_t hl_clip(struct hl_store *hl, uint32_t n, int level, long h, long w);
+/* is a rectangle of the (wrapped) old board dead */
+static int hl_torus_empty(struct hl_store *hl, long y, long x, long h, long w);
+/* drop every node not reachable from root (and the memoized results
+ * unless keep_results) and move the rest down */
+static void hl_collect(struct hl_store *hl, uint32_t root, int keep_results);
+
+/* allocate the node store of a board about to be loaded (its live cells
+ * go to sparse_cells, build_hashlife turns them into the tree)
+ * data: pointer to gol_data struct with rows, cols and the options set
+ * returns: 0 on success, 1 on error
+ */
+int init_hashlife(struct gol_data *data){
+    struct hl_store *hl;
+    int i;
+
+    hl = calloc(1, sizeof(struct hl_store));
+    if (hl == NULL){
+        return 1;
+    }
+    data->hashlife = hl;
+    hl->limit = data->hashlife_nodes;
+    hl->rows = data->rows;
+    hl->cols = data->cols;
+    hl->capacity = 1 << 16;
+    hl->nodes = malloc(sizeof(struct hl_node) * hl->capacity);
+    hl->bucket_mask = (1 << 17) - 1;
+    hl->buckets = malloc(sizeof(uint32_t) * (hl->bucket_mask + 1));
+    if (hl->nodes == NULL || hl->buckets == NULL){
+        return 1;
+    }
+    memset(hl->buckets, 0xff, sizeof(uint32_t) * (hl->bucket_mask + 1));
+
+    /* node 0 is the dead cell, node 1 the live cell */
+    for (i = 0; i < 2; ++i){
+        hl->nodes[i].nw = hl->nodes[i].ne = hl->nodes[i].sw = hl->nodes[i].se = HL_NONE;
+        hl->nodes[i].result = HL_NONE;
+        hl->nodes[i].next = HL_NONE;
+        hl->nodes[i].level = 0;
+        hl->nodes[i].mark = 0;
+        hl->nodes[i].live = i;
+    }
+    hl->count = 2;
+    hl->empty[0] = 0;
+    for (i = 1; i <= HL_MAX_LEVEL; ++i){
+        hl->empty[i] = hl_join(hl, hl->empty[i - 1], hl->empty[i - 1],
+                               hl->empty[i - 1], hl->empty[i - 1]);
+    }
+    hl->level = 0;
+    while ((1L << hl->level) < hl->rows || (1L << hl->level) < hl->cols){
+        hl->level++;
+    }
+    hl->root = hl->empty[hl->level];
+    return 0;
+}
+
+/* release the node store (nothing if there is none)
+ * data: pointer to gol_data struct
+ * returns: none
+ */
+void free_hashlife(struct gol_data *data){
+    struct hl_store *hl = data->hashlife;
+
+    free(data->sparse_cells);
+    data->sparse_cells = NULL;
+    if (hl == NULL){
+        return;
+    }
+    free(hl->nodes);
+    free(hl->buckets);
+    free(hl->builds);
+    free(hl);
+    data->hashlife = NULL;
+}
+
+/* spread the low 32 bits of v to the even bits */
+static uint64_t hl_spread(uint64_t v){
+    v &= 0xffffffffull;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+    v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+    v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+    v = (v | (v << 2)) & 0x3333333333333333ull;
+    v = (v | (v << 1)) & 0x5555555555555555ull;
+    return v;
+}
+
+static int compare_codes(const void *a, const void *b){
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* turn the loaded live cells (sorted sparse_cells) into the tree of the
+ * board, with the rule the leaves are advanced with (not B0: empty
+ * squares have to stay empty), and let go of the cells
+ * data: pointer to gol_data struct, the rule and the cells loaded
+ * returns: none
+ */
+void build_hashlife(struct gol_data *data){
+    struct hl_store *hl = data->hashlife;
+    int bits, y, x, dy, dx, sum, alive, cells;
+    long i;
+
+    /* one generation of every 4x4 square, bit y*4+x is the cell at y, x */
+    for (bits = 0; bits < (1 << 16); ++bits){
+        cells = 0;
+        for (y = 1; y <= 2; ++y){
+            for (x = 1; x <= 2; ++x){
+                sum = 0;
+                for (dy = -1; dy <= 1; ++dy){
+                    for (dx = -1; dx <= 1; ++dx){
+                        if (dy != 0 || dx != 0){
+                            sum += (bits >> ((y + dy) * 4 + x + dx)) & 1;
+                        }
+                    }
+                }
+                alive = (bits >> (y * 4 + x)) & 1;
+                if (data->rule.next[alive][sum]){
+                    cells |= 1 << ((y - 1) * 2 + (x - 1));
+                }
+            }
+        }
+        hl->level2_result[bits] = cells;
+    }
+
+    /* in Morton order (row and column bits interleaved) the cells of every
+     * square of the tree are a run, its quadrants runs in a row */
+    for (i = 0; i < data->sparse_count; ++i){
+        y = data->sparse_cells[i] / data->cols;
+        x = data->sparse_cells[i] % data->cols;
+        data->sparse_cells[i] = (hl_spread(y) << 1) | hl_spread(x);
+    }
+    qsort(data->sparse_cells, data->sparse_count, sizeof(uint64_t), compare_codes);
+    hl->root = hl_from_cells(hl, data->sparse_cells, data->sparse_count, hl->level);
+    free(data->sparse_cells);
+    data->sparse_cells = NULL;
+    data->sparse_count = 0;
+    data->sparse_cap = 0;
+}
+
+static uint32_t hl_from_cells(struct hl_store *hl, const uint64_t *z, long n, int level){
+    uint32_t q[4];
+    long i, start;
+    int c;
+
+    if (n == 0){
+        return hl->empty[level];
+    }
+    if (level == 0){
+        return 1;
+    }
+    start = 0;
+    for (c = 0; c < 4; ++c){ // nw, ne, sw, se: the quadrant is bits 2 * (level - 1)
+        for (i = start; i < n && (int)((z[i] >> (2 * (level - 1))) & 3) == c; ++i){
+        }
+        q[c] = hl_from_cells(hl, z + start, i - start, level - 1);
+        start = i;
+    }
+    return hl_join(hl, q[0], q[1], q[2], q[3]);
+}
+
+/* read a cell of the board
+ * data: pointer to gol_data struct
+ * row: the row of the cell
+ * col: the column of the cell
+ * returns: 1 if the cell is alive, 0 otherwise
+ */
+int get_hashlife_cell(struct gol_data *data, int row, int col){
+    struct hl_store *hl = data->hashlife;
+    struct hl_node *p;
+    uint32_t n = hl->root;
+    long half, y = row, x = col;
+    int level;
+
+    for (level = hl->level; level > 0; --level){
+        if (n == hl->empty[level]){
+            return 0;
+        }
+        p = &hl->nodes[n];
+        half = 1L << (level - 1);
+        if (y < half){
+            n = (x < half) ? p->nw : p->ne;
+        }
+        else{
+            n = (x < half) ? p->sw : p->se;
+            y -= half;
+        }
+        if (x >= half){
+            x -= half;
+        }
+    }
+    return n == 1;
+}
+
+/* add the keys of the live cells of a node at y, x to out */
+static long hl_cells(struct hl_store *hl, uint32_t n, int level, long y, long x, uint64_t *out){
+    struct hl_node *p = &hl->nodes[n];
+    long half;
+
+    if (n == hl->empty[level]){
+        return 0;
+    }
+    if (level == 0){
+        out[0] = (uint64_t)y * hl->cols + x;
+        return 1;
+    }
+    half = 1L << (level - 1);
+    out += hl_cells(hl, p->nw, level - 1, y, x, out);
+    out += hl_cells(hl, p->ne, level - 1, y, x + half, out);
+    out += hl_cells(hl, p->sw, level - 1, y + half, x, out);
+    hl_cells(hl, p->se, level - 1, y + half, x + half, out);
+    return p->live;
+}
+
+/* copy the live cells of the board, as sorted keys row * cols + col
+ * data: pointer to gol_data struct
+ * out: room for all the cells, or NULL to only count them
+ * returns: the number of live cells
+ */
+long get_hashlife_cells(struct gol_data *data, uint64_t *out){
+    struct hl_store *hl = data->hashlife;
+    long n = hl->nodes[hl->root].live;
+
+    if (out != NULL){
+        hl_cells(hl, hl->root, hl->level, 0, 0, out);
+        qsort(out, n, sizeof(uint64_t), compare_codes);
+    }
+    return n;
+}
+
+static inline uint32_t hl_hash(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se){
+    uint64_t h = nw * 0x9E3779B97F4A7C15ull;
+    h = (h ^ ne) * 0xC2B2AE3D27D4EB4Full;
+    h = (h ^ sw) * 0x165667B19E3779F9ull;
+    h = (h ^ se) * 0x9E3779B97F4A7C15ull;
+    return (uint32_t)(h >> 32);
+}
+
+/* double the hash table once it holds more nodes than buckets */
+static void hl_grow_buckets(struct hl_store *hl){
+    struct hl_node *nodes = hl->nodes;
+    uint32_t i, h;
+
+    hl->bucket_mask = hl->bucket_mask * 2 + 1;
+    free(hl->buckets);
+    hl->buckets = malloc(sizeof(uint32_t) * ((size_t)hl->bucket_mask + 1));
+    if (hl->buckets == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    memset(hl->buckets, 0xff, sizeof(uint32_t) * ((size_t)hl->bucket_mask + 1));
+    for (i = 2; i < hl->count; ++i){
+        h = hl_hash(nodes[i].nw, nodes[i].ne, nodes[i].sw, nodes[i].se) & hl->bucket_mask;
+        nodes[i].next = hl->buckets[h];
+        hl->buckets[h] = i;
+    }
+}
+
+static uint32_t hl_join(struct hl_store *hl, uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se){
+    struct hl_node *p;
+    uint32_t h, n;
+
+    h = hl_hash(nw, ne, sw, se) & hl->bucket_mask;
+    for (n = hl->buckets[h]; n != HL_NONE; n = hl->nodes[n].next){
+        p = &hl->nodes[n];
+        if (p->nw == nw && p->ne == ne && p->sw == sw && p->se == se){
+            return n;
+        }
+    }
+
+    if (hl->count == hl->capacity){
+        if (hl->capacity >= 0x80000000u){
+            printf("Error: hashlife node store is full\n");
+            exit(1);
+        }
+        p = realloc(hl->nodes, sizeof(struct hl_node) * hl->capacity * 2);
+        if (p == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+        hl->nodes = p;
+        hl->capacity *= 2;
+    }
+    n = hl->count++;
+    if (hl->count > hl->peak){
+        hl->peak = hl->count;
+    }
+    p = &hl->nodes[n];
+    p->nw = nw;
+    p->ne = ne;
+    p->sw = sw;
+    p->se = se;
+    p->result = HL_NONE;
+    p->level = hl->nodes[nw].level + 1;
+    p->mark = 0;
+    p->live = hl->nodes[nw].live + hl->nodes[ne].live + hl->nodes[sw].live + hl->nodes[se].live;
+    if (hl->count > hl->bucket_mask){
+        hl_grow_buckets(hl); // links n into its bucket as well
+    }
+    else{
+        p->next = hl->buckets[h];
+        hl->buckets[h] = n;
+    }
+    return n;
+}
+
+/* the 16 cells of a level 2 node as bits y*4+x */
+static int hl_level2_bits(struct hl_store *hl, uint32_t n){
+    struct hl_node *nodes = hl->nodes;
+    uint32_t q[4] = { nodes[n].nw, nodes[n].ne, nodes[n].sw, nodes[n].se };
+    int i, bits, y0, x0;
+
+    bits = 0;
+    for (i = 0; i < 4; ++i){
+        y0 = (i / 2) * 2;
+        x0 = (i % 2) * 2;
+        bits |= nodes[q[i]].nw << (y0 * 4 + x0);
+        bits |= nodes[q[i]].ne << (y0 * 4 + x0 + 1);
+        bits |= nodes[q[i]].sw << ((y0 + 1) * 4 + x0);
+        bits |= nodes[q[i]].se << ((y0 + 1) * 4 + x0 + 1);
+    }
+    return bits;
+}
+
+static uint32_t hl_result(struct hl_store *hl, uint32_t n){
+    uint32_t nw, ne, sw, se, r[9], res;
+    int cells, level = hl->nodes[n].level;
+
+    if (hl->nodes[n].result != HL_NONE){
+        return hl->nodes[n].result;
+    }
+    if (n == hl->empty[level]){
+        res = hl->empty[level - 1];
+    }
+    else if (level == 2){
+        cells = hl->level2_result[hl_level2_bits(hl, n)];
+        res = hl_join(hl, cells & 1, (cells >> 1) & 1, (cells >> 2) & 1, (cells >> 3) & 1);
+    }
+    else{
+        /* nine overlapping squares one level down, each advanced by a
+         * quarter of the step, then four of those advanced once more.
+         * nodes may move when hl_join grows the store, so read through
+         * the index every time. */
+        struct hl_node *nodes;
+
+        nw = hl->nodes[n].nw;
+        ne = hl->nodes[n].ne;
+        sw = hl->nodes[n].sw;
+        se = hl->nodes[n].se;
+        r[0] = hl_result(hl, nw);
+        nodes = hl->nodes;
+        r[1] = hl_result(hl, hl_join(hl, nodes[nw].ne, nodes[ne].nw, nodes[nw].se, nodes[ne].sw));
+        r[2] = hl_result(hl, ne);
+        nodes = hl->nodes;
+        r[3] = hl_result(hl, hl_join(hl, nodes[nw].sw, nodes[nw].se, nodes[sw].nw, nodes[sw].ne));
+        nodes = hl->nodes;
+        r[4] = hl_result(hl, hl_join(hl, nodes[nw].se, nodes[ne].sw, nodes[sw].ne, nodes[se].nw));
+        nodes = hl->nodes;
+        r[5] = hl_result(hl, hl_join(hl, nodes[ne].sw, nodes[ne].se, nodes[se].nw, nodes[se].ne));
+        r[6] = hl_result(hl, sw);
+        nodes = hl->nodes;
+        r[7] = hl_result(hl, hl_join(hl, nodes[sw].ne, nodes[se].nw, nodes[sw].se, nodes[se].sw));
+        r[8] = hl_result(hl, se);
+        nw = hl_result(hl, hl_join(hl, r[0], r[1], r[3], r[4]));
+        ne = hl_result(hl, hl_join(hl, r[1], r[2], r[4], r[5]));
+        sw = hl_result(hl, hl_join(hl, r[3], r[4], r[6], r[7]));
+        se = hl_result(hl, hl_join(hl, r[4], r[5], r[7], r[8]));
+        res = hl_join(hl, nw, ne, sw, se);
+    }
+    hl->nodes[n].result = res;
+    return res;
+}
+
+static uint32_t hl_extract(struct hl_store *hl, uint32_t n, int m, int level, long y, long x){
+    struct hl_node *p;
+    uint32_t nw, ne, sw, se;
+    long half, side = 1L << level;
+
+    /* down the tree while the square lies inside one child */
+    while (m > level && n != hl->empty[m]){
+        half = 1L << (m - 1);
+        if ((y < half && y + side > half) || (x < half && x + side > half)){
+            break;
+        }
+        p = &hl->nodes[n];
+        if (y < half){
+            n = (x < half) ? p->nw : p->ne;
+        }
+        else{
+            n = (x < half) ? p->sw : p->se;
+            y -= half;
+        }
+        if (x >= half){
+            x -= half;
+        }
+        m--;
+    }
+    if (n == hl->empty[m]){
+        return hl->empty[level];
+    }
+    if (m == level){
+        return n;
+    }
+    /* across the children: put it together from its quadrants */
+    half = side / 2;
+    nw = hl_extract(hl, n, m, level - 1, y, x);
+    ne = hl_extract(hl, n, m, level - 1, y, x + half);
+    sw = hl_extract(hl, n, m, level - 1, y + half, x);
+    se = hl_extract(hl, n, m, level - 1, y + half, x + half);
+    return hl_join(hl, nw, ne, sw, se);
+}
+
+/* is the rectangle h x w at y, x of node n (clipped to it) dead */
+static int hl_rect_empty(struct hl_store *hl, uint32_t n, int level, long y, long x, long h, long w){
+    long side = 1L << level, half;
+    uint32_t nw, ne, sw, se;
+
+    if (y < 0){
+        h += y;
+        y = 0;
+    }
+    if (x < 0){
+        w += x;
+        x = 0;
+    }
+    if (h > side - y){
+        h = side - y;
+    }
+    if (w > side - x){
+        w = side - x;
+    }
+    if (h <= 0 || w <= 0 || n == hl->empty[level]){
+        return 1;
+    }
+    if (h == side && w == side){
+        return 0;
+    }
+    half = side / 2;
+    nw = hl->nodes[n].nw;
+    ne = hl->nodes[n].ne;
+    sw = hl->nodes[n].sw;
+    se = hl->nodes[n].se;
+    return hl_rect_empty(hl, nw, level - 1, y, x, h, w)
+        && hl_rect_empty(hl, ne, level - 1, y, x - half, h, w)
+        && hl_rect_empty(hl, sw, level - 1, y - half, x, h, w)
+        && hl_rect_empty(hl, se, level - 1, y - half, x - half, h, w);
+}
+
+/* y mod n, in 0..n-1 */
+static inline long hl_wrap(long y, long n){
+    y %= n;
+    return (y < 0) ? y + n : y;
+}
+
+static int hl_torus_empty(struct hl_store *hl, long y, long x, long h, long w){
+    long ys[2], hs[2], xs[2], ws[2];
+    int i, j;
+
+    if (h >= hl->rows){
+        y = 0;
+        h = hl->rows;
+    }
+    if (w >= hl->cols){
+        x = 0;
+        w = hl->cols;
+    }
+    /* the rows and the columns, each in up to two pieces at the seam */
+    ys[0] = hl_wrap(y, hl->rows);
+    hs[0] = (h < hl->rows - ys[0]) ? h : hl->rows - ys[0];
+    ys[1] = 0;
+    hs[1] = h - hs[0];
+    xs[0] = hl_wrap(x, hl->cols);
+    ws[0] = (w < hl->cols - xs[0]) ? w : hl->cols - xs[0];
+    xs[1] = 0;
+    ws[1] = w - ws[0];
+    for (i = 0; i < 2; ++i){
+        for (j = 0; j < 2; ++j){
+            if (!hl_rect_empty(hl, hl->old, hl->level, ys[i], xs[j], hs[i], ws[j])){
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* forget every memoized square of the board (the board changed) */
+static void hl_clear_builds(struct hl_store *hl){
+    uint64_t i;
+
+    if (hl->builds != NULL){
+        for (i = 0; i <= hl->build_mask; ++i){
+            hl->builds[i].level = -1;
+        }
+    }
+    hl->build_count = 0;
+}
+
+/* find or add a memoized board square; returns its slot */
+static struct hl_build *hl_build_slot(struct hl_store *hl, int level, long y, long x){
+    struct hl_build *old, *slot;
+    uint64_t i, old_mask;
+
+    if (hl->builds == NULL || hl->build_count * 2 >= hl->build_mask){
+        old = hl->builds;
+        old_mask = hl->build_mask;
+        hl->build_mask = (old == NULL) ? (1 << 12) - 1 : hl->build_mask * 2 + 1;
+        hl->builds = malloc(sizeof(struct hl_build) * (hl->build_mask + 1));
+        if (hl->builds == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+        hl_clear_builds(hl);
+        if (old != NULL){
+            for (i = 0; i <= old_mask; ++i){
+                if (old[i].level >= 0){
+                    slot = hl_build_slot(hl, old[i].level, old[i].y, old[i].x);
+                    *slot = old[i];
+                    hl->build_count++;
+                }
+            }
+            free(old);
+        }
+    }
+    i = (((uint64_t)y * 0x9E3779B97F4A7C15ull) ^ ((uint64_t)x * 0xC2B2AE3D27D4EB4Full)
+         ^ (uint64_t)level) * 0x165667B19E3779F9ull >> 20 & hl->build_mask;
+    while (hl->builds[i].level >= 0
+           && (hl->builds[i].level != level || hl->builds[i].y != y || hl->builds[i].x != x)){
+        i = (i + 1) & hl->build_mask;
+    }
+    return &hl->builds[i];
+}
+
+static uint32_t hl_build(struct hl_store *hl, int level, long y, long x){
+    struct hl_build *slot;
+    uint32_t nw, ne, sw, se, n;
+    long half, side = 1L << level;
+
+    y = hl_wrap(y, hl->rows);
+    x = hl_wrap(x, hl->cols);
+    if (y + side <= hl->rows && x + side <= hl->cols){ // no seam in it
+        return hl_extract(hl, hl->old, hl->level, level, y, x);
+    }
+    if (hl_torus_empty(hl, y, x, side, side)){
+        return hl->empty[level];
+    }
+    if (level >= HL_MEMO_LEVEL){
+        slot = hl_build_slot(hl, level, y, x);
+        if (slot->level == level){
+            return slot->node;
+        }
+    }
+    half = side / 2;
+    nw = hl_build(hl, level - 1, y, x);
+    ne = hl_build(hl, level - 1, y, x + half);
+    sw = hl_build(hl, level - 1, y + half, x);
+    se = hl_build(hl, level - 1, y + half, x + half);
+    n = hl_join(hl, nw, ne, sw, se);
+    if (level >= HL_MEMO_LEVEL){
+        slot = hl_build_slot(hl, level, y, x); // the table may have grown meanwhile
+        slot->level = level;
+        slot->y = y;
+        slot->x = x;
+        slot->node = n;
+        hl->build_count++;
+    }
+    return n;
+}
+
+static uint32_t hl_clip(struct hl_store *hl, uint32_t n, int level, long h, long w){
+    uint32_t nw, ne, sw, se;
+    long half;
+
+    if (h <= 0 || w <= 0){
+        return hl->empty[level];
+    }
+    if ((h >= (1L << level) && w >= (1L << level)) || n == hl->empty[level]){
+        return n;
+    }
+    half = 1L << (level - 1);
+    nw = hl_clip(hl, hl->nodes[n].nw, level - 1, h, w);
+    ne = hl_clip(hl, hl->nodes[n].ne, level - 1, h, w - half);
+    sw = hl_clip(hl, hl->nodes[n].sw, level - 1, h - half, w);
+    se = hl_clip(hl, hl->nodes[n].se, level - 1, h - half, w - half);
+    return hl_join(hl, nw, ne, sw, se);
+}
+
+/* the square of side 2^level at y, x of the board 2^k generations on,
+ * put together from the output blocks (of level k + 1) inside it
+ */
+static uint32_t hl_compose(struct hl_store *hl, int level, long y, long x, int k){
+    uint32_t nw, ne, sw, se;
+    long step = 1L << k, side = 1L << level, half;
+
+    if (y >= hl->rows || x >= hl->cols
+        || hl_torus_empty(hl, y - step, x - step, side + 2 * step, side + 2 * step)){
+        return hl->empty[level];
+    }
+    if (level == k + 1){
+        /* the input square starts one step up and left of the block */
+        nw = hl_result(hl, hl_build(hl, k + 2, y - step, x - step));
+        return hl_clip(hl, nw, level, hl->rows - y, hl->cols - x);
+    }
+    half = side / 2;
+    nw = hl_compose(hl, level - 1, y, x, k);
+    ne = hl_compose(hl, level - 1, y, x + half, k);
+    sw = hl_compose(hl, level - 1, y + half, x, k);
+    se = hl_compose(hl, level - 1, y + half, x + half, k);
+    return hl_join(hl, nw, ne, sw, se);
+}
+
+/* mark a node, its children and its memoized result */
+static void hl_mark(struct hl_store *hl, uint32_t n){
+    while (n != HL_NONE && !hl->nodes[n].mark){
+        hl->nodes[n].mark = 1;
+        if (hl->nodes[n].level == 0){
+            return;
+        }
+        hl_mark(hl, hl->nodes[n].nw);
+        hl_mark(hl, hl->nodes[n].ne);
+        hl_mark(hl, hl->nodes[n].sw);
+        hl_mark(hl, hl->nodes[n].se);
+        n = hl->nodes[n].result;
+    }
+}
+
+static void hl_collect(struct hl_store *hl, uint32_t root, int keep_results){
+    struct hl_node *nodes = hl->nodes, *p;
+    uint32_t i, j, h, size;
+    int l;
+
+    if (!keep_results){
+        for (i = 0; i < hl->count; ++i){
+            nodes[i].result = HL_NONE;
+        }
+    }
+    for (l = 0; l <= HL_MAX_LEVEL; ++l){
+        hl_mark(hl, hl->empty[l]);
+    }
+    hl_mark(hl, root);
+
+    /* the marked nodes keep their order, next holds the slot each moves
+     * to; point the children and the results there, then move them down
+     * (a node only moves to a slot at or below its own) */
+    j = 0;
+    for (i = 0; i < hl->count; ++i){
+        if (nodes[i].mark || i < 2){
+            nodes[i].next = j++;
+        }
+    }
+    for (i = 2; i < hl->count; ++i){
+        p = &nodes[i];
+        if (p->mark){
+            p->nw = nodes[p->nw].next;
+            p->ne = nodes[p->ne].next;
+            p->sw = nodes[p->sw].next;
+            p->se = nodes[p->se].next;
+            if (p->result != HL_NONE){
+                p->result = nodes[p->result].next;
+            }
+        }
+    }
+    for (l = 0; l <= HL_MAX_LEVEL; ++l){
+        hl->empty[l] = nodes[hl->empty[l]].next;
+    }
+    hl->root = nodes[root].next;
+    for (i = 0; i < hl->count; ++i){
+        if (nodes[i].mark || i < 2){
+            nodes[i].mark = 0;
+            nodes[nodes[i].next] = nodes[i];
+        }
+    }
+    hl->count = j;
+
+    /* give the room back: twice the nodes left, at least the first store */
+    for (size = 1 << 16; size < 2 * hl->count; size *= 2){
+    }
+    if (size < hl->capacity){
+        p = realloc(hl->nodes, sizeof(struct hl_node) * size);
+        if (p != NULL){
+            hl->nodes = nodes = p;
+            hl->capacity = size;
+        }
+    }
+    if (2 * (size_t)hl->capacity - 1 < hl->bucket_mask){
+        hl->bucket_mask = 2 * hl->capacity - 1;
+        free(hl->buckets);
+        hl->buckets = malloc(sizeof(uint32_t) * ((size_t)hl->bucket_mask + 1));
+        if (hl->buckets == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+    }
+    memset(hl->buckets, 0xff, sizeof(uint32_t) * ((size_t)hl->bucket_mask + 1));
+    for (i = 2; i < hl->count; ++i){
+        h = hl_hash(nodes[i].nw, nodes[i].ne, nodes[i].sw, nodes[i].se) & hl->bucket_mask;
+        nodes[i].next = hl->buckets[h];
+        hl->buckets[h] = i;
+    }
+
+    /* the memoized board squares name nodes that moved */
+    free(hl->builds);
+    hl->builds = NULL;
+    hl->build_mask = 0;
+    hl->build_count = 0;
+    hl->collections++;
+}
+
+/* advance the board by 2^k generations, then keep the store near the
+ * limit and choose how long the next jumps may be
+ * hl: the node store holding the board
+ * k: log2 of the number of generations
+ * returns: none
+ */
+static void hl_jump(struct hl_store *hl, int k){
+    uint32_t out, start = hl->count;
+    int level;
+
+    hl->old = hl->root;
+    hl_clear_builds(hl);
+    if (k + 1 >= hl->level){
+        /* one block covers the board: keep its top-left corner */
+        out = hl_result(hl, hl_build(hl, k + 2, -(1L << k), -(1L << k)));
+        for (level = k + 1; level > hl->level; --level){
+            out = hl->nodes[out].nw;
+        }
+        hl->root = hl_clip(hl, out, hl->level, hl->rows, hl->cols);
+    }
+    else{
+        hl->root = hl_compose(hl, hl->level, 0, 0, k);
+    }
+
+    /* a jump may add half the limit, after one that adds less than a
+     * sixteenth the next may be twice as long */
+    if (hl->count - start > hl->limit / 2){
+        hl->max_k = (k > 0) ? k - 1 : 0;
+    }
+    else if (hl->count - start < hl->limit / 16 && k == hl->max_k && k + 2 < HL_MAX_LEVEL){
+        hl->max_k = k + 1;
+    }
+    if (hl->count > hl->limit / 2){
+        hl_collect(hl, hl->root, 1);
+        if (hl->count > hl->limit / 2){
+            hl_collect(hl, hl->root, 0);
+        }
+    }
+}
+
+/* the HashLife game loop. Runs on thread 0 only (the node store is not
+ * shared between threads); the other threads return right away.
+ *   arg: pointer to a struct gol_data initialized with all GOL game state
+ *  returns: nothing--void function
+ */
+void *play_gol_hashlife(void *arg){
+    struct gol_data *data = ((struct gol_data *)arg);
+    struct hl_store *hl = data->hashlife;
+    long remaining;
+    int k;
+
+    if (data->thread_id != 0){
+        return NULL;
+    }
+    note_start(data);
+    TRACE_MARK(data, TRACE_START);
+    remaining = data->iters - data->round;
+    while (remaining > 0){
+        k = 0;
+        while ((2L << k) <= remaining && k < hl->max_k){
+            k++;
+        }
+        hl_jump(hl, k);
+        remaining -= 1L << k;
+        TRACE_MARK(data, TRACE_COMPUTE); // a jump of 2^k rounds
+        data->round = data->iters - remaining;
+    }
+
+    data->sim->live = hl->nodes[hl->root].live;
+    data->sim->end_ns = monotonic_ns();
+    if (data->iters > 0 && data->population != NULL){ // (iters is the round this batch ends at)
+        data->population[data->iters - 1] = data->sim->live;
+        data->round_ns[data->iters] = data->sim->end_ns;
+    }
+    if (data->partition_yes_no == 1){
+        printf("hashlife: %u nodes in use, %u slots, at most %u nodes, %d collections\n",
+               hl->count, hl->capacity, hl->peak, hl->collections);
+    }
+    return NULL;
+}
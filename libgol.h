@@ -0,0 +1,152 @@
+#ifndef __LIBGOL_H__
+#define __LIBGOL_H__
+
+#include <stdint.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+
+/* libgol: the game of life simulator as a library. A simulation owns a
+ * pool of worker threads, created once by gol_init and pinned to the CPUs
+ * the process may run on, that sleep between calls. Load a board with
+ * gol_load, then advance it any number of times with gol_step; the board
+ * stays in memory between calls.
+ *
+ * A process can run several simulations at once, each with its own
+ * workers, board, rule and kernels. gol_init reads its options with
+ * getopt, so call it from one thread at a time. Errors print a message and
+ * return NULL or 1.
+ *
+ *   struct gol_config config = {4, 0, 0, 0, 2, (char *[]){"--engine", "bits"}};
+ *   struct gol_sim *sim = gol_init(&config);
+ *   gol_load(sim, "board.txt");
+ *   gol_step(sim, 1000);
+ *   printf("%ld\n", gol_population(sim));
+ *   gol_free(sim);
+ */
+
+struct gol_sim;
+
+struct gol_config{
+    int num_threads;     // workers in the pool
+    int partition;       // 0: rows, 1: 2D blocks, 2: work-stealing tiles
+    int output_mode;     // 0: none, 1: ASCII, 2: ParaVis
+    int print_partition; // 1: print each worker's part of the board
+    int argc;            // the --options of the gol command line
+    char **argv;         // (e.g. "--engine", "bits"), argc may be 0
+};
+
+/* create a simulation and start its worker pool */
+struct gol_sim *gol_init(const struct gol_config *config);
+/* read a board file (the gol input format) or a snapshot, replacing the
+ * current board */
+int gol_load(struct gol_sim *sim, const char *path);
+/* advance the board some rounds, returns when they are done */
+int gol_step(struct gol_sim *sim, long rounds);
+/* hand the workers some rounds and return right away */
+int gol_start(struct gol_sim *sim, long rounds);
+/* wait for the rounds handed out by gol_start */
+int gol_wait(struct gol_sim *sim);
+/* the live cells on the board */
+long gol_population(struct gol_sim *sim);
+/* the rounds the board advanced since it was loaded */
+long gol_round(struct gol_sim *sim);
+/* the size of the board */
+int gol_rows(struct gol_sim *sim);
+int gol_cols(struct gol_sim *sim);
+/* copy the board into cells, rows * cols bytes (1 alive, 0 dead) */
+int gol_snapshot(struct gol_sim *sim, uint8_t *cells);
+/* write the board and its round to a snapshot gol_load can read back */
+int gol_save(struct gol_sim *sim, const char *path);
+/* stop the worker pool and free the simulation */
+void gol_free(struct gol_sim *sim);
+
+/* The board of a simulation run with --share NAME, published after every
+ * round into the POSIX shared memory object NAME for any process on the
+ * machine to map. The workers write it in place under a sequence lock:
+ * seq is odd while a board is being written and goes up by 2 with every
+ * board, so readers never block the workers, read the board where it is
+ * and start over when seq changed under them:
+ *
+ *   struct gol_share *share = gol_share_open("/gol");
+ *   do {
+ *       seq = gol_share_begin(share);
+ *       if (seq == GOL_SHARE_CLOSED){
+ *           break;             // the simulation is gone
+ *       }
+ *       live = share->live;    // or gol_share_cell(share, row, col), ...
+ *   } while (gol_share_retry(share, seq));
+ *   gol_share_close(share);
+ *
+ * A board stops changing once its simulation frees it or loads another
+ * board (closed is set, the new board goes to a new object under the same
+ * name), or once the simulation's process dies, maybe in the middle of a
+ * round with seq odd. Then gol_share_begin returns GOL_SHARE_CLOSED rather
+ * than a seq, and gol_share_region returns -1; open the name again for the
+ * next board.
+ */
+#define GOL_SHARE_MAGIC "GOLSHM01"
+#define GOL_SHARE_CLOSED (~(uint64_t)0) // gol_share_begin: the board is gone
+
+struct gol_share{
+    char magic[8];       // GOL_SHARE_MAGIC
+    int32_t rows;
+    int32_t cols;
+    int32_t words;       // 64-bit words per row of board
+    int32_t closed;      // 1: the simulation is gone or loaded another board
+    uint64_t seq;        // odd while the board is being written
+    int64_t round;       // the board after this many rounds
+    int64_t live;        // its live cells
+    int32_t pid;         // the simulation's process
+    int32_t pad[3];      // the board starts on a cache line
+    uint64_t board[];    // rows * words, bit i of word w in a row is column 64 * w + i
+};
+
+/* map the board of a simulation run with --share NAME, read only */
+struct gol_share *gol_share_open(const char *name);
+/* copy a rectangle of the latest board into cells, rows * cols bytes
+ * (1 alive, 0 dead), with the board's round and live cells; returns 1 if
+ * the rectangle is not on the board, -1 if the board is gone */
+int gol_share_region(struct gol_share *share, int row, int col, int rows, int cols,
+                     uint8_t *cells, long *round, long *live);
+/* unmap the board */
+void gol_share_close(struct gol_share *share);
+
+/* 1 when the board will not change again: its simulation let go of it,
+ * or its process is gone (a system call, so not for every read) */
+static inline int gol_share_gone(struct gol_share *share){
+    return __atomic_load_n(&share->closed, __ATOMIC_ACQUIRE)
+           || (kill(share->pid, 0) != 0 && errno == ESRCH);
+}
+
+/* wait for a board that is not being written, returns its seq, or
+ * GOL_SHARE_CLOSED if the board is gone */
+static inline uint64_t gol_share_begin(struct gol_share *share){
+    uint64_t seq;
+    unsigned spins = 0;
+
+    if (__atomic_load_n(&share->closed, __ATOMIC_ACQUIRE)){
+        return GOL_SHARE_CLOSED;
+    }
+    while ((seq = __atomic_load_n(&share->seq, __ATOMIC_ACQUIRE)) & 1){
+        if (++spins % 1024 == 0 && gol_share_gone(share)){
+            return GOL_SHARE_CLOSED; // the writer died in the middle of a board
+        }
+        sched_yield();
+    }
+    return seq;
+}
+
+/* 1 when the board read since gol_share_begin changed meanwhile (0 after
+ * GOL_SHARE_CLOSED, there is nothing more to wait for) */
+static inline int gol_share_retry(struct gol_share *share, uint64_t seq){
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return seq != GOL_SHARE_CLOSED && __atomic_load_n(&share->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/* one cell of the board (read between gol_share_begin and gol_share_retry) */
+static inline int gol_share_cell(struct gol_share *share, int row, int col){
+    return (share->board[(size_t)row * share->words + col / 64] >> (col % 64)) & 1;
+}
+
+#endif
@@ -0,0 +1,542 @@
+/*
+ * Readers for the board files gol_load accepts besides snapshots:
+ *
+ *   the gol format: "rows cols iters count" and then count "row col" pairs
+ *   RLE:            "x = 3, y = 3, rule = B3/S23" and then runs like 2bo$3o!
+ *   .cells:         rows of '.' (dead) and 'O' (alive), '!' comment lines
+ *
+ * RLE and .cells files are recognized by their extension or, failing
+ * that, by their first line. All three are read through one buffered
+ * reader that pulls the file in large chunks and parses the numbers by
+ * hand, which is many times faster than fscanf on files of hundreds of
+ * MB. A pattern only holds the live cells, so the board size, the offset
+ * of the pattern on it and the number of rounds come from --size,
+ * --offset and --rounds. The rule line of an RLE pattern sets the rule
+ * (see rule.c).
+ *
+ * With --random P the board around the pattern (or the whole board, given
+ * as "random") is drawn at random instead of read: every cell is alive
+ * with probability P, drawn from --seed by its index on the board alone
+ * (a counter-based generator), so the workers fill their own parts of it
+ * in parallel and the board is the same for any number of threads.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "gol.h"
+
+#define READ_CHUNK (1 << 20) // bytes read from the file at a time
+
+/* Formats of a board file */
+#define FORMAT_GOL (0)
+#define FORMAT_RLE (1)
+#define FORMAT_CELLS (2)
+
+struct reader{
+    int fd;
+    char *buf;
+    size_t len;  // bytes in buf
+    size_t pos;  // next byte of buf to hand out
+};
+
+/****************** Function Prototypes **********************/
+/* the format of a board file */
+static int board_format(const char *path, struct reader *rd);
+/* open a file for reading in chunks */
+static int open_reader(struct reader *rd, const char *path);
+static void close_reader(struct reader *rd);
+/* start over at the beginning of the file */
+static void rewind_reader(struct reader *rd);
+/* read a number, skipping blanks before it */
+static int read_number(struct reader *rd, long *value);
+/* skip the rest of the line */
+static void skip_line(struct reader *rd);
+/* read the RLE header line */
+static int read_rle_header(struct reader *rd, struct gol_data *data, long *width, long *height,
+                           const char *path);
+/* set the cells of an RLE or .cells body */
+static int read_rle_body(struct reader *rd, struct gol_data *data, int row0, int col0, const char *path);
+static int read_cells_body(struct reader *rd, struct gol_data *data, long *width, long *height,
+                           int row0, int col0, const char *path);
+/* set a cell of the board being read, with an error if it is not on it */
+static int load_cell(struct gol_data *data, long row, long col, const char *path);
+/* place a pattern of width x height on the board */
+static int place_pattern(struct gol_data *data, long width, long height, int *row0, int *col0,
+                         const char *path);
+
+/* the next byte of the file, -1 at the end */
+static inline int next_byte(struct reader *rd){
+    ssize_t n;
+
+    if (rd->pos == rd->len){
+        n = read(rd->fd, rd->buf, READ_CHUNK);
+        if (n <= 0){
+            return -1;
+        }
+        rd->len = n;
+        rd->pos = 0;
+    }
+    return (unsigned char)rd->buf[rd->pos++];
+}
+
+/* the next byte of the file without taking it, -1 at the end */
+static inline int peek_byte(struct reader *rd){
+    int c = next_byte(rd);
+
+    if (c >= 0){
+        rd->pos--;
+    }
+    return c;
+}
+
+/* set one cell of a board being loaded alive
+ * data: pointer to gol_data struct with the board allocated
+ * row: the row of the cell
+ * col: the column of the cell
+ * returns: 0 on success, 1 if the cell is not on the board
+ */
+int set_cell(struct gol_data *data, int row, int col){
+    if (row < 0 || row >= data->rows || col < 0 || col >= data->cols){
+        return 1;
+    }
+    if (data->engine == ENGINE_BITS){
+        set_bits_cell(data, row, col);
+    }
+    else if (data->engine == ENGINE_SPARSE || data->engine == ENGINE_HASHLIFE){
+        return add_sparse_cell(data, row, col);
+    }
+    else{
+        data->world[dense_index(data, row, col)] = 1;
+    }
+    return 0;
+}
+
+/* set_cell for the coordinates read from a file, which may be anything a
+ * long holds: they are checked against the board before they are narrowed
+ * to int, so a huge coordinate is an error rather than a wrapped one
+ * returns: 0 on success, 1 (with a message) if the cell is not on the board
+ */
+static int load_cell(struct gol_data *data, long row, long col, const char *path){
+    if (row < 0 || row >= data->rows || col < 0 || col >= data->cols
+        || set_cell(data, (int)row, (int)col) != 0){
+        printf("Error: cell %ld %ld is not on the board: %s\n", row, col, path);
+        return 1;
+    }
+    return 0;
+}
+
+/* initialize the gol game state from a board file in any of the formats
+ * data: pointer to gol_data struct to initialize, with the options and
+ *       the thread configuration already set
+ * path: name of file to read game config state from
+ * returns: 0 on success, 1 on error
+ */
+int init_game_data_from_file(struct gol_data *data, const char *path){
+    struct reader rd;
+    long rows, cols, iters, count, y, x, width, height;
+    int format, row0, col0, ret;
+    long i;
+
+    if (open_reader(&rd, path) != 0){ // opens the file
+        printf("Error: failed to open file: %s \n", path);
+        return 1;
+    }
+    format = board_format(path, &rd);
+    if (format == FORMAT_GOL && (data->pattern_rows > 0 || data->offset_set || data->random_density > 0)){
+        printf("Error: --size, --offset and --random apply to RLE and .cells patterns: %s\n", path);
+        close_reader(&rd);
+        return 1;
+    }
+    if (format != FORMAT_GOL && data->rounds < 0){
+        printf("Error: patterns do not say how many rounds to run, give --rounds: %s\n", path);
+        close_reader(&rd);
+        return 1;
+    }
+    data->round = 0;
+    ret = 1;
+
+    if (format == FORMAT_GOL){
+        if (read_number(&rd, &rows) != 0 || read_number(&rd, &cols) != 0
+            || read_number(&rd, &iters) != 0 || read_number(&rd, &count) != 0
+            || rows < 1 || rows > 0x7fffffff || cols < 1 || cols > 0x7fffffff
+            || iters < 0 || count < 0 || count > 0x7fffffff){
+            printf("Error: bad board size line: %s\n", path);
+            goto done;
+        }
+        data->rows = rows;
+        data->cols = cols;
+        data->iters = (data->rounds >= 0) ? data->rounds : iters;
+        data->init_cells = count;
+        alloc_board(data);
+        for (i = 0; i < data->init_cells; i++){
+            if (read_number(&rd, &y) != 0 || read_number(&rd, &x) != 0){
+                printf("Error: wrong number of inputs for coordinates: %s\n", path);
+                goto done;
+            }
+            if (load_cell(data, y, x, path) != 0){
+                goto done;
+            }
+        }
+    }
+    else if (format == FORMAT_RLE){
+        if (read_rle_header(&rd, data, &width, &height, path) != 0
+            || place_pattern(data, width, height, &row0, &col0, path) != 0){
+            goto done;
+        }
+        alloc_board(data);
+        if (read_rle_body(&rd, data, row0, col0, path) != 0){
+            goto done;
+        }
+    }
+    else{
+        /* no header: measure the pattern first, unless --size and --offset
+         * say where it goes */
+        width = 0;
+        height = 0;
+        if (data->pattern_rows == 0 || !data->offset_set || data->random_density > 0){
+            if (read_cells_body(&rd, NULL, &width, &height, 0, 0, path) != 0){
+                goto done;
+            }
+            rewind_reader(&rd);
+        }
+        if (place_pattern(data, width, height, &row0, &col0, path) != 0){
+            goto done;
+        }
+        alloc_board(data);
+        if (read_cells_body(&rd, data, &width, &height, row0, col0, path) != 0){
+            goto done;
+        }
+    }
+
+    finish_board(data);
+    ret = 0;
+done:
+    close_reader(&rd); // closes file
+    return ret;
+}
+
+/* initialize the gol game state with a random board and no pattern (the
+ * board file argument "random"): --size cells, --rounds rounds
+ * data: pointer to gol_data struct to initialize, with the options and
+ *       the thread configuration already set
+ * returns: 0 on success, 1 on error
+ */
+int init_game_data_random(struct gol_data *data){
+    if (data->random_density <= 0 || data->pattern_rows == 0 || data->rounds < 0 || data->offset_set){
+        printf("Error: the random board needs --random, --size and --rounds (and no --offset)\n");
+        return 1;
+    }
+    data->rows = data->pattern_rows;
+    data->cols = data->pattern_cols;
+    data->iters = data->rounds;
+    data->init_cells = 0;
+    data->round = 0;
+    data->random_fill = 1;
+    data->hole_rows = 0;
+    data->hole_cols = 0;
+    alloc_board(data);
+    finish_board(data);
+    return 0;
+}
+
+/* pool job run by alloc_board: fill the worker's part of the new board
+ * at random, leaving the pattern's rectangle dead. The workers of the
+ * sparse and the hashlife engine keep their cells in their own
+ * sparse_cells for gather_random_cells (their bands of rows come in order).
+ * arg: the worker's struct gol_data
+ * returns: NULL
+ */
+void *random_part(void *arg){
+    struct gol_data *data = ((struct gol_data *)arg);
+    int r, c, alive;
+
+    data->sparse_cells = NULL;
+    data->sparse_count = 0;
+    data->sparse_cap = 0;
+    for (r = data->thread_row_start; r <= data->thread_row_end; ++r){
+        for (c = data->thread_col_start; c <= data->thread_col_end; ++c){
+            if (r >= data->hole_row && r < data->hole_row + data->hole_rows
+                && c >= data->hole_col && c < data->hole_col + data->hole_cols){
+                c = data->hole_col + data->hole_cols - 1;
+                continue;
+            }
+            /* the draws are no branch to predict: store them either way
+             * (the bits engine's parts are whole words) */
+            alive = random_alive(data->random_seed, (unsigned long long)r * data->cols + c,
+                                 data->random_density);
+            if (data->engine == ENGINE_BITS){
+                data->bits_world[(size_t)r * data->words + c / 64] |= (uint64_t)alive << (c % 64);
+            }
+            else if (data->engine == ENGINE_SPARSE || data->engine == ENGINE_HASHLIFE){
+                if (alive){
+                    add_sparse_cell(data, r, c);
+                }
+            }
+            else{
+                data->world[dense_index(data, r, c)] = alive;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* collect the random cells the workers drew for the sparse and the
+ * hashlife engine into the cells of the board
+ * sim: the simulation, random_part run
+ * returns: none
+ */
+void gather_random_cells(struct gol_sim *sim){
+    struct gol_data *data = &sim->data;
+    long n = 0;
+    int j;
+
+    for (j = 0; j < data->num_threads; ++j){
+        n += sim->threads[j].sparse_count;
+    }
+    data->sparse_cells = malloc(sizeof(uint64_t) * (n + 1));
+    if (data->sparse_cells == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    data->sparse_cap = n + 1;
+    data->sparse_count = 0;
+    for (j = 0; j < data->num_threads; ++j){
+        if (sim->threads[j].sparse_count > 0){
+            memcpy(data->sparse_cells + data->sparse_count, sim->threads[j].sparse_cells,
+                   sizeof(uint64_t) * sim->threads[j].sparse_count);
+            data->sparse_count += sim->threads[j].sparse_count;
+        }
+        free(sim->threads[j].sparse_cells);
+        sim->threads[j].sparse_cells = NULL;
+    }
+}
+
+static int board_format(const char *path, struct reader *rd){
+    const char *dot = strrchr(path, '.');
+    int c;
+
+    if (dot != NULL && strcasecmp(dot, ".rle") == 0){
+        return FORMAT_RLE;
+    }
+    if (dot != NULL && strcasecmp(dot, ".cells") == 0){
+        return FORMAT_CELLS;
+    }
+    /* no telling extension: '#' starts RLE comments, '!' .cells comments,
+     * x the RLE header and '.' or 'O' a .cells row; the gol format is numbers */
+    c = peek_byte(rd);
+    if (c == '#' || c == 'x'){
+        return FORMAT_RLE;
+    }
+    if (c == '!' || c == '.' || c == 'O'){
+        return FORMAT_CELLS;
+    }
+    return FORMAT_GOL;
+}
+
+static int open_reader(struct reader *rd, const char *path){
+    rd->fd = open(path, O_RDONLY);
+    if (rd->fd < 0){
+        return 1;
+    }
+    rd->buf = malloc(READ_CHUNK);
+    if (rd->buf == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    rd->len = 0;
+    rd->pos = 0;
+    return 0;
+}
+
+static void close_reader(struct reader *rd){
+    close(rd->fd);
+    free(rd->buf);
+}
+
+static void rewind_reader(struct reader *rd){
+    lseek(rd->fd, 0, SEEK_SET);
+    rd->len = 0;
+    rd->pos = 0;
+}
+
+static int read_number(struct reader *rd, long *value){
+    int c, negative = 0;
+    long n = 0;
+
+    do {
+        c = next_byte(rd);
+    } while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+    if (c == '-'){
+        negative = 1;
+        c = next_byte(rd);
+    }
+    if (c < '0' || c > '9'){
+        return 1;
+    }
+    while (1){
+        if (n > 0x7fffffffffffL / 10){
+            return 1; // far larger than any board
+        }
+        n = n * 10 + (c - '0');
+        c = peek_byte(rd);
+        if (c < '0' || c > '9'){
+            break; // leave the byte after the number
+        }
+        rd->pos++;
+    }
+    *value = negative ? -n : n;
+    return 0;
+}
+
+static void skip_line(struct reader *rd){
+    int c;
+
+    do {
+        c = next_byte(rd);
+    } while (c >= 0 && c != '\n');
+}
+
+static int read_rle_header(struct reader *rd, struct gol_data *data, long *width, long *height,
+                           const char *path){
+    char line[256], *p, *rule;
+    int c, n;
+
+    /* comment lines (#N name, #C comment, ...) come first */
+    while ((c = peek_byte(rd)) == '#' || c == '\n' || c == '\r'){
+        skip_line(rd);
+    }
+    n = 0;
+    while ((c = next_byte(rd)) >= 0 && c != '\n' && n < (int)sizeof(line) - 1){
+        line[n++] = c;
+    }
+    line[n] = '\0';
+    if (sscanf(line, " x = %ld , y = %ld", width, height) != 2 || *width < 0 || *height < 0){
+        printf("Error: bad RLE header line: %s\n", path);
+        return 1;
+    }
+    rule = strstr(line, "rule");
+    if (rule != NULL){
+        rule = strchr(rule, '=');
+        if (rule == NULL){
+            printf("Error: bad RLE header line: %s\n", path);
+            return 1;
+        }
+        for (rule++; *rule == ' '; rule++);
+        for (p = rule; *p != '\0' && *p != ' ' && *p != ',' && *p != '\r'; p++);
+        *p = '\0';
+        if (use_file_rule(data, rule, path) != 0){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int read_rle_body(struct reader *rd, struct gol_data *data, int row0, int col0, const char *path){
+    long run, row = 0, col = 0, i;
+    int c;
+
+    while ((c = next_byte(rd)) >= 0 && c != '!'){
+        run = 1;
+        if (c >= '0' && c <= '9'){
+            rd->pos--;
+            if (read_number(rd, &run) != 0){
+                printf("Error: bad run count in the RLE body: %s\n", path);
+                return 1;
+            }
+            c = next_byte(rd);
+        }
+        if (c == 'b' || c == '.'){
+            col += run;
+        }
+        else if (c == 'o' || (c >= 'A' && c <= 'X')){ // multi-state files: any state is alive
+            for (i = 0; i < run; ++i, ++col){
+                if (load_cell(data, row0 + row, col0 + col, path) != 0){
+                    return 1;
+                }
+            }
+        }
+        else if (c == '$'){
+            row += run;
+            col = 0;
+        }
+        else if (c == ' ' || c == '\t' || c == '\n' || c == '\r'){
+            continue;
+        }
+        else{
+            printf("Error: unexpected '%c' in the RLE body: %s\n", c, path);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* data NULL only measures the pattern into width and height */
+static int read_cells_body(struct reader *rd, struct gol_data *data, long *width, long *height,
+                           int row0, int col0, const char *path){
+    long row = 0, col = 0;
+    int c;
+
+    while ((c = next_byte(rd)) >= 0){
+        if (c == '!' && col == 0){
+            skip_line(rd); // a comment
+            continue;
+        }
+        if (c == '\n'){
+            row++;
+            col = 0;
+            continue;
+        }
+        if (c == 'O' || c == '*'){
+            if (data == NULL){
+                *width = (col + 1 > *width) ? col + 1 : *width;
+                *height = row + 1;
+            }
+            else if (load_cell(data, row0 + row, col0 + col, path) != 0){
+                return 1;
+            }
+        }
+        else if (c != '.' && c != '\r' && c != ' '){
+            printf("Error: unexpected '%c' in the .cells rows: %s\n", c, path);
+            return 1;
+        }
+        col++;
+    }
+    return 0;
+}
+
+/* size the board (--size, or just the pattern) and put the pattern's top
+ * left corner at --offset, or in the middle of the board */
+static int place_pattern(struct gol_data *data, long width, long height, int *row0, int *col0,
+                         const char *path){
+    if (data->pattern_rows > 0){
+        data->rows = data->pattern_rows;
+        data->cols = data->pattern_cols;
+    }
+    else if (width > 0 && height > 0 && width <= 0x7fffffff && height <= 0x7fffffff){
+        data->rows = height;
+        data->cols = width;
+    }
+    else{
+        printf("Error: empty pattern, give the board --size: %s\n", path);
+        return 1;
+    }
+    if (data->offset_set){
+        *row0 = data->offset_row;
+        *col0 = data->offset_col;
+    }
+    else{
+        *row0 = (data->rows > height) ? (data->rows - height) / 2 : 0;
+        *col0 = (data->cols > width) ? (data->cols - width) / 2 : 0;
+    }
+    data->iters = data->rounds;
+    data->init_cells = 0;
+    data->random_fill = (data->random_density > 0);
+    data->hole_row = *row0;
+    data->hole_col = *col0;
+    data->hole_rows = height;
+    data->hole_cols = width;
+    return 0;
+}
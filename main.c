@@ -6,68 +6,28 @@
  * ./gol file1.txt  0  # run with config file file1.txt, do not print board
  * ./gol file1.txt  1  # run with config file file1.txt, ascii animation
  * ./gol file1.txt  2  # run with config file file1.txt, ParaVis animation
+ * (followed by: num_threads partition[0,1] print_partition[0,1] [options])
+ * ./gol file1.txt 0 4 0 0 --engine bits  # bit-packed engine, 64 cells per word
+ * ./gol huge.txt 0 4 0 0 --engine sparse  # store the live cells only
+ * ./gol gun.rle 0 4 0 0 --size 500x500 --rounds 1000  # an RLE or .cells pattern
+ * ./gol random 0 8 0 0 --size 50000x50000 --random 0.3 --rounds 100  # a random board
+ * ./gol batch --seeds 1-10000 --lanes  # many small random boards, one line each
+ * ./gol gun.rle 0 4 0 0 --size 500x500 --rounds 1000 --record gun.rec  # every round to gun.rec
+ * ./gol replay gun.rec 700 gun700.snap  # the board after round 700, gol loads it
+ * ./gol serve /tmp/gol.sock /gol big.txt 4 0 --engine bits  # play on command, boards in /gol
+ * ./gol client /tmp/gol.sock step 100  # ... 100 rounds, reply when done
  *
  */
-#include <pthreadGridVisi.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
-#include <sys/time.h>
-#include <time.h>
 #include <string.h>
 #include <pthread.h>
-#include "colors.h"
-
-/****************** Definitions **********************/
-/* Three possible modes in which the GOL simulation can run */
-#define OUTPUT_NONE (0)  // with no animation
-#define OUTPUT_ASCII (1) // with ascii animation
-#define OUTPUT_VISI (2)  // with ParaVis animation
-
-// #define SLEEP_USECS  (100) (feel free to change this to be as slow or fast as you'd like)
-#define SLEEP_USECS (100000)
-
-static int total_live = 0;
-
-struct gol_data{
-    int rows;        // the row dimension
-    int cols;        // the column dimension
-    int iters;       // number of iterations to run the gol simulation
-    int output_mode; // set to:  OUTPUT_NONE, OUTPUT_ASCII, or OUTPUT_VISI
-    int *world;      // hard coded as blank, not sure how to make this dynamic
-    int *next_world;
-    int *temp;       // temporary pointer to hold data for when we switch boards
-    int init_cells;
-    int num_threads;
-    int thread_id;
-    int thread_row_start;
-    int thread_row_end;
-    int thread_col_start;
-    int thread_col_end;
-    int partition_yes_no;
-    int round;
-    /* fields used by ParaVis library (when run in OUTPUT_VISI mode). */
-    visi_handle handle;
-    color3 *image_buff;
-};
+#include "gol.h"
 
 /****************** Function Prototypes **********************/
-/* making an arrtay that each partition should have*/
-int *number_partition(struct gol_data *data, char **argv);
-/* the main gol game playing loop (prototype must match this) */
-void *play_gol(void *arg);
-/* init gol data from the input file and run mode cmdline args */
-int init_game_data_from_args(struct gol_data *data, char **argv);
-/* print board to the terminal (for OUTPUT_ASCII mode) */
-void print_board(struct gol_data *data, int round);
-/* set the color of the cell if they are alive or dead*/
-void update_colors(void *arg);
-/* set the cell to alive or dead based on the alive live numbers and the rules*/
-int set_cell_cond(struct gol_data *data, int alive_cells, int x, int y);
-/* dynamically init matrix from the input file */
-void init_matrix(struct gol_data *data);
-/* examine the board to see how many cells are alive surrounding one cell */
-int check_alive_cells(struct gol_data *data, int cell_x, int cell_y);
+/* write the live cells after every round to the --population file */
+int write_population(struct gol_data *data);
 /************ Definitions for using ParVisi library ***********/
 /* initialization for the ParaVisi library (DO NOT MODIFY) */
 int setup_animation(struct gol_data *data);
@@ -75,531 +35,286 @@ int setup_animation(struct gol_data *data);
 /* name for visi (you may change the string value if you'd like) */
 static char visi_name[] = "GOL!";
 
-static pthread_barrier_t barrierTime;
-// initializing mutex
-static pthread_mutex_t my_mutex;
-
 int main(int argc, char **argv){
 
-    struct gol_data data;
-    struct timeval start_time, stop_time; // time struct
-    double secs, altogether, micro_secs;
-    int ret;
-    int r = 0;
-    int j = 0;
-
     /* check number of command line arguments */
 
-    if (argc != 6){
-        printf("usage: %s <infile.txt> <output_mode>[0|1|2] \
-num_threads partition[0,1] print_partition[0,1]\n",
+    if (argc > 1 && strcmp(argv[1], "bench") == 0){
+        return run_bench(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "batch") == 0){
+        return run_batch(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "replay") == 0){
+        return run_replay(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "serve") == 0){
+        return run_serve(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "client") == 0){
+        return run_client(argc, argv);
+    }
+    if (argc < 6){
+        printf("usage: %s <infile.txt|.rle|.cells> <output_mode>[0|1|2] \
+num_threads partition[0,1,2] print_partition[0,1] [options]\n",
                argv[0]);
         printf("arg[2] Output mode: 0: no visualization, 1: ASCII, 2: ParaVisi\n");
         printf("arg[3] Number of threads\n");
-        printf("arg[4] Partition flag: 0: row wise, 1: column wise\n");
+        printf("arg[4] Partition flag: 0: row wise, 1: 2D blocks (a grid chosen \
+from the threads and the board), \
+2: work-stealing tiles (dense engine)\n");
         printf("arg[5] Print partition: 0: don't print configuration info,\
-1: print allocation info\n");
+1: print allocation info and where each thread runs\n");
+        printf("options:\n");
+        printf("  --engine dense|bits|hashlife|sparse|delta  dense: one byte per cell (default), \
+bits: bit-packed 64 cells per word, hashlife: memoized quadtree, jumps 2^k rounds, \
+sparse: live cells only, for huge mostly empty boards, \
+delta: neighbor counts kept up to date, visits only the cells around the ones that flip\n");
+        printf("  --fps N  output mode 2: frames a second of the animation, \
+the rounds in between are skipped (default 10)\n");
+        printf("  --ascii-fit  output mode 1: scale the board down to the terminal \
+(a character is alive when any cell under it is)\n");
+        printf("  --rule B3/S23  the rule in B/S notation, e.g. B36/S23 (default: the \
+rule line of an RLE pattern, or B3/S23)\n");
+        printf("  --kernel avx2|sse2|scalar  dense row kernel, default: \
+widest the CPU supports\n");
+        printf("  --boundary torus|dead  wrap around the board edges (default) \
+or treat cells outside the board as dead\n");
+        printf("  --active-tiles N  dense engine: cut the board into NxN tiles \
+and skip the ones that cannot change (0: off)\n");
+        printf("  --temporal-depth K  dense engine, row partition: advance each band \
+K rounds between barriers (default 1)\n");
+        printf("  --population FILE  write the number of live cells after every \
+round to FILE\n");
+        printf("  --cycles P  stop early when the board repeats with a period of at \
+most P rounds (1: still life) and skip to the board the run would end on\n");
+        printf("  --trace FILE  write every round's compute, barrier wait and serial \
+phases by thread to FILE (Chrome trace format) and print the load imbalance \
+(needs gol built with make TRACE=1)\n");
+        printf("  --record FILE  write the board of every round to FILE, delta-encoded \
+and compressed by a thread of its own (not with hashlife, temporal blocking or --cycles)\n");
+        printf("  --keyframe N  --record: store the whole board every N rounds, \
+for replay to seek to (default 64)\n");
+        printf("  --share NAME  publish the board of every round in the POSIX shared memory \
+object NAME (like /gol) for other processes to map, see libgol.h (not with hashlife, \
+temporal blocking or --cycles)\n");
+        printf("  --hashlife-nodes N  hashlife keeps its node store near N nodes, dropping memoized results and shortening its jumps to stay there \
+(default 4194304)\n");
+        printf("  --checkpoint N  save a binary snapshot of the board every N rounds \
+(gol can load a snapshot instead of a board file)\n");
+        printf("  --checkpoint-file FILE  where to save it (default: the board file \
+with .ckpt added)\n");
+        printf("  --restart  start from the checkpoint when there is one\n");
+        printf("  --rounds N  the rounds to run (needed for RLE and .cells patterns, \
+overrides the count in a gol board file or a snapshot)\n");
+        printf("  --size RxC  the board an RLE or .cells pattern is put on \
+(default: the pattern's size)\n");
+        printf("  --offset R,C  the board cell the pattern's top left corner goes to \
+(default: the pattern centered)\n");
+        printf("  --random P  draw the board around the pattern at random, each cell \
+alive with probability P, in parallel (give the board file as random for no pattern; \
+needs --size and --rounds)\n");
+        printf("  --seed N  the seed of the random board, the same board for any \
+number of threads (default 1)\n");
+        printf("  --cpus LIST  pin the workers to these CPUs in turn, e.g. 0-3,8 \
+(default: the CPUs the process may use)\n");
+        printf("  --numa  spread the workers over the NUMA nodes and let each one \
+first-touch its part of the dense boards\n");
+        printf("or: %s bench [bench options]  time generated boards, see %s bench --help\n",
+               argv[0], argv[0]);
+        printf("or: %s batch [batch options] [files]  play many small boards, one per \
+thread, see %s batch --help\n", argv[0], argv[0]);
+        printf("or: %s replay <stream> <round> <snapshot>  write the board of a round \
+of a --record stream as a snapshot\n", argv[0]);
+        printf("or: %s serve <socket> <shm name> <board> num_threads partition [options]  play \
+the board on commands to a Unix domain socket, see %s serve\n", argv[0], argv[0]);
+        printf("or: %s client <socket> <command>  send a command to a server\n", argv[0]);
         exit(1);
     }
+    return run_gol(argc, argv, NULL);
+}
 
-    /* Initialize game state (all fields in data) from information
-     * read from input file */
-    ret = init_game_data_from_args(&data, argv);
-    if (ret != 0){
-        printf("Initialization error: file %s, mode %s, threads %s, partition %s, print partition %s\n",
-               argv[1], argv[2], argv[3], argv[4], argv[5]);
-        exit(1);
-    }
-    /* Initialize mutex and barrier */
-    if (pthread_mutex_init(&my_mutex, NULL)){
-        printf("pthread_mutex_init error\n");
-        exit(1);
-    }
-    if (pthread_barrier_init(&barrierTime, NULL, data.num_threads)){
-        printf("pthread_barrier_init error\n");
-        exit(1);
-    }
-    int *result = number_partition(&data, argv); // partitioning info
-    pthread_t *thread_array = malloc(data.num_threads * sizeof(pthread_t));
-    if (!thread_array){
-        perror("malloc: pthread_t array");
-        exit(1);
-    }
-    struct gol_data *thread_ids = malloc(data.num_threads * sizeof(struct gol_data));
-    if (!thread_ids){
-        perror("malloc: pthread_t array");
+/* run one game: read the board, run the rounds on the library's worker
+ * pool, report the result.
+ * argc, argv: the command line (five positional arguments and the options)
+ * run: NULL to print the time and the live cells, or where to store them
+ *      (and the round times) without printing anything
+ * returns: 0 on success (errors exit)
+ */
+int run_gol(int argc, char **argv, struct gol_run *run){
+
+    struct gol_config config;
+    struct gol_sim *sim;
+    struct gol_data *data;
+    char *default_checkpoint = NULL;
+    const char *board, *checkpoint;
+    int j;
+    long start, steps, rounds, dropped;
+
+    config.output_mode = atoi(argv[2]);
+    config.num_threads = atoi(argv[3]);
+    config.partition = atoi(argv[4]);
+    config.print_partition = atoi(argv[5]);
+    config.argc = argc - 6; // the --options follow the positional arguments
+    config.argv = argv + 6;
+
+    /* Read the optional flags and start the workers */
+    sim = gol_init(&config);
+    if (sim == NULL){
         exit(1);
     }
 
-    /* initialize ParaVisi animation (if applicable) */
-    if (data.output_mode == OUTPUT_VISI)
-    {
-        setup_animation(&data);
+    data = &sim->data;
+    if (run != NULL){
+        data->keep_history = 1; // the benchmark wants the time of every round
     }
 
-    /* Invoke play_gol in different ways based on the run mode */
-    if (data.output_mode == OUTPUT_NONE || data.output_mode == OUTPUT_ASCII) { // run with no animation
-        for (j = 0; j < data.num_threads; j++){ // create thread ids
-            data.thread_id = j;
-            if (atoi(argv[4]) == 1){
-                data.thread_col_start = result[r];
-                data.thread_col_end = result[r + 1];
-                data.thread_row_start = 0;
-                data.thread_row_end = data.rows - 1;
-            }
-            else{
-                data.thread_row_start = result[r];
-                data.thread_row_end = result[r + 1];
-                data.thread_col_start = 0;
-                data.thread_col_end = data.cols - 1;
-            }
-            r += 2;
-            thread_ids[j] = data;}
-
-        ret = gettimeofday(&start_time, NULL);
-        for (j = 0; j < data.num_threads; j++){
-            ret = pthread_create(&thread_array[j], NULL, play_gol, &thread_ids[j]);
-            if (ret){ 
-                perror("Error pthread_create\n"); 
-                exit(1);
-            } //checks to see if the thread is valid
-        }
-        for (j = 0; j < data.num_threads; j++){
-            pthread_join(thread_array[j], NULL);
+    /* the checkpoint: --checkpoint-file or the board file with .ckpt added */
+    checkpoint = data->checkpoint_file;
+    if (checkpoint == NULL){
+        default_checkpoint = malloc(strlen(argv[1]) + 6);
+        if (default_checkpoint == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
         }
-        ret = gettimeofday(&stop_time, NULL);
+        sprintf(default_checkpoint, "%s.ckpt", argv[1]);
+        checkpoint = default_checkpoint;
     }
-
-    else { //output visi w/ animation
-        for (j = 0; j < data.num_threads; j++){ // create thread ids
-            data.thread_id = j;
-            if (atoi(argv[4]) == 1){
-                data.thread_col_start = result[r];
-                data.thread_col_end = result[r + 1];
-                data.thread_row_start = 0;
-                data.thread_row_end = data.rows - 1;
-            }
-            else{
-                data.thread_row_start = result[r];
-                data.thread_row_end = result[r + 1];
-                data.thread_col_start = 0;
-                data.thread_col_end = data.cols - 1;
-            }
-            r += 2;
-            thread_ids[j] = data;
-            ret = pthread_create(&thread_array[j], NULL, play_gol, &thread_ids[j]);
-            if (ret){ 
-                perror("Error pthread_create\n"); 
-                exit(1);
-            } //checks to see if the thread is valid
-        }
-        run_animation(data.handle, data.iters);
-        for (j = 0; j < data.num_threads; j++){
-            pthread_join(thread_array[j], NULL);
-        }
-    
+    board = argv[1];
+    if (data->restart && access(checkpoint, R_OK) == 0){
+        board = checkpoint; // resume where the last checkpoint left off
     }
 
-    if (data.output_mode != OUTPUT_VISI){
-        secs = 0.0;
-        micro_secs = 0.0;
-        altogether = 0.0;
-        secs = stop_time.tv_sec - start_time.tv_sec;
-        micro_secs = stop_time.tv_usec / 1000000.0 - start_time.tv_usec / 1000000.0;
-        altogether = secs + micro_secs;
-        fprintf(stdout, "Total time: %0.3f seconds\n", altogether);
-        fprintf(stdout, "Number of live cells after %d rounds: %d\n\n",
-                data.iters, total_live);
-    }
-    free(thread_ids);
-    free(thread_array);
-    free(result);
-    free(data.world);
-    free(data.next_world);
-    if (pthread_barrier_destroy(&barrierTime) != 0)
-    {
-        perror("Error destroying mutex.\n");
+    /* Initialize game state (all fields in data) from information
+     * read from input file (or the checkpoint to restart from) */
+    if (gol_load(sim, board) != 0){
+        printf("Initialization error: file %s, mode %s, threads %s, partition %s, print partition %s\n",
+               argv[1], argv[2], argv[3], argv[4], argv[5]);
         exit(1);
     }
-    if (pthread_mutex_destroy(&my_mutex) != 0)
-    {
-        perror("Error destroying mutex.\n");
-        exit(1);
+    if (board == checkpoint && run == NULL){
+        printf("Restarting from round %ld: %s\n", gol_round(sim), checkpoint);
     }
-    return 0;
-}
 
-/* figures out how to spilt up the function for the board printing/playing
- * data: pointer to gol_data struct to initialize
- * argv: command line args
- * returns: result, an array of ints with partitioning information 
- */
-int *number_partition(struct gol_data *data, char **argv){
-    int num_threads = atoi(argv[3]);
-    int *result = malloc(sizeof(int) * num_threads);
-    int *final_result = malloc(sizeof(int) * num_threads * 2);
-    int partition, left_over;
-    int count = 0;
-    int result_count = 0;
-    if (atoi(argv[4]) == 0)
-    {
-        partition = data->rows / num_threads;
-        left_over = data->rows % num_threads;
+    if (data->partition_yes_no == 1 && data->engine == ENGINE_DENSE){
+        printf("kernel: %s, rule %s%s\n", stencil_name(data), data->rule.name,
+               (data->rule.kind == RULE_TABLE) ? " (table)" : "");
     }
-    else
-    {
-        partition = data->cols / num_threads;
-        left_over = data->cols % num_threads;
-    }
-    for (int i = 0; i < num_threads; i++)
-    {
-        result[i] = partition;
-    }
-    if (left_over != 0)
-    {
-        for (int j = 0; j < left_over; j++)
-        {
-            result[j] = result[j] + 1;
-        }
-    }
-    final_result[0] = 0;
-    for (int x = 1; x < num_threads * 2; ++x)
+
+    start = gol_round(sim);
+    /* initialize ParaVisi animation (if applicable), drawn by a thread
+     * of its own at --fps */
+    if (data->output_mode == OUTPUT_VISI)
     {
-        if (x % 2 == 0)
-        {
-            count += 1;
-            final_result[x] = count;
-        }
-        else
-        {
-            count += result[result_count] - 1;
-            final_result[x] = count;
-            result_count++;
+        setup_animation(data);
+        if (start_visi(sim, sim->file_iters - start) != 0){
+            exit(1);
         }
     }
-    free(result);
-    return final_result;
-}
-
-/* initialize the gol game state from command line arguments
- *       argv[1]: name of file to read game config state from
- *       argv[2]: run mode value
- *       argv[3]: the number of threads
- *       argv[4]: the direction of partition
- *       argv[5]: print the partition
- * data: pointer to gol_data struct to initialize
- * argv: command line args
- *       argv[1]: name of file to read game config state from
- *       argv[2]: run mode
- *       argv[3]: the number of threads
- *       argv[4]: the direction of partition
- *       argv[5]: print the partition
- * returns: 0 on success, 1 on error
- */
-int init_game_data_from_args(struct gol_data *data, char **argv){
-    FILE *infile;
-    int ret, cell_x, cell_y, i;
-
-    infile = fopen(argv[1], "r"); // opens the file
-
-    // checking input validity
-    if (infile == NULL){
-        printf("Error: failed to open file: %s \n", argv[1]);
-        exit(1);
-    }
-
-    if (atoi(argv[2]) < 0 || atoi(argv[2]) > 2){ // checking output validity
-        printf("Error: invalid output mode: %s \n", argv[1]);
-        exit(1);
-    }
 
-    if ((atoi(argv[3]) < 0)){ // checking thread validity
-        printf("Error: invalid number of threads: %s \n", argv[1]);
-        exit(1);
+    if (data->checkpoint_every > 0){
+        /* batches that end on multiples of the interval, a snapshot after each */
+        while (gol_round(sim) < sim->file_iters){
+            steps = data->checkpoint_every - gol_round(sim) % data->checkpoint_every;
+            if (steps > sim->file_iters - gol_round(sim)){
+                steps = sim->file_iters - gol_round(sim);
+            }
+            if (gol_step(sim, steps) != 0 || gol_save(sim, checkpoint) != 0){
+                exit(1);
+            }
+        }
     }
     else{
-        data->num_threads = atoi(argv[3]);
-    }
-
-    if (atoi(argv[4]) < 0 || atoi(argv[4]) > 1){ // checking partition validity
-        printf("Error: invalid partition mode: %s \n", argv[1]);
-        exit(1);
-    }
-
-    if (atoi(argv[5]) < 0 || atoi(argv[5]) > 1){ // checking print partition validity
-        printf("Error: invalid print partition mode: %s \n", argv[1]);
-        exit(1);
+        /* play all the rounds the file asks for in one batch */
+        if (gol_start(sim, sim->file_iters - start) != 0){
+            exit(1);
+        }
+        if (data->output_mode == OUTPUT_VISI){ //output visi w/ animation
+            run_animation(data->handle, sim->file_iters - start);
+        }
+        gol_wait(sim);
     }
-    else{
-        data->partition_yes_no = atoi(argv[5]);
+    if (data->output_mode == OUTPUT_VISI){
+        stop_visi(sim, &rounds, &dropped);
+        printf("Animation: %ld rounds, %ld skipped at %d frames a second\n",
+               rounds, dropped, data->visi_fps);
     }
 
-    ret = fscanf(infile, "%d%d%d%d", &(data->rows), &(data->cols), &(data->iters), &(data->init_cells));
-
-    if (ret != 4){
-        printf("fscanf error");
-        exit(1);
+    if (run != NULL){
+        run->seconds = (sim->end_ns - sim->start_ns) / 1e9;
+        run->live = sim->live;
+        run->round_ns = data->round_ns;
+        data->round_ns = NULL; // now the caller's
     }
-
-    data->world = malloc(sizeof(int) * (data->rows) * (data->cols));
-    if (data->world == NULL){
-        printf("Error: malloc failed\n");
-        exit(1);
+    else if (data->output_mode != OUTPUT_VISI){
+        // from the moment all threads are running to the end of the last round
+        fprintf(stdout, "Total time: %0.3f seconds\n", (sim->end_ns - sim->start_ns) / 1e9);
+        fprintf(stdout, "Number of live cells after %ld rounds: %ld\n\n",
+                data->iters, sim->live);
     }
-    data->next_world = malloc(sizeof(int) * (data->rows) * (data->cols));
-    if (data->next_world == NULL){
-        printf("Error: malloc failed\n");
+    if (data->population_file != NULL && write_population(data) != 0){
+        printf("Error: failed to write the population to: %s\n", data->population_file);
         exit(1);
     }
-
-    init_matrix(data);
-    for (i = 0; i < data->init_cells; i++){
-        ret = fscanf(infile, "%d%d", &cell_y, &cell_x);
-        if (ret == 2){
-            data->world[(data->cols) * cell_y + cell_x] = 1;
-        }
-        else{
-            printf("Error: wrong number of inputs for coordinates: %s\n", argv[1]);
-            exit(1);
-        }
+    if (data->cycle != NULL && data->cycle->found >= 0 && run == NULL){
+        printf("Cycle: the board after %ld rounds repeats the one after %ld (period %d), \
+%ld rounds skipped\n", data->cycle->found, data->cycle->found - data->cycle->period,
+               data->cycle->period, data->cycle->skipped);
     }
-
-    ret = fclose(infile); // closes file
-    if (ret != 0){
-        printf("Error: failed to close the file: %s\n", argv[1]);
+    if (data->trace_file != NULL && write_trace(sim, run == NULL) != 0){
+        printf("Error: failed to write the trace to: %s\n", data->trace_file);
         exit(1);
     }
-    if (atoi(argv[2]) >= 0 && atoi(argv[2]) <= 3){
-        data->output_mode = atoi(argv[2]); // checks to see if the input for
-    }                                      // printing is correct, else it exits the program
-    else{
-        printf("Error: mode not correct: %s\n", argv[2]);
+    if (finish_record(sim, run == NULL) != 0){
         exit(1);
     }
-    data->round = 0;
-    // successfull termination
-    return 0;
-}
-
-/* initialize two matrices using the row and columns stored in data
- * data: pointer to gol_data struct to initialize
- * returns: none
- */
-void init_matrix(struct gol_data *data){
-    int i, j;
-
-    for (i = 0; i < data->rows; ++i)
-    {
-        for (j = 0; j < data->cols; ++j)
-        {
-            data->world[i * data->cols + j] = 0;
+    if (data->partition == PARTITION_STEAL){
+        for (j = 0; j < data->num_threads && run == NULL; j++){
+            fprintf(stdout, "tid %d: tiles processed: %ld (stolen %ld)\n", j,
+                    sim->threads[j].tiles_computed + sim->threads[j].tiles_skipped,
+                    sim->threads[j].tiles_stolen);
         }
     }
-    for (i = 0; i < data->rows; ++i)
-    {
-        for (j = 0; j < data->cols; ++j)
-        {
-            data->next_world[i * data->cols + j] = 0;
+    if (data->track_tiles && run == NULL){
+        long computed = 0, skipped = 0;
+        for (j = 0; j < data->num_threads; j++){
+            computed += sim->threads[j].tiles_computed;
+            skipped += sim->threads[j].tiles_skipped;
         }
+        fprintf(stdout, "Tiles skipped: %ld of %ld (%0.1f%%)\n", skipped, computed + skipped,
+                (computed + skipped) ? 100.0 * skipped / (computed + skipped) : 0.0);
     }
+    gol_free(sim);
+    free(default_checkpoint);
+    return 0;
 }
 
-/* the gol application main loop function:
- *  runs rounds of GOL,
- *    * updates program state for next round (world and total_live)
- *    * performs any animation step based on the output/run mode
- *    * uses threading to partition the game 
- *
- *   data: pointer to a struct gol_data  initialized with
- *         all GOL game playing state
- *  returns: nothing--void function 
- */
-
-void *play_gol(void *arg){
-    struct gol_data *data = ((struct gol_data *)arg);
-    int x, y, alive_cells, cell, round_cell, row_difference, col_difference, ret1, ret2;
-    cell = 0;
-    row_difference = data->thread_row_end - data->thread_row_start + 1;
-    col_difference = data->thread_col_end - data->thread_col_start + 1;
-    if (data->partition_yes_no == 1){ //checks to print partition info
-        printf("tid %d: rows: %d:%d (%d) cols: %d:%d (%d)\n", data->thread_id, data->thread_row_start, data->thread_row_end, row_difference,
-               data->thread_col_start, data->thread_col_end, col_difference);
-    }
-    while (data->round < data->iters){
-        for (x = data->thread_row_start; x <= data->thread_row_end; ++x){
-            for (y = data->thread_col_start; y <= data->thread_col_end; ++y){
-                alive_cells = check_alive_cells(data, x, y);
-                round_cell = set_cell_cond(data, alive_cells, x, y);
-                cell += round_cell;
-            }
-        }
-        pthread_mutex_lock(&my_mutex); // lock so that only one thread accesses global variable
-        total_live += cell;
-        pthread_mutex_unlock(&my_mutex); // unlock after one thread chaanges total_live
-        data->temp = data->world;        // swapping worlds around
-        data->world = data->next_world;
-        data->next_world = data->temp;
-
-
-        ret1 = pthread_barrier_wait(&barrierTime);
-        if(ret1 != 0 && ret1 != PTHREAD_BARRIER_SERIAL_THREAD) {
-            perror("pthread_barrier_wait");
-            exit(1);
-            }
-        if (data->thread_id == 0){
-            if(data->output_mode == 1){
-                system("clear");
-                print_board(data, data->round);
-                usleep(SLEEP_USECS);
-            }
-            if(data->round < data->iters-1){
-                pthread_mutex_lock(&my_mutex); // lock so that only one thread accesses global variable
-                total_live = 0;
-                pthread_mutex_unlock(&my_mutex);
-            } // unlock after one thread chaanges total_live
-        }
-        ret2 = pthread_barrier_wait(&barrierTime);
-        if(ret2 != 0 && ret2 != PTHREAD_BARRIER_SERIAL_THREAD) {
-            perror("pthread_barrier_wait");
-            exit(1);
-            }
-        if (data->output_mode == 2){
-            update_colors(data);
-            draw_ready(data->handle);
-            usleep(SLEEP_USECS);
-            
-        }
-        cell = 0;
-        round_cell = 0;
-        data->round += 1;
-    }
-    return NULL;
-}
-
-/* make a cell alive or dead based on the alive_cells and rules
- * data: pointer to gol_data struct to initialize
- * alive_cells: the number of alive cells that is surrounding the cell
- * x: the x coordinate of a cell
- * y: the y coordinate of a cell
- * returns: the number (int) of alive cells on the matrix
- */
-
-int set_cell_cond(struct gol_data *data, int alive_cells, int x, int y){
-    int cell;
-    cell = 0;
-    if (data->world[x * data->cols + y] == 0){
-        if (alive_cells == 3){
-            data->next_world[x * data->cols + y] = 1;
-            cell++;
-        }
-        else{
-            data->next_world[x * data->cols + y] = 0;
-        }
-    }
-    else if (data->world[x * data->cols + y] == 1){
-        if (alive_cells == 0 || alive_cells == 1){
-            data->next_world[x * data->cols + y] = 0;
-        }
-        if (alive_cells == 2 || alive_cells == 3){
-            data->next_world[x * data->cols + y] = 1;
-            cell++;
-        }
-        if (alive_cells >= 4){
-            data->next_world[x * data->cols + y] = 0;
-        }
-    }
-    return cell;
-}
-
-/* check how many cells are alive surrounding a cell
- * data: pointer to gol_data struct to initialize
- * cell_x: the x coordinate of a cell
- * cell_y: the y coordinate of a cell
- * returns: the number (int) of alive cells that surrounds a cell
- */
-int check_alive_cells(struct gol_data *data, int cell_x, int cell_y){
-    int alive, i, j, cell_row, cell_col;
-    alive = 0;
-    for (i = -1; i < 2; i++){
-        for (j = -1; j < 2; j++){
-            if (i == 0 && j == 0){
-                continue;
-            }
-            cell_row = (cell_y + i + data->rows) % (data->rows);
-            cell_col = (cell_x + j + data->cols) % (data->cols);
-            if (data->world[cell_col * data->cols + cell_row] == 1){
-                alive++;
-            }
-        }
-    }
-    return alive;
-}
-
-/* Print the board to the terminal.
+/* write the population history, one "round live_cells" line for every
+ * round the engine computed (rounds are numbered from 1)
  *   data: gol game specific data
- *   round: the current round number
+ *   returns: 0 on success, 1 on error
  */
-void print_board(struct gol_data *data, int round){
+int write_population(struct gol_data *data){
+    FILE *outfile;
+    long i;
 
-    int i, j;
-    /* Print the round number. */
-    fprintf(stderr, "Round: %d\n", round+1);
-
-    for (i = 0; i < data->rows; ++i){
-        for (j = 0; j < data->cols; ++j){
-            if (data->world[i * data->rows + j] == 1){// have to use math formula
-                fprintf(stderr, " @"); // if its 1 print @ else print .
-            }
-            else{
-                fprintf(stderr, " .");
-            }
-        }
-        fprintf(stderr, "\n");
+    outfile = fopen(data->population_file, "w");
+    if (outfile == NULL){
+        return 1;
     }
-    if (round == 0){
-        total_live = data->init_cells;
-    }
-    /* Print the total number of live cells. */
-    fprintf(stderr, "Live cells: %d\n\n", total_live);
-}
-
-/* Describes how the pixels in the image buffer should be
- * colored based on the data in the grid.
- * data: pointer to gol_data struct to initialize
- * returns: none
- * 
- */
-
-void update_colors(void *arg){
-    struct gol_data *data = ((struct gol_data *)arg); 
-    int i, j, r, c, index, buff_i;
-    color3 *buff;
-
-    buff = data->image_buff;  // just for readability
-    r = data->thread_row_end;
-    c = data->thread_col_end;
-
-    for (i = data->thread_row_start; i <= r; ++i){
-            for (j = data->thread_col_start; j <= c; ++j){
-                index = i*data->cols + j;//indxing the array 
-                buff_i = (data->rows - (i+1))*data->cols + j;
-        
-            if (data->world[index] == 1){
-            // update animation buffer
-                buff[buff_i] = c3_black;
-            }
-            else {
-                buff[buff_i] = colors[(data->thread_id)%8];
-            }
+    for (i = 0; i < data->iters; ++i){
+        if (data->population[i] >= 0){
+            fprintf(outfile, "%ld %ld\n", i + 1, data->population[i]);
         }
     }
+    return fclose(outfile) != 0;
 }
 
 /**********************************************************/
 /* initialize ParaVisi animation */
 int setup_animation(struct gol_data *data){
     /* connect handle to the animation */
-    int num_threads = data->num_threads;
+    int num_threads = 1; // only the visi thread draws (see visi.c)
     data->handle = init_pthread_animation(num_threads, data->rows,
                                           data->cols, visi_name);
     if (data->handle == NULL)
@@ -0,0 +1,264 @@
+/*
+ * Placement of the worker pool on NUMA machines. The workers are pinned to
+ * the CPUs of the process's affinity mask, to a list given with --cpus, or
+ * (with --numa) to the CPUs of all nodes in turn, so that neighboring
+ * workers spread over the sockets. With --numa the dense boards are left
+ * untouched when they are allocated and every worker zeroes its own part
+ * of world and next_world: Linux places a page on the node of the CPU
+ * that first writes it, so each worker's rows end up in its local memory.
+ *
+ * The nodes are read from /sys/devices/system/node; without it every CPU
+ * counts as node 0.
+ */
+#define _GNU_SOURCE // sched_getcpu, CPU_SET
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "gol.h"
+
+/****************** Function Prototypes **********************/
+/* set node_of[cpu] for the CPUs of one node's cpulist file */
+static void read_node(int node, int *node_of);
+/* the node holding the page of an address (-1: unknown) */
+static int page_node(const void *addr);
+/* zero rows r0..r1, columns c0..c1 of a dense board (halo coordinates) */
+static void zero_part(struct gol_data *data, uint8_t *board, int r0, int r1, int c0, int c1);
+
+/* parse a CPU list like "0-3,8,10-11"
+ * list: the list
+ * cpus: where to store the CPUs, in the order given
+ * max: room in cpus
+ * returns: the number of CPUs, -1 on error
+ */
+int parse_cpu_list(const char *list, int *cpus, int max){
+    const char *p = list;
+    char *end;
+    long first, last, cpu;
+    int n = 0;
+
+    while (*p != '\0' && *p != '\n'){
+        first = strtol(p, &end, 10);
+        if (end == p || first < 0){
+            return -1;
+        }
+        last = first;
+        if (*end == '-'){
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first){
+                return -1;
+            }
+        }
+        for (cpu = first; cpu <= last; ++cpu){
+            if (n == max || cpu >= CPU_SETSIZE){
+                return -1;
+            }
+            cpus[n++] = (int)cpu;
+        }
+        p = end;
+        if (*p == ','){
+            p++;
+        }
+        else if (*p != '\0' && *p != '\n'){
+            return -1;
+        }
+    }
+    return n;
+}
+
+/* decide which CPU each worker is pinned to: the --cpus list, or the
+ * CPUs of the affinity mask, taken node by node in turn with --numa
+ * sim: the simulation, with the options parsed
+ * returns: 0 on success, 1 on error
+ */
+int init_placement(struct gol_sim *sim){
+    struct gol_data *data = &sim->data;
+    cpu_set_t mask;
+    DIR *dir;
+    struct dirent *entry;
+    int *allowed;
+    int num_allowed = 0;
+    int i, n, node, max_node, taken;
+
+    sim->cpus = malloc(sizeof(int) * CPU_SETSIZE);
+    sim->cpu_node = malloc(sizeof(int) * CPU_SETSIZE);
+    allowed = malloc(sizeof(int) * CPU_SETSIZE);
+    if (sim->cpus == NULL || sim->cpu_node == NULL || allowed == NULL){
+        printf("Error: malloc failed\n");
+        free(allowed);
+        return 1;
+    }
+    for (i = 0; i < CPU_SETSIZE; ++i){
+        sim->cpu_node[i] = 0;
+    }
+    max_node = 0;
+    dir = opendir("/sys/devices/system/node");
+    if (dir != NULL){
+        while ((entry = readdir(dir)) != NULL){
+            if (sscanf(entry->d_name, "node%d", &node) == 1){
+                read_node(node, sim->cpu_node);
+                max_node = (node > max_node) ? node : max_node;
+            }
+        }
+        closedir(dir);
+    }
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0){
+        for (i = 0; i < CPU_SETSIZE; ++i){
+            if (CPU_ISSET(i, &mask)){
+                allowed[num_allowed++] = i;
+            }
+        }
+    }
+
+    sim->num_cpus = 0;
+    if (data->cpu_list != NULL){
+        n = parse_cpu_list(data->cpu_list, sim->cpus, CPU_SETSIZE);
+        if (n <= 0){
+            printf("Error: invalid cpu list: %s\n", data->cpu_list);
+            free(allowed);
+            return 1;
+        }
+        for (i = 0; i < n; ++i){
+            if (num_allowed > 0 && !CPU_ISSET(sim->cpus[i], &mask)){
+                printf("Error: cpu %d is not available to this process\n", sim->cpus[i]);
+                free(allowed);
+                return 1;
+            }
+        }
+        sim->num_cpus = n;
+    }
+    else if (data->first_touch){
+        /* one CPU of every node in turn: the i-th CPU of node 0, of node 1, ... */
+        for (taken = 0; sim->num_cpus < num_allowed; ++taken){
+            for (node = 0; node <= max_node; ++node){
+                n = 0;
+                for (i = 0; i < num_allowed; ++i){
+                    if (sim->cpu_node[allowed[i]] == node && n++ == taken){
+                        sim->cpus[sim->num_cpus++] = allowed[i];
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    else{
+        for (i = 0; i < num_allowed; ++i){
+            sim->cpus[sim->num_cpus++] = allowed[i];
+        }
+    }
+    free(allowed);
+    return 0;
+}
+
+static void read_node(int node, int *node_of){
+    char path[64], line[4096];
+    int cpus[CPU_SETSIZE];
+    FILE *infile;
+    int i, n;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    infile = fopen(path, "r");
+    if (infile == NULL){
+        return;
+    }
+    if (fgets(line, sizeof(line), infile) != NULL){
+        n = parse_cpu_list(line, cpus, CPU_SETSIZE);
+        for (i = 0; i < n; ++i){
+            node_of[cpus[i]] = node;
+        }
+    }
+    fclose(infile);
+}
+
+/* allocate a dense board without touching its pages (zeroed by the
+ * workers in place_worker)
+ * bytes: the size of the board
+ * returns: the board, NULL on error
+ */
+uint8_t *alloc_untouched(size_t bytes){
+    void *board = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (board == MAP_FAILED) ? NULL : board;
+}
+
+/* free a board from alloc_untouched */
+void free_untouched(uint8_t *board, size_t bytes){
+    if (board != NULL){
+        munmap(board, bytes);
+    }
+}
+
+/* pool job run by gol_load: with --numa zero the worker's own part of the
+ * dense boards (sim->touch is set), then note the CPU the worker runs on
+ * and the node its part of world ended up on
+ * arg: the worker's struct gol_data
+ * returns: NULL
+ */
+void *place_worker(void *arg){
+    struct gol_data *data = ((struct gol_data *)arg);
+    int r0, r1, c0, c1;
+
+    /* the part in halo coordinates: the edge workers own the halo too */
+    r0 = (data->thread_row_start == 0) ? -1 : data->thread_row_start;
+    r1 = (data->thread_row_end == data->rows - 1) ? data->rows : data->thread_row_end;
+    c0 = (data->thread_col_start == 0) ? -1 : data->thread_col_start;
+    c1 = (data->thread_col_end == data->cols - 1) ? data->cols : data->thread_col_end;
+    if (data->sim->touch && data->world != NULL && r0 <= r1 && c0 <= c1){
+        zero_part(data, data->world, r0, r1, c0, c1);
+        if (data->next_world != NULL){ // (the delta engine has one board)
+            zero_part(data, data->next_world, r0, r1, c0, c1);
+        }
+    }
+    data->cpu = sched_getcpu();
+    data->page_node = -1;
+    if (data->world != NULL && r0 <= r1 && c0 <= c1){
+        data->page_node = page_node(data->world + dense_index(data, r0 + 1, c0 + 1));
+    }
+    return NULL;
+}
+
+static void zero_part(struct gol_data *data, uint8_t *board, int r0, int r1, int c0, int c1){
+    int i;
+
+    for (i = r0; i <= r1; ++i){
+        memset(board + dense_index(data, i, c0), 0, c1 - c0 + 1);
+    }
+}
+
+static int page_node(const void *addr){
+    void *pages[1];
+    int status[1];
+
+    pages[0] = (void *)((uintptr_t)addr & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1));
+    status[0] = -1;
+    /* move_pages with no target nodes only reports where the pages are */
+    if (syscall(SYS_move_pages, 0, 1, pages, NULL, status, 0) != 0){
+        return -1;
+    }
+    return (status[0] >= 0) ? status[0] : -1;
+}
+
+/* print where every worker runs (print partition mode)
+ * sim: the simulation, after place_worker ran
+ */
+void print_placement(struct gol_sim *sim){
+    struct gol_data *data;
+    int j;
+
+    for (j = 0; j < sim->data.num_threads; j++){
+        data = &sim->threads[j];
+        printf("tid %d: cpu %d node %d", j, data->cpu,
+               (data->cpu >= 0 && data->cpu < CPU_SETSIZE) ? sim->cpu_node[data->cpu] : -1);
+        if (data->world != NULL && data->page_node >= 0){
+            printf(", world pages on node %d", data->page_node);
+        }
+        else if (data->world != NULL){
+            printf(", world pages on node ?");
+        }
+        printf("\n");
+    }
+}
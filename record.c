@@ -0,0 +1,658 @@
+/*
+ * The generation stream (--record FILE): every board from the one loaded
+ * to the last round, bit-packed, delta-encoded against the board before it
+ * and compressed, for looking at long runs afterwards. The workers only
+ * pack their own part of each board into a slot of a ring (after the
+ * second barrier, like visi_copy) and the last one done publishes it; a
+ * writer thread of its own takes the slots in order, encodes and
+ * compresses them and writes them out. Compression is zlib's fastest level
+ * matching runs of one byte only: the XORed words are mostly zero bytes,
+ * and it is several times faster than looking for longer matches. The
+ * ring holds as many boards as fit in RECORD_RING_BYTES and is lock-free,
+ * a count of frames published and one of frames taken: thread 0 only
+ * waits, between the barriers, when every slot is still taken, so the
+ * rounds run at full speed as long as the writer keeps up (a burst of
+ * busy rounds fills the ring, the quiet ones after it drain it). Packing
+ * is the workers' only extra work: a copy of the bit-packed board, a
+ * movemask per 32 cells of the dense one.
+ *
+ * The stream is a header (the board, the rule, the boundary), one frame
+ * per board and an index:
+ *
+ *   RECORD_KEY:   the whole board, (cols + 63) / 64 words per row, bit i
+ *                 of word w column 64 * w + i (the layout of the bits engine)
+ *   RECORD_DELTA: the words that changed since the board before, as runs:
+ *                 the unchanged words skipped and the changed words (LEB128
+ *                 numbers), then the changed words XORed with the old ones
+ *
+ * The first frame and every board a multiple of --keyframe rounds in are
+ * keyframes, and so is any board that changed too much for a delta to be
+ * smaller. Each frame's body is compressed on its own. At the end the
+ * offsets of the keyframes and a trailer pointing at them are appended, so
+ * a reader seeks to the keyframe at or before a round and applies the
+ * deltas after it (gol replay). Numbers are stored in the byte order of
+ * the machine that wrote the stream.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+#include "gol.h"
+
+#define RECORD_MAGIC "GOLREC01"
+#define RECORD_INDEX_MAGIC "GOLRIDX1"
+#define RECORD_KEY (1)   // the whole board
+#define RECORD_DELTA (2) // runs of changed words
+#define RECORD_RING_BYTES (64 << 20) // the ring holds as many boards as fit in this
+#define RECORD_MIN_SLOTS (2)
+#define RECORD_MAX_SLOTS (64)
+
+struct record_header{
+    char magic[8];     // RECORD_MAGIC
+    uint32_t boundary; // BOUNDARY_TORUS or BOUNDARY_DEAD
+    uint32_t keyframe; // rounds between keyframes
+    int64_t rows;
+    int64_t cols;
+    int64_t first_round; // the round of the first frame (a restart starts later)
+    int64_t iters;     // the rounds the run was asked for in all
+    char rule[24];     // the rule the boards were computed with, "B3/S23"
+};
+
+struct record_frame{
+    uint32_t kind;     // RECORD_KEY or RECORD_DELTA
+    uint32_t pad;
+    int64_t round;     // the board after this many rounds
+    int64_t live;      // its live cells
+    uint64_t raw_bytes; // the body before compression
+    uint64_t packed_bytes; // the body as written
+};
+
+struct record_key{
+    int64_t round;
+    int64_t offset;    // of its struct record_frame in the stream
+};
+
+struct record_trailer{
+    char magic[8];     // RECORD_INDEX_MAGIC
+    int64_t keys;      // struct record_key entries in the index
+    int64_t index_offset;
+    int64_t frames;
+    int64_t last_round;
+};
+
+/* one board in the ring */
+struct record_slot{
+    uint64_t *board;    // packed, words words per row
+    long round;
+    long live;
+};
+
+struct gol_record{
+    pthread_t thread;
+    FILE *outfile;
+    const char *path;
+    struct record_slot *slots;
+    int num_slots;
+    unsigned long head; // frames the writer took, the next is head % num_slots
+    unsigned long tail; // frames published by the workers
+    int copying;        // the workers pack the round they just computed
+    long copy_round;
+    long copy_live;
+    int copies_left;    // workers still packing, the last one publishes
+    int quit;           // no more frames, the writer drains the ring and exits
+    int words;          // words of a row
+    size_t frame_words; // words of a board
+    int keyframe;       // rounds between keyframes
+    uint64_t *prev;     // the writer's copy of the board before
+    uint8_t *body;      // a frame's body before compression
+    uint8_t *packed;    // and after
+    size_t packed_cap;
+    z_stream zs;
+    struct record_key *keys;
+    long num_keys;
+    long cap_keys;
+    int64_t offset;     // bytes written so far
+    long frames;
+    long last_round;
+    int error;          // a write failed, the stream is not usable
+    unsigned long long raw_total; // the boards' bytes, bit-packed
+    long stalls;        // rounds thread 0 waited for a free slot
+};
+
+/****************** Function Prototypes **********************/
+/* pool job: pack the worker's part of the loaded board, the first frame */
+static void *record_part(void *arg);
+/* the writer thread */
+static void *record_main(void *arg);
+/* encode, compress and write one board */
+static void write_frame(struct gol_record *rec, const uint64_t *board, long round, long live);
+/* the runs of words that changed since the board before, -1 when they
+ * take as much room as the board */
+static long encode_delta(struct gol_record *rec, const uint64_t *board);
+/* write bytes to the stream, noting a failure */
+static void put_bytes(struct gol_record *rec, const void *bytes, size_t n);
+/* read one number of a delta body */
+static int get_number(const uint8_t *body, size_t len, size_t *at, uint64_t *value);
+/* sleep a little while waiting on the ring */
+static void ring_wait(void);
+
+/* start recording a newly loaded board: open the stream, start the writer
+ * thread and hand it the loaded board as the first frame
+ * sim: the simulation, with a board loaded and split between the workers
+ * returns: 0 on success, 1 on error
+ */
+int start_record(struct gol_sim *sim){
+    struct gol_data *data = &sim->data;
+    struct gol_record *rec;
+    struct record_header header;
+    size_t body_cap;
+    int i;
+
+    rec = calloc(1, sizeof(struct gol_record));
+    if (rec == NULL){
+        printf("Error: malloc failed\n");
+        return 1;
+    }
+    rec->path = data->record_file;
+    rec->words = (data->cols + 63) / 64;
+    rec->frame_words = (size_t)rec->words * data->rows;
+    rec->keyframe = data->keyframe_every;
+    rec->last_round = data->round;
+    /* a delta is only kept while it is smaller than the board, plus room
+     * for the numbers of the run it stops in */
+    body_cap = sizeof(uint64_t) * rec->frame_words + 32;
+    rec->num_slots = RECORD_RING_BYTES / (sizeof(uint64_t) * rec->frame_words + 1);
+    if (rec->num_slots < RECORD_MIN_SLOTS){
+        rec->num_slots = RECORD_MIN_SLOTS;
+    }
+    if (rec->num_slots > RECORD_MAX_SLOTS){
+        rec->num_slots = RECORD_MAX_SLOTS;
+    }
+    rec->slots = calloc(rec->num_slots, sizeof(struct record_slot));
+    if (rec->slots == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    for (i = 0; i < rec->num_slots; ++i){
+        rec->slots[i].board = malloc(sizeof(uint64_t) * rec->frame_words);
+        if (rec->slots[i].board == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+    }
+    rec->prev = calloc(rec->frame_words, sizeof(uint64_t));
+    rec->body = malloc(body_cap);
+    if (rec->prev == NULL || rec->body == NULL || deflateInit2(&rec->zs, Z_BEST_SPEED, Z_DEFLATED, 15, 8, Z_RLE) != Z_OK){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    rec->packed_cap = deflateBound(&rec->zs, body_cap);
+    rec->packed = malloc(rec->packed_cap);
+    if (rec->packed == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    rec->outfile = fopen(rec->path, "wb");
+    if (rec->outfile == NULL){
+        printf("Error: failed to open file: %s\n", rec->path);
+        deflateEnd(&rec->zs);
+        for (i = 0; i < rec->num_slots; ++i){
+            free(rec->slots[i].board);
+        }
+        free(rec->slots);
+        free(rec->prev);
+        free(rec->body);
+        free(rec->packed);
+        free(rec);
+        return 1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+    snprintf(header.rule, sizeof(header.rule), "%s", data->rule.name);
+    header.boundary = data->boundary;
+    header.keyframe = rec->keyframe;
+    header.rows = data->rows;
+    header.cols = data->cols;
+    header.first_round = data->round;
+    header.iters = sim->file_iters;
+    put_bytes(rec, &header, sizeof(header));
+
+    sim->record = rec;
+    if (pthread_create(&rec->thread, NULL, record_main, rec) != 0){
+        printf("Error: failed to start the recorder\n");
+        exit(1);
+    }
+    /* the loaded board, packed by the workers like the rounds' boards */
+    rec->copying = 1;
+    rec->copy_round = data->round;
+    rec->copy_live = sim->live;
+    rec->copies_left = data->num_threads;
+    run_workers(sim, record_part);
+    return 0;
+}
+
+static void *record_part(void *arg){
+    record_copy((struct gol_data *)arg);
+    return NULL;
+}
+
+/* thread 0, between the barriers of a round: take the next slot of the
+ * ring for the board just computed, waiting while the writer still has
+ * all of them
+ * data: thread 0's struct gol_data (data->round the round being played)
+ * returns: none
+ */
+void record_round(struct gol_data *data){
+    struct gol_record *rec = data->sim->record;
+
+    if (rec->tail - __atomic_load_n(&rec->head, __ATOMIC_ACQUIRE) >= (unsigned long)rec->num_slots){
+        rec->stalls++;
+        while (rec->tail - __atomic_load_n(&rec->head, __ATOMIC_ACQUIRE) >= (unsigned long)rec->num_slots){
+            ring_wait();
+        }
+    }
+    rec->copying = 1;
+    rec->copy_round = data->round + 1;
+    rec->copy_live = data->sim->live;
+    rec->copies_left = data->num_threads;
+}
+
+/* every worker, after the second barrier of a round: pack its part of the
+ * board into the slot thread 0 took. A worker writes the words that start
+ * in its part (and reads the rest of such a word from the board next to
+ * it, which nobody writes during the next round either); the last worker
+ * to finish publishes the slot.
+ * data: the worker's struct gol_data
+ * returns: none
+ */
+void record_copy(struct gol_data *data){
+    struct gol_record *rec = data->sim->record;
+    struct record_slot *slot;
+
+    if (!rec->copying){
+        return;
+    }
+    slot = &rec->slots[rec->tail % rec->num_slots];
+    pack_part(data, slot->board, rec->words);
+    if (__atomic_sub_fetch(&rec->copies_left, 1, __ATOMIC_ACQ_REL) == 0){
+        slot->round = rec->copy_round;
+        slot->live = rec->copy_live;
+        rec->copying = 0;
+        __atomic_store_n(&rec->tail, rec->tail + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/* every worker: pack its part of the current board of any engine into a
+ * board of 64-bit words (bit i of word w in a row is column 64 * w + i),
+ * the words that start in its part (see record_copy)
+ * data: the worker's struct gol_data
+ * bits: the packed board
+ * words: words of a row of bits, (cols + 63) / 64
+ * returns: none
+ */
+void pack_part(struct gol_data *data, uint64_t *bits, int words){
+    int r, w_first, w_last;
+
+    w_first = (data->thread_col_start + 63) / 64;
+    w_last = data->thread_col_end / 64;
+    if (data->engine == ENGINE_SPARSE){
+        pack_sparse_band(data, bits, words);
+    }
+    else if (data->engine == ENGINE_BITS){
+        for (r = data->thread_row_start; r <= data->thread_row_end; ++r){
+            memcpy(bits + (size_t)r * words + w_first,
+                   data->bits_world + (size_t)r * data->words + w_first,
+                   sizeof(uint64_t) * (w_last - w_first + 1));
+        }
+    }
+    else{ // ENGINE_DENSE and ENGINE_DELTA: bit 0 of each byte
+        for (r = data->thread_row_start; r <= data->thread_row_end; ++r){
+            pack_dense_row(data, data->world + dense_index(data, r, 0), bits + (size_t)r * words,
+                           w_first, w_last);
+        }
+    }
+}
+
+/* wait for the writer to write the frames handed over, append the index
+ * and close the stream (nothing if there is no stream)
+ * sim: the simulation, no rounds running
+ * verbose: 1 to print what was recorded
+ * returns: 0 on success, 1 on error
+ */
+int finish_record(struct gol_sim *sim, int verbose){
+    struct gol_record *rec = sim->record;
+    struct record_trailer trailer;
+    int ret, i;
+
+    if (rec == NULL){
+        return 0;
+    }
+    __atomic_store_n(&rec->quit, 1, __ATOMIC_RELEASE);
+    pthread_join(rec->thread, NULL);
+
+    memset(&trailer, 0, sizeof(trailer));
+    memcpy(trailer.magic, RECORD_INDEX_MAGIC, sizeof(trailer.magic));
+    trailer.keys = rec->num_keys;
+    trailer.index_offset = rec->offset;
+    trailer.frames = rec->frames;
+    trailer.last_round = rec->last_round;
+    put_bytes(rec, rec->keys, sizeof(struct record_key) * rec->num_keys);
+    put_bytes(rec, &trailer, sizeof(trailer));
+    ret = rec->error | (fclose(rec->outfile) != 0);
+    if (ret != 0){
+        printf("Error: failed to write the recording: %s\n", rec->path);
+    }
+    else if (verbose){
+        printf("Recorded: %ld boards (%ld keyframes) to %s, %.1f MB from %.1f MB of boards, "
+               "%ld rounds waited for the writer\n", rec->frames, rec->num_keys, rec->path,
+               rec->offset / 1e6, rec->raw_total / 1e6, rec->stalls);
+    }
+
+    deflateEnd(&rec->zs);
+    for (i = 0; i < rec->num_slots; ++i){
+        free(rec->slots[i].board);
+    }
+    free(rec->slots);
+    free(rec->prev);
+    free(rec->body);
+    free(rec->packed);
+    free(rec->keys);
+    free(rec);
+    sim->record = NULL;
+    return ret;
+}
+
+static void *record_main(void *arg){
+    struct gol_record *rec = arg;
+    struct record_slot *slot;
+    unsigned long head = 0;
+
+    while (1){
+        if (head == __atomic_load_n(&rec->tail, __ATOMIC_ACQUIRE)){
+            /* quit is only set with every frame published */
+            if (__atomic_load_n(&rec->quit, __ATOMIC_ACQUIRE)
+                && head == __atomic_load_n(&rec->tail, __ATOMIC_ACQUIRE)){
+                break;
+            }
+            ring_wait();
+            continue;
+        }
+        slot = &rec->slots[head % rec->num_slots];
+        write_frame(rec, slot->board, slot->round, slot->live);
+        __atomic_store_n(&rec->head, ++head, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static void write_frame(struct gol_record *rec, const uint64_t *board, long round, long live){
+    struct record_frame frame;
+    struct record_key *keys;
+    long raw = -1;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.kind = RECORD_DELTA;
+    if (rec->frames > 0 && round % rec->keyframe != 0){
+        raw = encode_delta(rec, board);
+    }
+    if (raw < 0){
+        frame.kind = RECORD_KEY;
+        raw = sizeof(uint64_t) * rec->frame_words;
+        memcpy(rec->body, board, raw);
+        memcpy(rec->prev, board, raw);
+    }
+
+    deflateReset(&rec->zs);
+    rec->zs.next_in = rec->body;
+    rec->zs.avail_in = raw;
+    rec->zs.next_out = rec->packed;
+    rec->zs.avail_out = rec->packed_cap;
+    if (deflate(&rec->zs, Z_FINISH) != Z_STREAM_END){
+        rec->error = 1;
+        return;
+    }
+    frame.round = round;
+    frame.live = live;
+    frame.raw_bytes = raw;
+    frame.packed_bytes = rec->packed_cap - rec->zs.avail_out;
+
+    if (frame.kind == RECORD_KEY){
+        if (rec->num_keys == rec->cap_keys){
+            rec->cap_keys = rec->cap_keys ? 2 * rec->cap_keys : 64;
+            keys = realloc(rec->keys, sizeof(struct record_key) * rec->cap_keys);
+            if (keys == NULL){
+                printf("Error: malloc failed\n");
+                exit(1);
+            }
+            rec->keys = keys;
+        }
+        rec->keys[rec->num_keys].round = round;
+        rec->keys[rec->num_keys].offset = rec->offset;
+        rec->num_keys++;
+    }
+    put_bytes(rec, &frame, sizeof(frame));
+    put_bytes(rec, rec->packed, frame.packed_bytes);
+    rec->frames++;
+    rec->last_round = round;
+    rec->raw_total += sizeof(uint64_t) * rec->frame_words;
+}
+
+static long encode_delta(struct gol_record *rec, const uint64_t *board){
+    size_t w = 0, start, skip, len = 0, limit = sizeof(uint64_t) * rec->frame_words;
+    size_t run[2], i, n;
+    uint64_t diff;
+    int k;
+
+    while (w < rec->frame_words){
+        start = w;
+        while (w < rec->frame_words && board[w] == rec->prev[w]){
+            w++;
+        }
+        if (w == rec->frame_words){
+            break;
+        }
+        skip = w - start;
+        start = w;
+        while (w < rec->frame_words && board[w] != rec->prev[w]){
+            w++;
+        }
+        run[0] = skip;
+        run[1] = w - start;
+        if (len + 20 + sizeof(uint64_t) * run[1] > limit){
+            return -1; // no smaller than the board: a keyframe instead
+        }
+        for (k = 0; k < 2; ++k){
+            for (n = run[k]; n >= 0x80; n >>= 7){
+                rec->body[len++] = (n & 0x7f) | 0x80;
+            }
+            rec->body[len++] = n;
+        }
+        for (i = start; i < w; ++i){
+            diff = board[i] ^ rec->prev[i];
+            memcpy(rec->body + len, &diff, sizeof(diff));
+            len += sizeof(diff);
+        }
+    }
+    /* only now: a delta given up on still needs the board before */
+    if (len > 0){
+        memcpy(rec->prev, board, limit);
+    }
+    return len;
+}
+
+static void put_bytes(struct gol_record *rec, const void *bytes, size_t n){
+    if (n > 0 && fwrite(bytes, n, 1, rec->outfile) != 1){
+        rec->error = 1;
+    }
+    rec->offset += n;
+}
+
+static void ring_wait(void){
+    struct timespec ts = {0, 50000};
+
+    nanosleep(&ts, NULL);
+}
+
+/* the replay mode: the board of one round of a --record stream, as a
+ * snapshot gol can load (and play on from)
+ * argc, argv: the command line, argv[1] is "replay"
+ * returns: 0 on success, 1 on error
+ */
+int run_replay(int argc, char **argv){
+    struct record_header header;
+    struct record_trailer trailer;
+    struct record_frame frame;
+    struct record_key key;
+    uint64_t *board = NULL, value, diff;
+    uint8_t *body = NULL, *packed = NULL;
+    size_t words, frame_bytes, at, run, i;
+    char rule[sizeof(header.rule) + 1];
+    uLongf unpacked;
+    long long target, live;
+    int64_t seek, k;
+    FILE *infile;
+    int have = 0, ret = 1;
+
+    if (argc != 5){
+        printf("usage: %s replay <stream> <round> <snapshot>\n", argv[0]);
+        printf("  writes the board after <round> rounds of a stream recorded with \
+--record to <snapshot>, which gol loads like a board file\n");
+        return 1;
+    }
+    target = atoll(argv[3]);
+    infile = fopen(argv[2], "rb");
+    if (infile == NULL){
+        printf("Error: failed to open file: %s\n", argv[2]);
+        return 1;
+    }
+    if (fread(&header, sizeof(header), 1, infile) != 1
+        || memcmp(header.magic, RECORD_MAGIC, sizeof(header.magic)) != 0
+        || header.rows < 1 || header.rows > 0x7fffffff || header.cols < 1 || header.cols > 0x7fffffff){
+        printf("Error: not a recorded stream: %s\n", argv[2]);
+        fclose(infile);
+        return 1;
+    }
+    words = (header.cols + 63) / 64;
+    frame_bytes = sizeof(uint64_t) * words * header.rows;
+    board = calloc(words * header.rows, sizeof(uint64_t));
+    body = malloc(frame_bytes + 32);
+    if (board == NULL || body == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    /* start at the last keyframe at or before the round; without the index
+     * (a run that did not finish) at the first frame */
+    seek = sizeof(header);
+    if (fseeko(infile, -(off_t)sizeof(trailer), SEEK_END) == 0
+        && fread(&trailer, sizeof(trailer), 1, infile) == 1
+        && memcmp(trailer.magic, RECORD_INDEX_MAGIC, sizeof(trailer.magic)) == 0
+        && fseeko(infile, trailer.index_offset, SEEK_SET) == 0){
+        for (k = 0; k < trailer.keys && fread(&key, sizeof(key), 1, infile) == 1; ++k){
+            if (key.round <= target){
+                seek = key.offset;
+            }
+        }
+    }
+    if (fseeko(infile, seek, SEEK_SET) != 0){
+        printf("Error: failed to read the stream: %s\n", argv[2]);
+        goto done;
+    }
+    while (1){
+        if (fread(&frame, sizeof(frame), 1, infile) != 1
+            || (frame.kind != RECORD_KEY && frame.kind != RECORD_DELTA)){
+            printf("Error: round %lld is not in the stream: %s\n", target, argv[2]);
+            goto done;
+        }
+        if (frame.raw_bytes > frame_bytes + 32 || frame.packed_bytes > compressBound(frame_bytes + 32)
+            || (frame.kind == RECORD_KEY && frame.raw_bytes != frame_bytes)){
+            printf("Error: corrupt frame (round %lld): %s\n", (long long)frame.round, argv[2]);
+            goto done;
+        }
+        free(packed);
+        packed = malloc(frame.packed_bytes + 1);
+        if (packed == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+        unpacked = frame.raw_bytes;
+        if (fread(packed, 1, frame.packed_bytes, infile) != frame.packed_bytes
+            || uncompress(body, &unpacked, packed, frame.packed_bytes) != Z_OK
+            || unpacked != frame.raw_bytes){
+            printf("Error: corrupt frame (round %lld): %s\n", (long long)frame.round, argv[2]);
+            goto done;
+        }
+        if (frame.kind == RECORD_KEY){
+            memcpy(board, body, frame_bytes);
+            have = 1;
+        }
+        else{
+            /* runs: words skipped, words changed, the changes */
+            at = 0;
+            i = 0;
+            while (at < frame.raw_bytes){
+                if (get_number(body, frame.raw_bytes, &at, &value) != 0 || value > words * header.rows - i){
+                    break;
+                }
+                i += value;
+                if (get_number(body, frame.raw_bytes, &at, &value) != 0 || value > words * header.rows - i
+                    || value * sizeof(uint64_t) > frame.raw_bytes - at){
+                    break;
+                }
+                for (run = value; run > 0; --run, ++i, at += sizeof(diff)){
+                    memcpy(&diff, body + at, sizeof(diff));
+                    board[i] ^= diff;
+                }
+            }
+            if (at != frame.raw_bytes || !have){
+                printf("Error: corrupt frame (round %lld): %s\n", (long long)frame.round, argv[2]);
+                goto done;
+            }
+        }
+        if (frame.round >= target){
+            break;
+        }
+    }
+    if (frame.round != target){
+        printf("Error: round %lld is not in the stream: %s\n", target, argv[2]);
+        goto done;
+    }
+    live = 0;
+    for (i = 0; i < words * header.rows; ++i){
+        live += __builtin_popcountll(board[i]);
+    }
+    if (live != frame.live){
+        printf("Error: round %lld has %lld live cells, the stream says %lld: %s\n",
+               target, live, (long long)frame.live, argv[2]);
+        goto done;
+    }
+    memcpy(rule, header.rule, sizeof(header.rule));
+    rule[sizeof(header.rule)] = '\0';
+    if (save_bits(argv[4], board, header.rows, header.cols, target,
+                  (header.iters > target) ? header.iters : target, rule, header.boundary) != 0){
+        goto done;
+    }
+    printf("Round %lld: %lld live cells, %lld x %lld board written to %s\n",
+           target, live, (long long)header.rows, (long long)header.cols, argv[4]);
+    ret = 0;
+done:
+    fclose(infile);
+    free(board);
+    free(body);
+    free(packed);
+    return ret;
+}
+
+static int get_number(const uint8_t *body, size_t len, size_t *at, uint64_t *value){
+    int shift;
+
+    *value = 0;
+    for (shift = 0; shift < 64 && *at < len; shift += 7){
+        *value |= (uint64_t)(body[*at] & 0x7f) << shift;
+        if (!(body[(*at)++] & 0x80)){
+            return 0;
+        }
+    }
+    return 1;
+}
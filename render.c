@@ -0,0 +1,291 @@
+/*
+ * The ASCII animation (output mode 1), drawn by a thread of its own. At
+ * the end of every round thread 0 copies the board into a frame (one byte
+ * per character cell, the board scaled down to the terminal with
+ * --ascii-fit) and hands it over; the renderer draws it while the workers
+ * go on with the next round. A frame is built in one buffer and written
+ * with a single write: the first frame clears the screen, every later one
+ * only moves the cursor (ANSI escapes) to the cells that changed.
+ *
+ * The renderer draws a frame at most every SLEEP_USECS, and thread 0
+ * waits when the frame before is still not taken, so every round is shown
+ * and the workers are never more than one frame ahead of the terminal.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "gol.h"
+
+struct gol_render{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;  // a frame was handed over, or quit
+    pthread_cond_t taken; // the renderer took a frame or finished drawing it
+    uint8_t *back;        // thread 0 fills the next frame here
+    uint8_t *pending;     // the frame handed over and not taken yet
+    uint8_t *work;        // the frame being drawn
+    uint8_t *shown;       // the frame on the terminal
+    int rows;             // the frame: the board, or scaled down to the terminal
+    int cols;
+    int full;             // pending holds a frame
+    int drawing;          // the renderer is drawing work
+    int redraw;           // the next frame clears the screen and draws every cell
+    int quit;
+    long round, pending_round;
+    long live, pending_live;
+    char *out;            // the escapes and characters of one frame
+    size_t out_len;
+    size_t out_cap;
+};
+
+/****************** Function Prototypes **********************/
+/* the renderer thread */
+static void *render_main(void *arg);
+/* write the changes from shown to work to the terminal */
+static void draw_frame(struct gol_render *rd);
+/* add text to the frame being built */
+static void emit(struct gol_render *rd, const char *text, size_t len);
+
+/* start the renderer thread (output mode 1)
+ * sim: the simulation
+ * returns: 0 on success, 1 on error
+ */
+int init_render(struct gol_sim *sim){
+    struct gol_render *rd;
+
+    rd = calloc(1, sizeof(struct gol_render));
+    if (rd == NULL){
+        printf("Error: malloc failed\n");
+        return 1;
+    }
+    pthread_mutex_init(&rd->lock, NULL);
+    pthread_cond_init(&rd->wake, NULL);
+    pthread_cond_init(&rd->taken, NULL);
+    if (pthread_create(&rd->thread, NULL, render_main, rd) != 0){
+        printf("Error: failed to start the renderer\n");
+        free(rd);
+        return 1;
+    }
+    sim->render = rd;
+    return 0;
+}
+
+/* size the frames for a newly loaded board: the board itself, or with
+ * --ascii-fit at most as large as the terminal (two characters per cell,
+ * three lines for the round, the live cells and the prompt)
+ * sim: the simulation, no rounds running
+ * returns: none
+ */
+void render_board(struct gol_sim *sim){
+    struct gol_render *rd = sim->render;
+    struct gol_data *data = &sim->data;
+    struct winsize ws;
+    int term_rows = 24, term_cols = 80;
+    size_t cells;
+
+    pthread_mutex_lock(&rd->lock);
+    rd->rows = data->rows;
+    rd->cols = data->cols;
+    if (data->ascii_fit){
+        if (ioctl(STDERR_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 3 && ws.ws_col > 1){
+            term_rows = ws.ws_row;
+            term_cols = ws.ws_col;
+        }
+        rd->rows = (rd->rows < term_rows - 3) ? rd->rows : term_rows - 3;
+        rd->cols = (rd->cols < term_cols / 2) ? rd->cols : term_cols / 2;
+    }
+    cells = (size_t)rd->rows * rd->cols;
+    free(rd->back);
+    free(rd->pending);
+    free(rd->work);
+    free(rd->shown);
+    rd->back = malloc(cells);
+    rd->pending = malloc(cells);
+    rd->work = malloc(cells);
+    rd->shown = malloc(cells);
+    if (rd->back == NULL || rd->pending == NULL || rd->work == NULL || rd->shown == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    rd->full = 0;
+    rd->redraw = 1;
+    pthread_mutex_unlock(&rd->lock);
+}
+
+/* thread 0, after a round: copy the board into a frame and hand it to
+ * the renderer. A character cell of a scaled down frame is alive when
+ * any board cell under it is.
+ * data: thread 0's struct gol_data, with the world of the round
+ * returns: none
+ */
+void render_frame(struct gol_data *data){
+    struct gol_render *rd = data->sim->render;
+    uint8_t *temp;
+    int y, x, r, c, r1, c1, alive;
+
+    for (y = 0; y < rd->rows; ++y){
+        for (x = 0; x < rd->cols; ++x){
+            r1 = (int)((long)(y + 1) * data->rows / rd->rows);
+            c1 = (int)((long)(x + 1) * data->cols / rd->cols);
+            alive = 0;
+            for (r = (int)((long)y * data->rows / rd->rows); r < r1 && !alive; ++r){
+                for (c = (int)((long)x * data->cols / rd->cols); c < c1 && !alive; ++c){
+                    alive = gol_cell(data, r, c);
+                }
+            }
+            rd->back[(size_t)y * rd->cols + x] = alive;
+        }
+    }
+
+    pthread_mutex_lock(&rd->lock);
+    while (rd->full){
+        pthread_cond_wait(&rd->taken, &rd->lock);
+    }
+    temp = rd->pending;
+    rd->pending = rd->back;
+    rd->back = temp;
+    rd->pending_round = data->round + 1;
+    rd->pending_live = data->sim->live;
+    rd->full = 1;
+    pthread_cond_signal(&rd->wake);
+    pthread_mutex_unlock(&rd->lock);
+}
+
+/* wait until every frame handed over is on the terminal
+ * sim: the simulation
+ * returns: none
+ */
+void render_drain(struct gol_sim *sim){
+    struct gol_render *rd = sim->render;
+
+    pthread_mutex_lock(&rd->lock);
+    while (rd->full || rd->drawing){
+        pthread_cond_wait(&rd->taken, &rd->lock);
+    }
+    pthread_mutex_unlock(&rd->lock);
+}
+
+/* stop the renderer and free it
+ * sim: the simulation, its frames drained
+ * returns: none
+ */
+void free_render(struct gol_sim *sim){
+    struct gol_render *rd = sim->render;
+
+    if (rd == NULL){
+        return;
+    }
+    pthread_mutex_lock(&rd->lock);
+    rd->quit = 1;
+    pthread_cond_signal(&rd->wake);
+    pthread_mutex_unlock(&rd->lock);
+    pthread_join(rd->thread, NULL);
+    pthread_mutex_destroy(&rd->lock);
+    pthread_cond_destroy(&rd->wake);
+    pthread_cond_destroy(&rd->taken);
+    free(rd->back);
+    free(rd->pending);
+    free(rd->work);
+    free(rd->shown);
+    free(rd->out);
+    free(rd);
+    sim->render = NULL;
+}
+
+static void *render_main(void *arg){
+    struct gol_render *rd = arg;
+    uint8_t *temp;
+
+    pthread_mutex_lock(&rd->lock);
+    while (1){
+        while (!rd->full && !rd->quit){
+            pthread_cond_wait(&rd->wake, &rd->lock);
+        }
+        if (!rd->full){
+            break; // quit, nothing left to draw
+        }
+        temp = rd->work;
+        rd->work = rd->pending;
+        rd->pending = temp;
+        rd->round = rd->pending_round;
+        rd->live = rd->pending_live;
+        rd->full = 0;
+        rd->drawing = 1;
+        pthread_cond_broadcast(&rd->taken);
+        pthread_mutex_unlock(&rd->lock);
+
+        draw_frame(rd);
+
+        pthread_mutex_lock(&rd->lock);
+        rd->drawing = 0;
+        pthread_cond_broadcast(&rd->taken);
+        pthread_mutex_unlock(&rd->lock);
+        usleep(SLEEP_USECS);
+        pthread_mutex_lock(&rd->lock);
+    }
+    pthread_mutex_unlock(&rd->lock);
+    return NULL;
+}
+
+static void draw_frame(struct gol_render *rd){
+    char text[64];
+    size_t i, written;
+    ssize_t n;
+    int y, x, len, at_y, at_x;
+
+    rd->out_len = 0;
+    if (rd->redraw){
+        emit(rd, "\x1b[H\x1b[2J", 7); // home, clear the screen
+    }
+    len = snprintf(text, sizeof(text), "\x1b[1;1HRound: %ld\x1b[K", rd->round);
+    emit(rd, text, len);
+
+    /* the board starts on line 2; the cursor moves on by itself after a
+     * cell, so a run of changed cells needs one escape */
+    at_y = at_x = -1;
+    for (y = 0; y < rd->rows; ++y){
+        for (x = 0; x < rd->cols; ++x){
+            i = (size_t)y * rd->cols + x;
+            if (!rd->redraw && rd->work[i] == rd->shown[i]){
+                continue;
+            }
+            if (y != at_y || x != at_x){
+                len = snprintf(text, sizeof(text), "\x1b[%d;%dH", y + 2, 2 * x + 1);
+                emit(rd, text, len);
+            }
+            emit(rd, rd->work[i] ? " @" : " .", 2);
+            at_y = y;
+            at_x = x + 1;
+        }
+    }
+    len = snprintf(text, sizeof(text), "\x1b[%d;1HLive cells: %ld\x1b[K\n",
+                   rd->rows + 2, rd->live);
+    emit(rd, text, len);
+
+    for (written = 0; written < rd->out_len; written += n){
+        n = write(STDERR_FILENO, rd->out + written, rd->out_len - written);
+        if (n <= 0){
+            break;
+        }
+    }
+    memcpy(rd->shown, rd->work, (size_t)rd->rows * rd->cols);
+    rd->redraw = 0;
+}
+
+static void emit(struct gol_render *rd, const char *text, size_t len){
+    if (rd->out_len + len > rd->out_cap){
+        rd->out_cap = (rd->out_cap == 0) ? 65536 : 2 * rd->out_cap;
+        if (rd->out_cap < rd->out_len + len){
+            rd->out_cap = rd->out_len + len;
+        }
+        rd->out = realloc(rd->out, rd->out_cap);
+        if (rd->out == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+    }
+    memcpy(rd->out + rd->out_len, text, len);
+    rd->out_len += len;
+}
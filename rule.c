@@ -0,0 +1,157 @@
+/*
+ * Outer-totalistic rules in B/S notation: "B36/S23" has a dead cell come
+ * alive with 3 or 6 live neighbors and a live cell stay alive with 2 or 3.
+ * A rule is parsed once (from --rule, the rule line of an RLE pattern or
+ * the header of a snapshot) into a table of the next state by the state of
+ * the cell and its live neighbors. The rules the engines have compiled
+ * kernels for are recognized here as well; any other rule runs on the
+ * engines' table kernels.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "gol.h"
+
+/* the rules with their own kernels, by the birth and survival masks */
+static const struct {
+    int birth;
+    int survive;
+    int kind;
+} known_rules[] = {
+    {1 << 3, (1 << 2) | (1 << 3), RULE_LIFE},
+    {(1 << 3) | (1 << 6), (1 << 2) | (1 << 3), RULE_HIGHLIFE},
+    {(1 << 3) | (1 << 6) | (1 << 7) | (1 << 8),
+     (1 << 3) | (1 << 4) | (1 << 6) | (1 << 7) | (1 << 8), RULE_DAYNIGHT},
+    {1 << 2, 0, RULE_SEEDS},
+};
+
+/****************** Function Prototypes **********************/
+/* read the neighbor counts of one half of a rule up to the '/' or the end */
+static const char *read_counts(const char *p, int *mask);
+
+/* parse a rule: "B3/S23" (any case, either half first) or the older
+ * "23/3" that lists the survival counts first
+ * text: the rule
+ * rule: filled in with the masks, the table, the kind and the name
+ * returns: 0 on success, 1 if text is not a B/S rule
+ */
+int parse_rule(const char *text, struct gol_rule *rule){
+    const char *p = text;
+    int birth = 0, survive = 0, *first, *second;
+    int a, n;
+
+    if (toupper((unsigned char)*p) == 'B'){
+        first = &birth;
+        second = &survive;
+    }
+    else if (toupper((unsigned char)*p) == 'S'){
+        first = &survive;
+        second = &birth;
+    }
+    else{ // "23/3": survival, then birth, no letters
+        p = read_counts(p, &survive);
+        if (p == NULL || *p != '/'){
+            return 1;
+        }
+        p = read_counts(p + 1, &birth);
+        if (p == NULL || *p != '\0'){
+            return 1;
+        }
+        first = NULL;
+    }
+    if (first != NULL){
+        p = read_counts(p + 1, first);
+        if (p == NULL || *p != '/'
+            || toupper((unsigned char)p[1]) != ((first == &birth) ? 'S' : 'B')){
+            return 1;
+        }
+        p = read_counts(p + 2, second);
+        if (p == NULL || *p != '\0'){
+            return 1;
+        }
+    }
+
+    rule->birth = birth;
+    rule->survive = survive;
+    memset(rule->next, 0, sizeof(rule->next));
+    for (n = 0; n <= 8; ++n){
+        rule->next[0][n] = (birth >> n) & 1;
+        rule->next[1][n] = (survive >> n) & 1;
+    }
+    rule->kind = RULE_TABLE;
+    for (a = 0; a < (int)(sizeof(known_rules) / sizeof(known_rules[0])); ++a){
+        if (known_rules[a].birth == birth && known_rules[a].survive == survive){
+            rule->kind = known_rules[a].kind;
+        }
+    }
+    rule->name[0] = 'B';
+    for (n = 0, a = 1; n <= 8; ++n){
+        if ((birth >> n) & 1){
+            rule->name[a++] = '0' + n;
+        }
+    }
+    rule->name[a++] = '/';
+    rule->name[a++] = 'S';
+    for (n = 0; n <= 8; ++n){
+        if ((survive >> n) & 1){
+            rule->name[a++] = '0' + n;
+        }
+    }
+    rule->name[a] = '\0';
+    return 0;
+}
+
+static const char *read_counts(const char *p, int *mask){
+    for (; *p != '\0' && *p != '/'; ++p){
+        if (*p < '0' || *p > '8'){
+            return NULL;
+        }
+        *mask |= 1 << (*p - '0');
+    }
+    return p;
+}
+
+/* can the chosen engine run a rule: hashlife, the sparse and the delta
+ * engine only look at the cells near live (or flipped) ones, so a rule
+ * under which empty space comes alive (B0) needs the dense or the bits
+ * engine
+ * data: pointer to gol_data struct with the engine set
+ * rule: the rule
+ * returns: 0 if it can, 1 (after printing why) if not
+ */
+int check_rule(struct gol_data *data, const struct gol_rule *rule){
+    if (rule->next[0][0] && (data->engine == ENGINE_HASHLIFE || data->engine == ENGINE_SPARSE
+                             || data->engine == ENGINE_DELTA)){
+        printf("Error: rule %s brings empty space to life, use the dense or bits engine\n",
+               rule->name);
+        return 1;
+    }
+    return 0;
+}
+
+/* take the rule a board file names (the rule line of an RLE pattern, the
+ * rule of a snapshot) as the rule of the board
+ * data: pointer to gol_data struct
+ * text: the rule the file names
+ * path: the file, for the messages
+ * returns: 0 on success, 1 if the rule is unknown, differs from --rule or
+ *          does not fit the engine
+ */
+int use_file_rule(struct gol_data *data, const char *text, const char *path){
+    struct gol_rule rule;
+
+    if (parse_rule(text, &rule) != 0){
+        printf("Error: unsupported rule %s: %s\n", text, path);
+        return 1;
+    }
+    if (data->rule_arg != NULL && strcmp(rule.name, data->rule.name) != 0){
+        printf("Error: %s uses rule %s, not the --rule %s\n", path, rule.name, data->rule.name);
+        return 1;
+    }
+    if (check_rule(data, &rule) != 0){
+        return 1;
+    }
+    data->rule = rule;
+    return 0;
+}
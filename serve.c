@@ -0,0 +1,688 @@
+/*
+ * Server mode (./gol serve <socket> <shm name> <board> num_threads
+ * partition [options]): loads a board and plays it on command, for
+ * dashboards and tests on the same machine. Commands come over the Unix
+ * domain socket, one line each, and every round's board is published with
+ * --share in the shared memory object, where any number of readers map it
+ * without copies or locks (see share.c).
+ *
+ *   step [N]           play N rounds (default 1), reply when they are done
+ *   run                play until paused
+ *   pause              stop playing after the rounds running now
+ *   population         the round and the live cells of the latest board
+ *   region R C H W     the H x W cells at row R, column C, a line of 0 and 1 a row
+ *   info               the board's size, the shared memory object, running or paused
+ *   quit               stop the server
+ *
+ * Every reply starts with a line "ok round N live L ..." or "error ...".
+ * The server starts paused. While it plays, the rounds are handed to the
+ * workers in batches that take about SERVE_BATCH_NS, so a command waits
+ * at most that long; the queries are answered from the shared board, the
+ * way any reader sees it. Nothing is kept per round, so a server can run
+ * for as long as the round count (a long) lasts. Replies never block the
+ * server either: what a client's socket does not take is kept and sent as
+ * the client reads, and a client that lets more than SERVE_BACKLOG bytes
+ * pile up is dropped.
+ *
+ * ./gol client <socket> <command>  sends one command and prints the reply,
+ * ./gol client --share <shm name> [population|region R C H W]  reads the
+ * shared board directly.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "gol.h"
+
+#define SERVE_CLIENTS (64)      // connections at a time
+#define SERVE_LINE (256)        // longest command
+#define SERVE_BATCH_NS (10000000LL) // a batch of rounds takes about this long
+#define SERVE_REGION_CELLS (1 << 24) // largest region a command may ask for
+#define SERVE_WORDS (5)         // the most words of a command (region R C H W)
+#define SERVE_BACKLOG (4 * SERVE_REGION_CELLS) // most reply bytes kept for a client
+
+struct serve_client{
+    int fd;              // -1: no connection
+    char line[SERVE_LINE]; // the command read so far
+    int len;
+    int eof;             // the client is done sending, close when nothing is owed
+    long wait_round;     // step: reply when the board gets to this round (-1: none)
+    char *out;           // replies the socket did not take yet
+    size_t out_len;      // bytes in out
+    size_t out_sent;     // of them, sent already
+    size_t out_cap;
+};
+
+struct serve_state{
+    struct gol_sim *sim;
+    struct gol_share *share; // the server's own view of the shared board
+    const char *share_name;
+    int listen_fd;
+    struct serve_client clients[SERVE_CLIENTS];
+    int running;         // run: play until paused
+    int quit;
+    long batch;          // rounds of the next batch
+};
+
+/****************** Function Prototypes **********************/
+/* create, bind and listen on the socket */
+static int serve_listen(const char *path);
+/* read what a client sent and run its complete commands */
+static void serve_read(struct serve_state *st, struct serve_client *c);
+/* run one command */
+static void serve_command(struct serve_state *st, struct serve_client *c, char *line);
+/* read a word of a command as a number */
+static int parse_number(const char *word, long *value);
+/* reply to the clients whose steps are done */
+static void serve_steps(struct serve_state *st);
+/* the round the board has to get to for the steps asked for (-1: none) */
+static long serve_target(struct serve_state *st);
+/* write a reply line "ok round N live L" followed by more */
+static void reply_ok(struct serve_state *st, struct serve_client *c, const char *more);
+/* send a reply, or keep what the socket does not take */
+static void reply(struct serve_client *c, const char *text);
+/* send the replies kept for a client */
+static void flush_client(struct serve_client *c);
+/* close a client that is done sending once nothing is owed to it */
+static void close_if_done(struct serve_client *c);
+/* close a client's connection */
+static void drop_client(struct serve_client *c);
+/* format a region of the shared board as a reply */
+static char *format_region(struct gol_share *share, int row, int col, int rows, int cols);
+
+static void serve_usage(const char *prog){
+    printf("usage: %s serve <socket> <shm name> <board> num_threads partition[0,1,2] [options]\n",
+           prog);
+    printf("  plays the board on commands to the Unix domain socket and publishes every\n");
+    printf("  round in the shared memory object (like /gol), the options are gol's\n");
+    printf("  commands: step [N], run, pause, population, region R C H W, info, quit\n");
+    printf("or: %s client <socket> <command>  send a command, print the reply\n", prog);
+    printf("or: %s client --share <shm name> [population|region R C H W]  read the \
+shared board\n", prog);
+}
+
+/* the server mode entry point
+ * argc, argv: the command line, argv[1] is "serve"
+ * returns: 0 on success, 1 on error
+ */
+int run_serve(int argc, char **argv){
+    struct serve_state st;
+    struct gol_config config;
+    struct pollfd fds[SERVE_CLIENTS + 1];
+    struct serve_client *c;
+    char **options;
+    long long start, ns;
+    long target, rounds;
+    int i, n, fd;
+
+    if (argc < 7){
+        serve_usage(argv[0]);
+        return 1;
+    }
+    /* the options of the command line, then --share */
+    options = malloc(sizeof(char *) * (argc - 7 + 2));
+    if (options == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    for (i = 7; i < argc; ++i){
+        options[i - 7] = argv[i];
+    }
+    options[argc - 7] = "--share";
+    options[argc - 6] = argv[3];
+    config.output_mode = 0;
+    config.num_threads = atoi(argv[5]);
+    config.partition = atoi(argv[6]);
+    config.print_partition = 0;
+    config.argc = argc - 7 + 2;
+    config.argv = options;
+
+    memset(&st, 0, sizeof(st));
+    st.share_name = argv[3];
+    st.batch = 1;
+    for (i = 0; i < SERVE_CLIENTS; ++i){
+        st.clients[i].fd = -1;
+    }
+    st.sim = gol_init(&config);
+    if (st.sim == NULL){
+        return 1;
+    }
+    if (st.sim->data.keep_history){ // it would grow with every round for as long as it runs
+        printf("Error: gol serve keeps no history of the rounds, leave out --population\n");
+        gol_free(st.sim);
+        return 1;
+    }
+    if (gol_load(st.sim, argv[4]) != 0){
+        gol_free(st.sim);
+        return 1;
+    }
+    st.share = gol_share_open(st.share_name);
+    if (st.share == NULL){
+        gol_free(st.sim);
+        return 1;
+    }
+    st.listen_fd = serve_listen(argv[2]);
+    if (st.listen_fd < 0){
+        gol_share_close(st.share);
+        gol_free(st.sim);
+        return 1;
+    }
+    printf("Serving %s (%d x %d) on %s, every round in %s\n", argv[4], gol_rows(st.sim),
+           gol_cols(st.sim), argv[2], st.share_name);
+    fflush(stdout);
+
+    while (!st.quit){
+        /* wait for commands only when there is nothing to play */
+        target = serve_target(&st);
+        fds[0].fd = st.listen_fd;
+        fds[0].events = POLLIN;
+        for (i = 0; i < SERVE_CLIENTS; ++i){
+            c = &st.clients[i];
+            fds[i + 1].fd = (c->eof && c->out_len == 0) ? -1 : c->fd;
+            fds[i + 1].events = (c->eof ? 0 : POLLIN) | ((c->out_len > 0) ? POLLOUT : 0);
+            fds[i + 1].revents = 0;
+        }
+        n = poll(fds, SERVE_CLIENTS + 1, (st.running || target > gol_round(st.sim)) ? 0 : -1);
+        if (n < 0){
+            perror("poll");
+            continue;
+        }
+        if (fds[0].revents & POLLIN){
+            fd = accept(st.listen_fd, NULL, NULL);
+            for (i = 0; fd >= 0 && i < SERVE_CLIENTS && st.clients[i].fd >= 0; ++i){
+            }
+            if (fd >= 0 && i == SERVE_CLIENTS){
+                send(fd, "error too many clients\n", 23, MSG_NOSIGNAL | MSG_DONTWAIT);
+                close(fd);
+            }
+            else if (fd >= 0){
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                memset(&st.clients[i], 0, sizeof(struct serve_client));
+                st.clients[i].fd = fd;
+                st.clients[i].wait_round = -1;
+            }
+        }
+        for (i = 0; i < SERVE_CLIENTS && !st.quit; ++i){
+            c = &st.clients[i];
+            if (c->fd < 0 || fds[i + 1].fd != c->fd){
+                continue;
+            }
+            if (fds[i + 1].revents & POLLOUT){
+                flush_client(c);
+            }
+            if (c->fd >= 0 && (fds[i + 1].revents & ~POLLOUT)){
+                if (c->eof){
+                    drop_client(c); // hung up before it read its replies
+                }
+                else{
+                    serve_read(&st, c);
+                }
+            }
+        }
+
+        /* play a batch: until paused, or up to the furthest step asked for */
+        target = serve_target(&st);
+        if (!st.quit && (st.running || target > gol_round(st.sim))){
+            rounds = st.batch;
+            if (!st.running && target - gol_round(st.sim) < rounds){
+                rounds = target - gol_round(st.sim);
+            }
+            start = monotonic_ns();
+            if (gol_step(st.sim, rounds) != 0){
+                exit(1);
+            }
+            ns = monotonic_ns() - start;
+            if (rounds == st.batch && ns < SERVE_BATCH_NS / 2 && st.batch < (1 << 20)){
+                st.batch *= 2;
+            }
+            else if (ns > SERVE_BATCH_NS && st.batch > 1){
+                st.batch /= 2;
+            }
+            serve_steps(&st);
+        }
+    }
+
+    for (i = 0; i < SERVE_CLIENTS; ++i){
+        drop_client(&st.clients[i]);
+    }
+    close(st.listen_fd);
+    unlink(argv[2]);
+    gol_share_close(st.share);
+    gol_free(st.sim);
+    free(options);
+    return 0;
+}
+
+static int serve_listen(const char *path){
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)){
+        printf("Error: socket path too long: %s\n", path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0){
+        perror("socket");
+        return -1;
+    }
+    unlink(path); // a socket left by a server before
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0){
+        printf("Error: failed to listen on socket: %s\n", path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* read what a client sent; every complete line is a command. A client
+ * that closed its end is dropped once the steps it asked for are done.
+ * st: the server
+ * c: the client, with something to read
+ * returns: none
+ */
+static void serve_read(struct serve_state *st, struct serve_client *c){
+    char *end;
+    ssize_t got;
+    int used;
+
+    got = read(c->fd, c->line + c->len, SERVE_LINE - 1 - c->len);
+    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+        return;
+    }
+    if (got <= 0){
+        c->eof = 1;
+        if (c->len > 0){ // a last command without its newline
+            c->line[c->len] = '\0';
+            c->len = 0;
+            serve_command(st, c, c->line);
+        }
+        close_if_done(c);
+        return;
+    }
+    c->len += got;
+    c->line[c->len] = '\0';
+    used = 0;
+    while (c->fd >= 0 && (end = strchr(c->line + used, '\n')) != NULL){
+        *end = '\0';
+        serve_command(st, c, c->line + used);
+        used = end + 1 - c->line;
+    }
+    if (c->fd < 0){
+        return;
+    }
+    if (used == 0 && c->len == SERVE_LINE - 1){
+        reply(c, "error command too long\n");
+        used = c->len;
+    }
+    memmove(c->line, c->line + used, c->len - used);
+    c->len -= used;
+}
+
+/* run one command and reply to it (a step replies when it is done)
+ * st: the server, no rounds running
+ * c: the client that sent it
+ * line: the command
+ * returns: none
+ */
+static void serve_command(struct serve_state *st, struct serve_client *c, char *line){
+    char *words[SERVE_WORDS + 1], *save, text[256], *region;
+    long numbers[SERVE_WORDS + 1];
+    int n, i;
+
+    /* the command and its numbers, and one word more so a command with too
+     * many is caught below rather than cut short */
+    n = 0;
+    while (n <= SERVE_WORDS
+           && (words[n] = strtok_r(n == 0 ? line : NULL, " \t\r", &save)) != NULL){
+        n++;
+    }
+    if (n == 0){
+        return; // an empty line
+    }
+    for (i = 1; i < n; ++i){
+        if (parse_number(words[i], &numbers[i]) != 0){
+            numbers[i] = -1;
+        }
+    }
+    if (strcmp(words[0], "step") == 0){
+        if (n > 2 || (n == 2 && numbers[1] < 1)){
+            reply(c, "error step needs a number of rounds >= 1\n");
+            return;
+        }
+        /* after the steps asked for before, and the batch of a run */
+        if (c->wait_round < 0){
+            c->wait_round = gol_round(st->sim);
+        }
+        c->wait_round += (n == 2) ? numbers[1] : 1;
+    }
+    else if (strcmp(words[0], "region") == 0){
+        if (n != 5 || numbers[1] < 0 || numbers[2] < 0 || numbers[3] < 0 || numbers[4] < 0
+            || numbers[3] * numbers[4] > SERVE_REGION_CELLS){
+            reply(c, "error region needs R C H W, at most 16777216 cells\n");
+            return;
+        }
+        region = format_region(st->share, numbers[1], numbers[2], numbers[3], numbers[4]);
+        if (region == NULL){
+            reply(c, "error region not on the board\n");
+            return;
+        }
+        reply(c, region);
+        free(region);
+    }
+    else if (n > 1 && (strcmp(words[0], "run") == 0 || strcmp(words[0], "pause") == 0
+                       || strcmp(words[0], "population") == 0 || strcmp(words[0], "info") == 0
+                       || strcmp(words[0], "quit") == 0)){
+        snprintf(text, sizeof(text), "error %s takes no arguments\n", words[0]);
+        reply(c, text);
+    }
+    else if (strcmp(words[0], "run") == 0){
+        st->running = 1;
+        reply_ok(st, c, "running");
+    }
+    else if (strcmp(words[0], "pause") == 0){
+        st->running = 0;
+        reply_ok(st, c, "paused");
+    }
+    else if (strcmp(words[0], "population") == 0){
+        reply_ok(st, c, "");
+    }
+    else if (strcmp(words[0], "info") == 0){
+        snprintf(text, sizeof(text), "rows %d cols %d share %s %s", gol_rows(st->sim),
+                 gol_cols(st->sim), st->share_name, st->running ? "running" : "paused");
+        reply_ok(st, c, text);
+    }
+    else if (strcmp(words[0], "quit") == 0){
+        reply_ok(st, c, "quit");
+        st->quit = 1;
+    }
+    else{
+        snprintf(text, sizeof(text), "error unknown command: %.200s\n", words[0]);
+        reply(c, text);
+    }
+}
+
+/* read a whole word as a number from 0 to INT_MAX
+ * word: the word
+ * value: set to the number
+ * returns: 0 on success, 1 if the word is not such a number
+ */
+static int parse_number(const char *word, long *value){
+    char *end;
+
+    errno = 0;
+    *value = strtol(word, &end, 10);
+    return end == word || *end != '\0' || errno != 0 || *value < 0 || *value > INT_MAX;
+}
+
+static void serve_steps(struct serve_state *st){
+    struct serve_client *c;
+    int i;
+
+    for (i = 0; i < SERVE_CLIENTS; ++i){
+        c = &st->clients[i];
+        if (c->fd >= 0 && c->wait_round >= 0 && c->wait_round <= gol_round(st->sim)){
+            c->wait_round = -1;
+            reply_ok(st, c, "");
+            close_if_done(c);
+        }
+    }
+}
+
+static long serve_target(struct serve_state *st){
+    long target = -1;
+    int i;
+
+    for (i = 0; i < SERVE_CLIENTS; ++i){
+        if (st->clients[i].fd >= 0 && st->clients[i].wait_round > target){
+            target = st->clients[i].wait_round;
+        }
+    }
+    return target;
+}
+
+static void reply_ok(struct serve_state *st, struct serve_client *c, const char *more){
+    char text[SERVE_LINE + 64];
+    uint8_t none;
+    long round, live;
+
+    gol_share_region(st->share, 0, 0, 0, 0, &none, &round, &live);
+    snprintf(text, sizeof(text), "ok round %ld live %ld%s%s\n", round, live,
+             (more[0] != '\0') ? " " : "", more);
+    reply(c, text);
+}
+
+/* send a reply without blocking: what the socket does not take now is
+ * kept, after the replies kept before it, and sent as the client reads. A
+ * client that went away, or lets more than SERVE_BACKLOG bytes pile up, is
+ * dropped.
+ * c: the client
+ * text: the reply
+ * returns: none
+ */
+static void reply(struct serve_client *c, const char *text){
+    size_t len = strlen(text);
+    ssize_t sent;
+
+    if (c->fd < 0){
+        return;
+    }
+    if (c->out_len == 0){
+        sent = send(c->fd, text, len, MSG_NOSIGNAL);
+        if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK){
+            drop_client(c);
+            return;
+        }
+        if (sent > 0){
+            text += sent;
+            len -= sent;
+        }
+    }
+    if (len == 0){
+        return;
+    }
+    if (c->out_len - c->out_sent + len > SERVE_BACKLOG){
+        drop_client(c);
+        return;
+    }
+    if (c->out_sent > 0){
+        memmove(c->out, c->out + c->out_sent, c->out_len - c->out_sent);
+        c->out_len -= c->out_sent;
+        c->out_sent = 0;
+    }
+    if (c->out_len + len > c->out_cap){
+        c->out_cap = (c->out_len + len > 2 * c->out_cap) ? c->out_len + len : 2 * c->out_cap;
+        c->out = realloc(c->out, c->out_cap);
+        if (c->out == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+    }
+    memcpy(c->out + c->out_len, text, len);
+    c->out_len += len;
+}
+
+/* send what the client's socket takes of the replies kept for it */
+static void flush_client(struct serve_client *c){
+    ssize_t sent;
+
+    while (c->out_sent < c->out_len){
+        sent = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent, MSG_NOSIGNAL);
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+            return;
+        }
+        if (sent <= 0){
+            drop_client(c);
+            return;
+        }
+        c->out_sent += sent;
+    }
+    c->out_len = 0;
+    c->out_sent = 0;
+    close_if_done(c);
+}
+
+static void close_if_done(struct serve_client *c){
+    if (c->fd >= 0 && c->eof && c->wait_round < 0 && c->out_len == 0){
+        drop_client(c);
+    }
+}
+
+static void drop_client(struct serve_client *c){
+    if (c->fd >= 0){
+        close(c->fd);
+    }
+    free(c->out);
+    c->out = NULL;
+    c->out_len = 0;
+    c->out_sent = 0;
+    c->out_cap = 0;
+    c->fd = -1;
+    c->wait_round = -1;
+    c->eof = 0;
+    c->len = 0;
+}
+
+/* a region of the shared board as a reply: "ok round N live L rows H cols
+ * W", then H lines of W characters, 1 alive and 0 dead
+ * share: the shared board
+ * row, col, rows, cols: the region
+ * returns: the reply (to free), NULL if the region is not on the board
+ */
+static char *format_region(struct gol_share *share, int row, int col, int rows, int cols){
+    uint8_t *cells;
+    char *text;
+    size_t at;
+    long round, live;
+    int i, j;
+
+    cells = malloc((size_t)rows * cols + 1);
+    text = malloc((size_t)rows * (cols + 1) + 128);
+    if (cells == NULL || text == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    if (gol_share_region(share, row, col, rows, cols, cells, &round, &live) != 0){
+        free(cells);
+        free(text);
+        return NULL;
+    }
+    at = sprintf(text, "ok round %ld live %ld rows %d cols %d\n", round, live, rows, cols);
+    for (i = 0; i < rows; ++i){
+        for (j = 0; j < cols; ++j){
+            text[at++] = '0' + cells[(size_t)i * cols + j];
+        }
+        text[at++] = '\n';
+    }
+    text[at] = '\0';
+    free(cells);
+    return text;
+}
+
+/* the client: send one command to a server and print the reply, or read
+ * the shared board directly
+ * argc, argv: the command line, argv[1] is "client"
+ * returns: 0 on success, 1 on error or an error reply
+ */
+int run_client(int argc, char **argv){
+    struct sockaddr_un addr;
+    struct gol_share *share;
+    char line[SERVE_LINE], reply_text[4096], *region;
+    long numbers[4], round, live;
+    uint8_t none;
+    size_t len;
+    ssize_t got;
+    int fd, i, error, first;
+
+    if (argc < 4){
+        serve_usage(argv[0]);
+        return 1;
+    }
+    if (strcmp(argv[2], "--share") == 0){
+        share = gol_share_open(argv[3]);
+        if (share == NULL){
+            return 1;
+        }
+        if (argc == 9 && strcmp(argv[4], "region") == 0){
+            error = 1;
+            for (i = 0; i < 4; ++i){
+                if (parse_number(argv[5 + i], &numbers[i]) != 0){
+                    break;
+                }
+            }
+            region = (i < 4) ? NULL : format_region(share, numbers[0], numbers[1],
+                                                    numbers[2], numbers[3]);
+            if (region != NULL){
+                printf("%s", region);
+                error = 0;
+            }
+            else if (gol_share_gone(share)){
+                printf("error the simulation of the shared board is gone\n");
+            }
+            else{
+                printf("error region needs R C H W on the board\n");
+            }
+            free(region);
+        }
+        else if (argc == 4 || (argc == 5 && strcmp(argv[4], "population") == 0)){
+            error = (gol_share_region(share, 0, 0, 0, 0, &none, &round, &live) != 0);
+            if (error){
+                printf("error the simulation of the shared board is gone\n");
+            }
+            else{
+                printf("ok round %ld live %ld\n", round, live);
+            }
+        }
+        else{
+            serve_usage(argv[0]);
+            error = 1;
+        }
+        gol_share_close(share);
+        return error;
+    }
+
+    /* the command words, joined with spaces */
+    len = 0;
+    for (i = 3; i < argc; ++i){
+        len += snprintf(line + len, (len < sizeof(line)) ? sizeof(line) - len : 0, "%s%s",
+                        argv[i], (i + 1 < argc) ? " " : "\n");
+    }
+    if (len >= sizeof(line) || strlen(argv[2]) >= sizeof(addr.sun_path)){
+        printf("Error: command or socket path too long\n");
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, argv[2]);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0){
+        printf("Error: failed to connect to: %s\n", argv[2]);
+        return 1;
+    }
+    if (write(fd, line, len) != (ssize_t)len){
+        printf("Error: failed to send the command\n");
+        close(fd);
+        return 1;
+    }
+    shutdown(fd, SHUT_WR); // the server replies and hangs up
+    error = 1;
+    first = 1;
+    while ((got = read(fd, reply_text, sizeof(reply_text))) > 0){
+        if (first){
+            error = (got < 3 || strncmp(reply_text, "ok ", 3) != 0);
+            first = 0;
+        }
+        fwrite(reply_text, 1, got, stdout);
+    }
+    close(fd);
+    return error;
+}
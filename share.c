@@ -0,0 +1,241 @@
+/*
+ * The board in shared memory (--share NAME): after every round the board
+ * goes to the POSIX shared memory object NAME, bit-packed (struct
+ * gol_share in libgol.h), for any number of processes on the machine to
+ * map and read while the simulation runs (gol serve answers its queries
+ * from it, dashboards can map it themselves).
+ *
+ * The board is written in place under a sequence lock, so the workers
+ * never wait for a reader and readers never take a lock: thread 0 makes
+ * seq odd between the barriers of a round, every worker packs its own
+ * part after the second barrier (like visi_copy) and the last one done
+ * stores the round and the live cells and makes seq even again. A reader
+ * reads seq, the cells it wants and seq again, and reads them again when
+ * seq was odd or changed. The loaded board is published the same way, by
+ * a pool job.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "gol.h"
+
+struct gol_publisher{
+    struct gol_share *share; // the mapped object
+    size_t bytes;            // its size
+    const char *name;
+    long copy_round;         // the round being packed, and its live cells
+    long copy_live;
+    int copies_left;         // workers still packing, the last one publishes
+};
+
+/****************** Function Prototypes **********************/
+/* pool job: pack the worker's part of the loaded board */
+static void *share_part(void *arg);
+/* the size of the object holding a board */
+static size_t share_bytes(int rows, int words);
+
+/* create the shared memory object for a newly loaded board and publish
+ * the loaded board. An object of the same name left by a run before is
+ * unlinked first: readers still mapping it keep the old board.
+ * sim: the simulation, with a board loaded and split between the workers
+ * returns: 0 on success, 1 on error
+ */
+int start_share(struct gol_sim *sim){
+    struct gol_data *data = &sim->data;
+    struct gol_publisher *pub;
+    struct gol_share *share;
+    int fd, words;
+
+    pub = calloc(1, sizeof(struct gol_publisher));
+    if (pub == NULL){
+        printf("Error: malloc failed\n");
+        return 1;
+    }
+    words = (data->cols + 63) / 64;
+    pub->name = data->share_name;
+    pub->bytes = share_bytes(data->rows, words);
+    shm_unlink(pub->name);
+    fd = shm_open(pub->name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0){
+        printf("Error: failed to create shared memory object: %s\n", pub->name);
+        free(pub);
+        return 1;
+    }
+    if (ftruncate(fd, pub->bytes) != 0){
+        printf("Error: failed to size shared memory object: %s\n", pub->name);
+        close(fd);
+        shm_unlink(pub->name);
+        free(pub);
+        return 1;
+    }
+    share = mmap(NULL, pub->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the object
+    if (share == MAP_FAILED){
+        printf("Error: failed to map shared memory object: %s\n", pub->name);
+        shm_unlink(pub->name);
+        free(pub);
+        return 1;
+    }
+    /* a fresh object is all zeros: odd seq before the magic, so a reader
+     * that finds the magic waits for the first board */
+    share->seq = 1;
+    share->rows = data->rows;
+    share->cols = data->cols;
+    share->words = words;
+    share->pid = getpid();
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(share->magic, GOL_SHARE_MAGIC, sizeof(share->magic));
+    pub->share = share;
+    sim->publisher = pub;
+
+    /* the loaded board, packed by the workers like the rounds' boards */
+    pub->copy_round = data->round;
+    pub->copy_live = sim->live;
+    pub->copies_left = data->num_threads;
+    run_workers(sim, share_part);
+    return 0;
+}
+
+static void *share_part(void *arg){
+    share_copy((struct gol_data *)arg);
+    return NULL;
+}
+
+/* thread 0, between the barriers of a round: make seq odd, the board is
+ * written from now until the last worker has packed its part
+ * data: thread 0's struct gol_data (data->round the round being played)
+ * returns: none
+ */
+void share_round(struct gol_data *data){
+    struct gol_publisher *pub = data->sim->publisher;
+
+    __atomic_store_n(&pub->share->seq, pub->share->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE); // before any cell changes
+    pub->copy_round = data->round + 1;
+    pub->copy_live = data->sim->live;
+    pub->copies_left = data->num_threads;
+}
+
+/* every worker, after the second barrier of a round: pack its part of the
+ * board into the shared board; the last worker to finish stores the round
+ * and the live cells and makes seq even
+ * data: the worker's struct gol_data
+ * returns: none
+ */
+void share_copy(struct gol_data *data){
+    struct gol_publisher *pub = data->sim->publisher;
+    struct gol_share *share = pub->share;
+
+    pack_part(data, share->board, share->words);
+    if (__atomic_sub_fetch(&pub->copies_left, 1, __ATOMIC_ACQ_REL) == 0){
+        __atomic_store_n(&share->round, pub->copy_round, __ATOMIC_RELAXED);
+        __atomic_store_n(&share->live, pub->copy_live, __ATOMIC_RELAXED);
+        __atomic_store_n(&share->seq, share->seq + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/* let go of the shared board (nothing if there is none): readers still
+ * mapping it see it closed, with the last board, and the name is removed
+ * sim: the simulation, no rounds running
+ * returns: none
+ */
+void finish_share(struct gol_sim *sim){
+    struct gol_publisher *pub = sim->publisher;
+
+    if (pub == NULL){
+        return;
+    }
+    __atomic_store_n(&pub->share->closed, 1, __ATOMIC_RELEASE);
+    munmap(pub->share, pub->bytes);
+    shm_unlink(pub->name);
+    free(pub);
+    sim->publisher = NULL;
+}
+
+/* map the board of a simulation run with --share NAME, read only
+ * name: the shared memory object, e.g. "/gol"
+ * returns: the board, NULL on error
+ */
+struct gol_share *gol_share_open(const char *name){
+    struct gol_share *share;
+    struct stat st;
+    int fd;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0){
+        printf("Error: no shared board: %s\n", name);
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct gol_share)){
+        printf("Error: not a shared board: %s\n", name);
+        close(fd);
+        return NULL;
+    }
+    share = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (share == MAP_FAILED){
+        printf("Error: failed to map shared board: %s\n", name);
+        return NULL;
+    }
+    if (memcmp(share->magic, GOL_SHARE_MAGIC, sizeof(share->magic)) != 0
+        || share->rows < 1 || share->cols < 1 || share->words != (share->cols + 63) / 64
+        || share_bytes(share->rows, share->words) != (size_t)st.st_size){
+        printf("Error: not a shared board: %s\n", name);
+        munmap(share, st.st_size);
+        return NULL;
+    }
+    return share;
+}
+
+/* copy a rectangle of the latest board, again if a round was published
+ * while copying
+ * share: the board from gol_share_open
+ * row, col: the rectangle's top left cell
+ * rows, cols: its size, inside the board
+ * cells: room for rows * cols bytes, set to 1 (alive) or 0 (dead)
+ * round, live: set to the board's round and live cells
+ * returns: 0 on success, 1 if the rectangle is not on the board, -1 if
+ *          the board is gone (its simulation let go of it or died)
+ */
+int gol_share_region(struct gol_share *share, int row, int col, int rows, int cols,
+                     uint8_t *cells, long *round, long *live){
+    uint64_t seq;
+    int i, j;
+
+    if (row < 0 || col < 0 || rows < 0 || cols < 0
+        || row > share->rows - rows || col > share->cols - cols){
+        return 1;
+    }
+    if (gol_share_gone(share)){
+        return -1;
+    }
+    do {
+        seq = gol_share_begin(share);
+        if (seq == GOL_SHARE_CLOSED){
+            return -1;
+        }
+        for (i = 0; i < rows; ++i){
+            for (j = 0; j < cols; ++j){
+                cells[(size_t)i * cols + j] = gol_share_cell(share, row + i, col + j);
+            }
+        }
+        *round = share->round;
+        *live = share->live;
+    } while (gol_share_retry(share, seq));
+    return 0;
+}
+
+/* unmap a board from gol_share_open (NULL is ignored) */
+void gol_share_close(struct gol_share *share){
+    if (share != NULL){
+        munmap(share, share_bytes(share->rows, share->words));
+    }
+}
+
+static size_t share_bytes(int rows, int words){
+    return sizeof(struct gol_share) + sizeof(uint64_t) * (size_t)rows * words;
+}
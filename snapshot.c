@@ -0,0 +1,407 @@
+/*
+ * Binary snapshots of the board, for checkpoints (--checkpoint) and for
+ * loading big boards without parsing. A snapshot is a fixed header (the
+ * board size, the round the board is at, the round the run goes to, the
+ * rule and the boundary) followed by one of two bodies:
+ *
+ *   SNAP_BITS:  every row as (cols + 63) / 64 64-bit words, bit i of word
+ *               w is column 64 * w + i (the layout of the bits engine)
+ *   SNAP_CELLS: the live cells as sorted 64-bit keys row * cols + col
+ *               (the layout of the sparse engine)
+ *
+ * gol_save picks the smaller body. Numbers are stored in the byte order of
+ * the machine that wrote the snapshot. A snapshot is read with mmap and
+ * copied straight into the engine's board, and written to a temporary
+ * file that is renamed over the old one, so a crash while saving leaves
+ * the previous checkpoint intact.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "gol.h"
+
+#define SNAP_MAGIC "GOLSNAP2"
+#define SNAP_BITS (1)  // bit-packed rows
+#define SNAP_CELLS (2) // sorted live cell keys
+
+struct snapshot_header{
+    char magic[8];     // SNAP_MAGIC
+    uint32_t body;     // SNAP_BITS or SNAP_CELLS
+    uint32_t boundary; // BOUNDARY_TORUS or BOUNDARY_DEAD
+    int64_t rows;
+    int64_t cols;
+    int64_t round;     // the rounds the board has been advanced
+    int64_t iters;     // the rounds the run was asked for in all
+    int64_t live;      // live cells (the number of keys of SNAP_CELLS)
+    char rule[24];     // the rule the board was computed with, "B3/S23"
+};
+
+/****************** Function Prototypes **********************/
+/* write the body of a snapshot */
+static int write_bits(struct gol_data *data, FILE *outfile);
+static int write_cells(struct gol_data *data, FILE *outfile, uint64_t *cells, long live);
+/* the live cells of the board as sorted keys */
+static uint64_t *collect_cells(struct gol_data *data, long *live);
+
+/* does a file start like a snapshot
+ * path: the file
+ * returns: 1 if it does, 0 otherwise (also if it cannot be read)
+ */
+int is_snapshot(const char *path){
+    char magic[8];
+    FILE *infile;
+    int ret = 0;
+
+    infile = fopen(path, "rb");
+    if (infile == NULL){
+        return 0;
+    }
+    if (fread(magic, 1, sizeof(magic), infile) == sizeof(magic)){
+        ret = (memcmp(magic, SNAP_MAGIC, sizeof(magic)) == 0);
+    }
+    fclose(infile);
+    return ret;
+}
+
+/* initialize the gol game state from a snapshot
+ * data: pointer to gol_data struct to initialize, with the options and
+ *       the thread configuration already set
+ * path: the snapshot
+ * returns: 0 on success, 1 on error
+ */
+int init_game_data_from_snapshot(struct gol_data *data, const char *path){
+    const struct snapshot_header *header;
+    const uint64_t *body, *row;
+    char rule[sizeof(header->rule) + 1];
+    struct stat st;
+    uint64_t bits, key, cells;
+    size_t words, size;
+    long i;
+    int fd, r, w, ret;
+    void *map;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0){
+        printf("Error: failed to open file: %s \n", path);
+        if (fd >= 0){
+            close(fd);
+        }
+        return 1;
+    }
+    if ((size_t)st.st_size < sizeof(struct snapshot_header)){
+        printf("Error: snapshot too short: %s\n", path);
+        close(fd);
+        return 1;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED){
+        printf("Error: failed to map the snapshot: %s\n", path);
+        return 1;
+    }
+    header = map;
+    body = (const uint64_t *)(header + 1);
+
+    /* check the header before trusting any size in it */
+    ret = 1;
+    if (header->rows < 1 || header->rows > 0x7fffffff || header->cols < 1 || header->cols > 0x7fffffff
+        || header->round < 0 || header->round > header->iters
+        || header->live < 0){
+        printf("Error: bad snapshot header: %s\n", path);
+        goto done;
+    }
+    if (data->rounds >= 0 && data->rounds < header->round){
+        printf("Error: snapshot is at round %ld, past --rounds %ld: %s\n", (long)header->round,
+               data->rounds, path);
+        goto done;
+    }
+    memcpy(rule, header->rule, sizeof(header->rule));
+    rule[sizeof(header->rule)] = '\0';
+    if (use_file_rule(data, rule, path) != 0){
+        goto done;
+    }
+    if ((int)header->boundary != data->boundary){
+        printf("Error: snapshot was computed with the other --boundary: %s\n", path);
+        goto done;
+    }
+    words = (header->cols + 63) / 64;
+    cells = (uint64_t)header->rows * header->cols;
+    if (header->body == SNAP_BITS){
+        size = sizeof(uint64_t) * words * header->rows;
+    }
+    else if (header->body == SNAP_CELLS){
+        size = sizeof(uint64_t) * header->live;
+    }
+    else{
+        printf("Error: unknown snapshot body: %s\n", path);
+        goto done;
+    }
+    if ((size_t)st.st_size != sizeof(struct snapshot_header) + size){
+        printf("Error: snapshot has the wrong size: %s\n", path);
+        goto done;
+    }
+
+    /* and the body, before anything is allocated */
+    if (header->body == SNAP_BITS && header->cols % 64 != 0){
+        for (r = 0; r < header->rows; ++r){ // nothing past the last column
+            if (body[(size_t)r * words + words - 1] >> (header->cols % 64) != 0){
+                printf("Error: cell past the last column in the snapshot: %s\n", path);
+                goto done;
+            }
+        }
+    }
+    if (header->body == SNAP_CELLS){
+        for (i = 0; i < header->live; ++i){
+            key = body[i];
+            if (key >= cells || (i > 0 && key <= body[i - 1])){
+                printf("Error: snapshot cells out of order: %s\n", path);
+                goto done;
+            }
+        }
+    }
+
+    data->rows = header->rows;
+    data->cols = header->cols;
+    data->iters = (data->rounds >= 0) ? data->rounds : header->iters;
+    data->init_cells = header->live;
+    data->round = header->round;
+    alloc_board(data);
+
+    if (header->body == SNAP_BITS && data->engine == ENGINE_BITS){
+        memcpy(data->bits_world, body, size); // the same layout
+    }
+    else if (header->body == SNAP_BITS){
+        for (r = 0; r < data->rows; ++r){
+            row = body + (size_t)r * words;
+            for (w = 0; w < (int)words; ++w){
+                for (bits = row[w]; bits != 0; bits &= bits - 1){
+                    set_cell(data, r, 64 * w + __builtin_ctzll(bits));
+                }
+            }
+        }
+    }
+    else if (data->engine == ENGINE_SPARSE || data->engine == ENGINE_HASHLIFE){
+        free(data->sparse_cells);
+        data->sparse_cells = malloc(sizeof(uint64_t) * (header->live + 1));
+        if (data->sparse_cells == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+        memcpy(data->sparse_cells, body, size); // the same layout
+        data->sparse_count = header->live;
+        data->sparse_cap = header->live + 1;
+    }
+    else{
+        for (i = 0; i < header->live; ++i){
+            set_cell(data, body[i] / data->cols, body[i] % data->cols);
+        }
+    }
+    finish_board(data);
+    ret = 0;
+done:
+    munmap(map, st.st_size);
+    return ret;
+}
+
+/* write the board and its round to a snapshot gol_load can read back:
+ * first to path.tmp, which then replaces path
+ *   sim: the simulation, no rounds running
+ *   path: the snapshot
+ *   returns: 0 on success, 1 on error
+ */
+int gol_save(struct gol_sim *sim, const char *path){
+    struct gol_data *data = &sim->threads[0]; // has the current world pointers
+    struct snapshot_header header;
+    uint64_t *cells = NULL;
+    char *tmp_path;
+    FILE *outfile;
+    long live = 0;
+    int ret;
+
+    if (!sim->loaded || sim->busy){
+        printf("Error: gol_save needs a loaded board and no running rounds\n");
+        return 1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAP_MAGIC, sizeof(header.magic));
+    snprintf(header.rule, sizeof(header.rule), "%s", data->rule.name);
+    header.boundary = data->boundary;
+    header.rows = data->rows;
+    header.cols = data->cols;
+    header.round = sim->data.round;
+    header.iters = sim->file_iters;
+    header.live = gol_population(sim);
+    header.body = SNAP_BITS;
+    /* a key per live cell is smaller than the bit-packed board when fewer
+     * cells than words are alive; the sparse and the hashlife board are
+     * never packed */
+    if (data->engine == ENGINE_SPARSE || data->engine == ENGINE_HASHLIFE
+        || header.live < (int64_t)data->rows * ((data->cols + 63) / 64)){
+        cells = collect_cells(data, &live);
+        header.body = SNAP_CELLS;
+        header.live = live;
+    }
+
+    tmp_path = malloc(strlen(path) + 5);
+    if (tmp_path == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    sprintf(tmp_path, "%s.tmp", path);
+    outfile = fopen(tmp_path, "wb");
+    if (outfile == NULL){
+        printf("Error: failed to open file: %s\n", tmp_path);
+        free(tmp_path);
+        free(cells);
+        return 1;
+    }
+    ret = (fwrite(&header, sizeof(header), 1, outfile) != 1);
+    if (ret == 0 && header.body == SNAP_BITS){
+        ret = write_bits(data, outfile);
+    }
+    else if (ret == 0){
+        ret = write_cells(data, outfile, cells, live);
+    }
+    ret |= (fflush(outfile) != 0);
+    ret |= (fsync(fileno(outfile)) != 0); // on disk before it replaces the old checkpoint
+    ret |= (fclose(outfile) != 0);
+    if (ret == 0 && rename(tmp_path, path) != 0){
+        ret = 1;
+    }
+    if (ret != 0){
+        printf("Error: failed to write the snapshot: %s\n", path);
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+    free(cells);
+    return ret;
+}
+
+/* write a bit-packed board to a snapshot, without a simulation (the
+ * boards replayed from a --record stream)
+ *   path: the snapshot
+ *   bits: the board, (cols + 63) / 64 words per row
+ *   rows, cols: its size
+ *   round: the rounds the board has been advanced
+ *   iters: the rounds the run was asked for in all
+ *   rule: the rule the board was computed with
+ *   boundary: BOUNDARY_TORUS or BOUNDARY_DEAD
+ *   returns: 0 on success, 1 on error
+ */
+int save_bits(const char *path, const uint64_t *bits, int rows, int cols, long round,
+              long iters, const char *rule, int boundary){
+    struct snapshot_header header;
+    size_t words = (cols + 63) / 64, i;
+    FILE *outfile;
+    int ret;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAP_MAGIC, sizeof(header.magic));
+    snprintf(header.rule, sizeof(header.rule), "%s", rule);
+    header.body = SNAP_BITS;
+    header.boundary = boundary;
+    header.rows = rows;
+    header.cols = cols;
+    header.round = round;
+    header.iters = iters;
+    for (i = 0; i < words * rows; ++i){
+        header.live += __builtin_popcountll(bits[i]);
+    }
+    outfile = fopen(path, "wb");
+    if (outfile == NULL){
+        printf("Error: failed to open file: %s\n", path);
+        return 1;
+    }
+    ret = (fwrite(&header, sizeof(header), 1, outfile) != 1);
+    ret |= (fwrite(bits, sizeof(uint64_t) * words, rows, outfile) != (size_t)rows);
+    ret |= (fclose(outfile) != 0);
+    if (ret != 0){
+        printf("Error: failed to write the snapshot: %s\n", path);
+    }
+    return ret;
+}
+
+static int write_bits(struct gol_data *data, FILE *outfile){
+    size_t words = (data->cols + 63) / 64;
+    uint64_t *row;
+    int r, c;
+
+    if (data->engine == ENGINE_BITS){
+        return fwrite(data->bits_world, sizeof(uint64_t) * words, data->rows, outfile)
+               != (size_t)data->rows;
+    }
+    row = malloc(sizeof(uint64_t) * words);
+    if (row == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    for (r = 0; r < data->rows; ++r){
+        memset(row, 0, sizeof(uint64_t) * words);
+        for (c = 0; c < data->cols; ++c){
+            if (gol_cell(data, r, c)){
+                row[c / 64] |= (uint64_t)1 << (c % 64);
+            }
+        }
+        if (fwrite(row, sizeof(uint64_t), words, outfile) != words){
+            free(row);
+            return 1;
+        }
+    }
+    free(row);
+    return 0;
+}
+
+static int write_cells(struct gol_data *data, FILE *outfile, uint64_t *cells, long live){
+    return live > 0 && fwrite(cells, sizeof(uint64_t), live, outfile) != (size_t)live;
+}
+
+static uint64_t *collect_cells(struct gol_data *data, long *live){
+    uint64_t *cells;
+    long n = 0, cap;
+    int r, c;
+
+    if (data->engine == ENGINE_SPARSE || data->engine == ENGINE_HASHLIFE){
+        *live = (data->engine == ENGINE_SPARSE) ? get_sparse_cells(data, NULL)
+                                                 : get_hashlife_cells(data, NULL);
+        cells = malloc(sizeof(uint64_t) * (*live + 1));
+        if (cells == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+        if (data->engine == ENGINE_SPARSE){
+            get_sparse_cells(data, cells);
+        }
+        else{
+            get_hashlife_cells(data, cells);
+        }
+        return cells;
+    }
+    cap = 1024;
+    cells = malloc(sizeof(uint64_t) * cap);
+    if (cells == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    for (r = 0; r < data->rows; ++r){
+        for (c = 0; c < data->cols; ++c){
+            if (!gol_cell(data, r, c)){
+                continue;
+            }
+            if (n == cap){
+                cap *= 2;
+                cells = realloc(cells, sizeof(uint64_t) * cap);
+                if (cells == NULL){
+                    printf("Error: malloc failed\n");
+                    exit(1);
+                }
+            }
+            cells[n++] = (uint64_t)r * data->cols + c;
+        }
+    }
+    *live = n;
+    return cells;
+}
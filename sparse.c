@@ -0,0 +1,547 @@
+/*
+ * Sparse engine: only the live cells are stored, as sorted arrays of cell
+ * keys (row * cols + col), so memory follows the population instead of
+ * the area of the board and a few gliders on a 1,000,000 x 1,000,000
+ * torus cost a few kilobytes.
+ *
+ * Every thread owns a band of rows and keeps the live cells of its band.
+ * To compute a round it reads its own cells plus the row just above and
+ * just below its band from the neighboring bands, adds every live cell
+ * into the neighbor counts of the (up to) nine cells around it that lie
+ * in its band, using an open-addressing hash table, and keeps the cells
+ * the counts bring to life. Each band has two cell arrays, one for even
+ * and one for odd rounds, so a thread writes the next generation while
+ * the others still read the current one.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "gol.h"
+
+#define SPARSE_EMPTY (~(uint64_t)0) // an unused hash table slot
+
+struct sparse_band{
+    int row_start;      // the rows of the board this band holds
+    int row_end;
+    uint64_t *cells[2]; // sorted live cell keys, by parity of the round
+    long count[2];
+    long cap[2];
+    uint64_t *keys;     // this thread's neighbor count table
+    uint8_t *counts;    // 2 * live neighbors, plus 1 if the cell is alive
+    size_t slots;       // size of the table, a power of two
+    size_t used;        // slots holding a key this round
+    char pad[64];       // keep neighboring bands on separate cache lines
+};
+
+/****************** Function Prototypes **********************/
+/* index of the first key >= key in a sorted array */
+static long lower_key(const uint64_t *cells, long count, uint64_t key);
+/* grow a band's cell array of one parity to hold at least n keys */
+static void reserve_cells(struct sparse_band *band, int parity, long n);
+
+/* allocate one (empty) band per thread
+ * data: pointer to gol_data struct with num_threads set
+ * returns: 0 on success, 1 on error
+ */
+int init_sparse(struct gol_data *data){
+    data->bands = calloc(data->num_threads, sizeof(struct sparse_band));
+    if (data->bands == NULL){
+        return 1;
+    }
+    data->sparse_now = 0;
+    return 0;
+}
+
+/* free the bands and the initial cells */
+void free_sparse(struct gol_data *data){
+    int i;
+    for (i = 0; i < data->num_threads; ++i){
+        free(data->bands[i].cells[0]);
+        free(data->bands[i].cells[1]);
+        free(data->bands[i].keys);
+        free(data->bands[i].counts);
+    }
+    free(data->bands);
+    free(data->sparse_cells);
+}
+
+static int compare_keys(const void *a, const void *b){
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* add a cell to the initial live cells read from the input file
+ * data: pointer to gol_data struct
+ * row: the row of the cell
+ * col: the column of the cell
+ * returns: 0 on success, 1 on error
+ */
+int add_sparse_cell(struct gol_data *data, int row, int col){
+    uint64_t *cells;
+    long cap;
+
+    if (row < 0 || row >= data->rows || col < 0 || col >= data->cols){
+        return 1;
+    }
+    if (data->sparse_count == data->sparse_cap){
+        cap = data->sparse_cap ? data->sparse_cap * 2 : 1024;
+        cells = realloc(data->sparse_cells, sizeof(uint64_t) * cap);
+        if (cells == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+        data->sparse_cells = cells;
+        data->sparse_cap = cap;
+    }
+    data->sparse_cells[data->sparse_count++] = (uint64_t)row * data->cols + col;
+    return 0;
+}
+
+/* sort the initial live cells and drop the ones listed twice
+ * data: pointer to gol_data struct
+ * returns: none
+ */
+void sort_sparse_cells(struct gol_data *data){
+    long i, n;
+
+    qsort(data->sparse_cells, data->sparse_count, sizeof(uint64_t), compare_keys);
+    n = 0;
+    for (i = 0; i < data->sparse_count; ++i){
+        if (n == 0 || data->sparse_cells[n - 1] != data->sparse_cells[i]){
+            data->sparse_cells[n++] = data->sparse_cells[i];
+        }
+    }
+    data->sparse_count = n;
+}
+
+/* read a cell of the current generation
+ * data: pointer to gol_data struct
+ * row: the row of the cell
+ * col: the column of the cell
+ * returns: 1 if the cell is alive, 0 otherwise
+ */
+int get_sparse_cell(struct gol_data *data, int row, int col){
+    struct sparse_band *band;
+    uint64_t key = (uint64_t)row * data->cols + col;
+    long i;
+    int t;
+
+    if (data->first_batch){ // the bands take their cells in the first round
+        i = lower_key(data->sparse_cells, data->sparse_count, key);
+        return i < data->sparse_count && data->sparse_cells[i] == key;
+    }
+    for (t = 0; t < data->num_threads; ++t){
+        band = &data->bands[t];
+        if (row >= band->row_start && row <= band->row_end){
+            i = lower_key(band->cells[data->sparse_now], band->count[data->sparse_now], key);
+            return i < band->count[data->sparse_now] && band->cells[data->sparse_now][i] == key;
+        }
+    }
+    return 0;
+}
+
+/* copy the live cells of the current generation, sorted (the bands hold
+ * ascending rows)
+ * data: pointer to gol_data struct
+ * out: room for all the cells, or NULL to only count them
+ * returns: the number of live cells
+ */
+long get_sparse_cells(struct gol_data *data, uint64_t *out){
+    struct sparse_band *band;
+    long n = 0;
+    int t;
+
+    if (data->first_batch){
+        if (out != NULL && data->sparse_count > 0){
+            memcpy(out, data->sparse_cells, sizeof(uint64_t) * data->sparse_count);
+        }
+        return data->sparse_count;
+    }
+    for (t = 0; t < data->num_threads; ++t){
+        band = &data->bands[t];
+        if (out != NULL && band->count[data->sparse_now] > 0){
+            memcpy(out + n, band->cells[data->sparse_now], sizeof(uint64_t) * band->count[data->sparse_now]);
+        }
+        n += band->count[data->sparse_now];
+    }
+    return n;
+}
+
+/* hash the calling thread's band of the current generation (--cycles)
+ * data: the worker's struct gol_data, its band loaded
+ * returns: the hash of the band's sorted cell keys
+ */
+uint64_t hash_sparse_band(struct gol_data *data){
+    struct sparse_band *band = &data->bands[data->thread_id];
+
+    return hash_words(band->cells[data->sparse_now], band->count[data->sparse_now], band->row_start);
+}
+
+/* write the calling thread's band of the current generation into the
+ * same rows of a bit-packed board (before the first round: the band's
+ * share of the cells read from the input file)
+ * data: the worker's struct gol_data
+ * bits: the board, words words per row, bit i of word w column 64 * w + i
+ * words: the words of a row
+ * returns: none
+ */
+void pack_sparse_band(struct gol_data *data, uint64_t *bits, int words){
+    struct sparse_band *band = &data->bands[data->thread_id];
+    const uint64_t *cells;
+    long count, first, i;
+    int row, col;
+
+    if (data->thread_row_end < data->thread_row_start){
+        return;
+    }
+    memset(bits + (size_t)data->thread_row_start * words, 0,
+           sizeof(uint64_t) * words * (data->thread_row_end - data->thread_row_start + 1));
+    if (data->first_batch){
+        first = lower_key(data->sparse_cells, data->sparse_count,
+                          (uint64_t)data->thread_row_start * data->cols);
+        count = lower_key(data->sparse_cells, data->sparse_count,
+                          (uint64_t)(data->thread_row_end + 1) * data->cols) - first;
+        cells = data->sparse_cells + first;
+    }
+    else{
+        cells = band->cells[data->sparse_now];
+        count = band->count[data->sparse_now];
+    }
+    for (i = 0; i < count; ++i){
+        row = cells[i] / data->cols;
+        col = cells[i] % data->cols;
+        bits[(size_t)row * words + col / 64] |= (uint64_t)1 << (col % 64);
+    }
+}
+
+static long lower_key(const uint64_t *cells, long count, uint64_t key){
+    long lo = 0, hi = count, mid;
+    while (lo < hi){
+        mid = lo + (hi - lo) / 2;
+        if (cells[mid] < key){
+            lo = mid + 1;
+        }
+        else{
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void reserve_cells(struct sparse_band *band, int parity, long n){
+    uint64_t *cells;
+    long cap;
+
+    if (n <= band->cap[parity]){
+        return;
+    }
+    cap = band->cap[parity] ? band->cap[parity] : 1024;
+    while (cap < n){
+        cap *= 2;
+    }
+    cells = realloc(band->cells[parity], sizeof(uint64_t) * cap);
+    if (cells == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    band->cells[parity] = cells;
+    band->cap[parity] = cap;
+}
+
+/* the band holding a row of the board
+ * returns: the band, or NULL when the row is not on the board */
+static struct sparse_band *row_band(struct gol_data *data, int row){
+    int t;
+
+    if (data->boundary == BOUNDARY_TORUS){
+        row = (row + data->rows) % data->rows;
+    }
+    for (t = 0; t < data->num_threads; ++t){
+        if (row >= data->bands[t].row_start && row <= data->bands[t].row_end){
+            return &data->bands[t];
+        }
+    }
+    return NULL;
+}
+
+/* the first table slot to probe for a key: runs of 16 cells of a row
+ * share a stretch of the table, so the neighbors of sorted cells stay in
+ * cache */
+static inline size_t first_slot(struct sparse_band *band, uint64_t key){
+    int shift = 64 - __builtin_ctzll(band->slots >> 4);
+    return (size_t)((((key >> 4) * 0x9e3779b97f4a7c15ull) >> shift << 4) | (key & 15))
+           & (band->slots - 1);
+}
+
+/* give the table of a band a new size (a power of two of at least 64),
+ * keeping the counts already in it
+ * returns: none */
+static void resize_table(struct sparse_band *band, size_t slots){
+    uint64_t *old_keys = band->keys;
+    uint8_t *old_counts = band->counts;
+    size_t old_slots = band->slots, i, slot;
+
+    band->keys = malloc(sizeof(uint64_t) * slots);
+    band->counts = malloc(sizeof(uint8_t) * slots);
+    if (band->keys == NULL || band->counts == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    band->slots = slots;
+    memset(band->keys, 0xff, sizeof(uint64_t) * slots);
+    memset(band->counts, 0, sizeof(uint8_t) * slots);
+    for (i = 0; i < old_slots && band->used > 0; ++i){
+        if (old_keys[i] != SPARSE_EMPTY){
+            slot = first_slot(band, old_keys[i]);
+            while (band->keys[slot] != SPARSE_EMPTY){
+                slot = (slot + 1) & (slots - 1);
+            }
+            band->keys[slot] = old_keys[i];
+            band->counts[slot] = old_counts[i];
+        }
+    }
+    free(old_keys);
+    free(old_counts);
+}
+
+/* add the live cells keys[first..last) into the neighbor counts of the
+ * cells around them that lie in the rows row_start..row_end */
+static void count_cells(struct gol_data *data, struct sparse_band *band,
+                        const uint64_t *cells, long first, long last){
+    uint64_t key;
+    size_t slot;
+    long i;
+    int row, col, dy, dx, y, x;
+
+    for (i = first; i < last; ++i){
+        row = (int)(cells[i] / data->cols);
+        col = (int)(cells[i] % data->cols);
+        for (dy = -1; dy <= 1; ++dy){
+            y = row + dy;
+            if (data->boundary == BOUNDARY_TORUS){
+                y = (y < 0) ? y + data->rows : (y >= data->rows) ? y - data->rows : y;
+            }
+            if (y < band->row_start || y > band->row_end){
+                continue;
+            }
+            for (dx = -1; dx <= 1; ++dx){
+                x = col + dx;
+                if (x < 0 || x >= data->cols){
+                    if (data->boundary == BOUNDARY_DEAD){
+                        continue;
+                    }
+                    x = (x < 0) ? x + data->cols : x - data->cols;
+                }
+                key = (uint64_t)y * data->cols + x;
+                slot = first_slot(band, key);
+                while (band->keys[slot] != key && band->keys[slot] != SPARSE_EMPTY){
+                    slot = (slot + 1) & (band->slots - 1);
+                }
+                if (band->keys[slot] == SPARSE_EMPTY){
+                    band->keys[slot] = key;
+                    if (++band->used * 2 > band->slots){
+                        // keep the table at most half full
+                        band->counts[slot] += (dy == 0 && dx == 0) ? 1 : 2;
+                        resize_table(band, band->slots * 2);
+                        continue;
+                    }
+                }
+                band->counts[slot] += (dy == 0 && dx == 0) ? 1 : 2;
+            }
+        }
+    }
+}
+
+/* compute one round of the calling thread's band
+ * data: pointer to gol_data struct of the calling thread
+ * returns: the number of live cells in the band after this round
+ */
+static long step_sparse_band(struct gol_data *data){
+    struct sparse_band *band = &data->bands[data->thread_id];
+    struct sparse_band *above, *below;
+    int now = data->sparse_now, next = now ^ 1;
+    long sources, a_first, a_last, b_first, b_last, n;
+    uint64_t row_key;
+    uint32_t rule;
+    size_t slots, i;
+    int above_row, below_row, k;
+
+    band->count[next] = 0;
+    if (band->row_start > band->row_end){
+        return 0;
+    }
+
+    /* the row above and below the band, when they are on the board and
+     * not in the band itself (a board of one or two bands wraps onto it) */
+    above = NULL;
+    below = NULL;
+    above_row = (band->row_start - 1 + data->rows) % data->rows;
+    below_row = (band->row_end + 1) % data->rows;
+    if (band->row_start > 0 || data->boundary == BOUNDARY_TORUS){
+        above = row_band(data, band->row_start - 1);
+    }
+    if (band->row_end < data->rows - 1 || data->boundary == BOUNDARY_TORUS){
+        below = row_band(data, band->row_end + 1);
+    }
+    if (above == band){
+        above = NULL;
+    }
+    if (below == band || (below_row == above_row && above != NULL)){
+        below = NULL;
+    }
+    a_first = a_last = b_first = b_last = 0;
+    if (above != NULL){
+        row_key = (uint64_t)above_row * data->cols;
+        a_first = lower_key(above->cells[now], above->count[now], row_key);
+        a_last = lower_key(above->cells[now], above->count[now], row_key + data->cols);
+    }
+    if (below != NULL){
+        row_key = (uint64_t)below_row * data->cols;
+        b_first = lower_key(below->cells[now], below->count[now], row_key);
+        b_last = lower_key(below->cells[now], below->count[now], row_key + data->cols);
+    }
+
+    /* a source cell touches up to nine cells, but live cells crowd
+     * together and share most of them: start at four slots per source
+     * cell and let the table grow when it fills up */
+    sources = band->count[now] + (a_last - a_first) + (b_last - b_first);
+    if (sources == 0){
+        return 0;
+    }
+    slots = 64;
+    while (slots < (size_t)sources * 4){
+        slots *= 2;
+    }
+    band->used = 0;
+    if (slots > band->slots || slots * 4 < band->slots){
+        resize_table(band, slots);
+    }
+    else{
+        memset(band->keys, 0xff, sizeof(uint64_t) * band->slots);
+        memset(band->counts, 0, sizeof(uint8_t) * band->slots);
+    }
+
+    count_cells(data, band, band->cells[now], 0, band->count[now]);
+    if (above != NULL){
+        count_cells(data, band, above->cells[now], a_first, a_last);
+    }
+    if (below != NULL){
+        count_cells(data, band, below->cells[now], b_first, b_last);
+    }
+
+    /* the rule as one bit per count, 2 * neighbors + alive: B3/S23 is
+     * bits 6 and 7 (3 neighbors) and bit 5 (2 neighbors and alive). A
+     * count of 0 never comes alive (check_rule turns B0 away). */
+    rule = 0;
+    for (k = 0; k <= 8; ++k){
+        rule |= (uint32_t)data->rule.next[0][k] << (2 * k);
+        rule |= (uint32_t)data->rule.next[1][k] << (2 * k + 1);
+    }
+    n = 0;
+    reserve_cells(band, next, (long)band->used);
+    for (i = 0; i < band->slots; ++i){
+        if ((rule >> band->counts[i]) & 1){
+            band->cells[next][n++] = band->keys[i];
+        }
+    }
+    qsort(band->cells[next], n, sizeof(uint64_t), compare_keys);
+    band->count[next] = n;
+    return n;
+}
+
+/* the sparse gol main loop, same structure as play_gol: each thread
+ * computes its band of rows, publishes its live count for thread 0 to sum and
+ * meets the others at the barrier.
+ *   arg: pointer to a struct gol_data initialized with all GOL game state
+ *  returns: nothing--void function
+ */
+void *play_gol_sparse(void *arg){
+    struct gol_data *data = ((struct gol_data *)arg);
+    struct sparse_band *band = &data->bands[data->thread_id];
+    int row_difference, col_difference, ret1, ret2;
+    long first, last, cell;
+
+    row_difference = data->thread_row_end - data->thread_row_start + 1;
+    col_difference = data->thread_col_end - data->thread_col_start + 1;
+    if (data->partition_yes_no == 1 && data->first_batch){ //checks to print partition info
+        printf("tid %d: rows: %d:%d (%d) cols: %d:%d (%d)\n", data->thread_id, data->thread_row_start, data->thread_row_end, row_difference,
+               data->thread_col_start, data->thread_col_end, col_difference);
+    }
+
+    /* take this band's share of the cells read from the input file (later
+     * batches of rounds go on from the cells the band already holds) */
+    if (data->first_batch){
+        band->row_start = data->thread_row_start;
+        band->row_end = data->thread_row_end;
+        first = lower_key(data->sparse_cells, data->sparse_count, (uint64_t)band->row_start * data->cols);
+        last = lower_key(data->sparse_cells, data->sparse_count, (uint64_t)(band->row_end + 1) * data->cols);
+        if (last > first){
+            reserve_cells(band, 0, last - first);
+            memcpy(band->cells[0], data->sparse_cells + first, sizeof(uint64_t) * (last - first));
+            band->count[0] = last - first;
+        }
+    }
+    start_rounds(data);
+    data->first_batch = 0;
+    TRACE_MARK(data, TRACE_START);
+
+    while (data->round < data->iters){
+        if (data->cycle != NULL){
+            hash_part(data);
+        }
+        cell = step_sparse_band(data);
+        publish_live(data, cell);
+        data->sparse_now ^= 1; // swapping worlds around
+
+        TRACE_MARK(data, TRACE_COMPUTE);
+        ret1 = gol_barrier_wait(&data->sim->barrier);
+        if(ret1 != 0 && ret1 != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("pthread_barrier_wait");
+            exit(1);
+        }
+        TRACE_MARK(data, TRACE_BARRIER);
+        if (data->thread_id == 0){
+            reduce_live(data, 1);
+            if(data->output_mode == OUTPUT_ASCII){
+                render_frame(data);
+            }
+            else if(data->output_mode == OUTPUT_VISI){
+                visi_round(data, 1);
+            }
+            if (data->cycle != NULL){
+                cycle_round(data);
+            }
+            if (data->sim->record != NULL){
+                record_round(data);
+            }
+            if (data->sim->publisher != NULL){
+                share_round(data);
+            }
+            TRACE_MARK(data, TRACE_SERIAL);
+        }
+        ret2 = gol_barrier_wait(&data->sim->barrier);
+        if(ret2 != 0 && ret2 != PTHREAD_BARRIER_SERIAL_THREAD) {
+            perror("pthread_barrier_wait");
+            exit(1);
+        }
+        TRACE_MARK(data, TRACE_RELEASE);
+        if (data->output_mode == OUTPUT_VISI){
+            visi_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->sim->record != NULL){
+            record_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->sim->publisher != NULL){
+            share_copy(data);
+            TRACE_MARK(data, TRACE_COPY);
+        }
+        if (data->cycle != NULL && data->cycle->end >= 0){
+            data->iters = data->cycle->end; // the board repeats, see cycle.c
+        }
+        data->round += 1;
+    }
+    return NULL;
+}
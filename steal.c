@@ -0,0 +1,197 @@
+/*
+ * Work-stealing tile scheduler for the dense engine (partition flag 2).
+ * The board is cut into tiles and every thread starts each round with a
+ * deque holding its share of them. A thread pops tiles from the bottom of
+ * its own deque; once that is empty it steals from the top of the other
+ * threads' deques, so a thread whose tiles are cheap helps the ones
+ * stuck with the live regions instead of waiting at the barrier.
+ *
+ * The deques are Chase-Lev deques over a fixed array: no tiles are added
+ * while a round is being computed, so they never grow, and each owner
+ * refills its deque between the two barriers of the previous round.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "gol.h"
+
+#define STEAL_EMPTY (-1) // nothing left to take
+#define STEAL_ABORT (-2) // lost a race for the last tile, try again
+
+struct tile_deque{
+    long top;      // thieves take from here
+    long bottom;   // the owner pushes and pops here
+    int *tiles;
+    int first;     // the tiles this thread is handed every round
+    int count;
+    char pad[64];  // keep neighboring deques on separate cache lines
+};
+
+/****************** Function Prototypes **********************/
+/* put a thread's tiles back into its deque */
+static void refill_deque(struct tile_deque *dq);
+
+/* allocate one deque per thread and the per-tile live counts, and hand
+ * out the tiles in contiguous runs
+ * data: pointer to gol_data struct with tile_rows and tile_cols set
+ * returns: 0 on success, 1 on error
+ */
+int init_steal(struct gol_data *data){
+    int i, n;
+
+    n = data->tile_rows * data->tile_cols;
+    data->deques = calloc(data->num_threads, sizeof(struct tile_deque));
+    data->tile_live = calloc(n, sizeof(long));
+    if (data->deques == NULL || data->tile_live == NULL){
+        return 1;
+    }
+    for (i = 0; i < data->num_threads; ++i){
+        data->deques[i].first = (int)((long)n * i / data->num_threads);
+        data->deques[i].count = (int)((long)n * (i + 1) / data->num_threads) - data->deques[i].first;
+        data->deques[i].tiles = malloc(sizeof(int) * (data->deques[i].count + 1));
+        if (data->deques[i].tiles == NULL){
+            return 1;
+        }
+    }
+    for (i = 0; i < data->num_threads; ++i){
+        refill_deque(&data->deques[i]);
+    }
+    return 0;
+}
+
+/* free the deques and the per-tile live counts */
+void free_steal(struct gol_data *data){
+    int i;
+    for (i = 0; i < data->num_threads; ++i){
+        free(data->deques[i].tiles);
+    }
+    free(data->deques);
+    free(data->tile_live);
+}
+
+/* put a thread's tiles back into its deque */
+static void refill_deque(struct tile_deque *dq){
+    int i;
+
+    /* pushed in reverse so the owner pops its tiles in board order */
+    for (i = 0; i < dq->count; ++i){
+        dq->tiles[i] = dq->first + dq->count - 1 - i;
+    }
+    __atomic_store_n(&dq->top, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&dq->bottom, dq->count, __ATOMIC_RELEASE);
+}
+
+/* put the calling thread's tiles back into its deque for the next round.
+ * Only called while no thread is stealing (between the barriers).
+ * data: pointer to gol_data struct of the calling thread
+ * returns: none
+ */
+void fill_deque(struct gol_data *data){
+    refill_deque(&data->deques[data->thread_id]);
+}
+
+/* take a tile from the bottom of the caller's own deque
+ * returns: a tile, or STEAL_EMPTY */
+static int pop_tile(struct tile_deque *dq){
+    long b, t;
+    int tile;
+
+    b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&dq->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+    if (t > b){
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+        return STEAL_EMPTY;
+    }
+    tile = dq->tiles[b];
+    if (t == b){
+        /* the last tile: race the thieves for it */
+        if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, 0,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)){
+            tile = STEAL_EMPTY;
+        }
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return tile;
+}
+
+/* take a tile from the top of another thread's deque
+ * returns: a tile, STEAL_EMPTY or STEAL_ABORT */
+static int steal_tile(struct tile_deque *dq){
+    long b, t;
+    int tile;
+
+    t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b){
+        return STEAL_EMPTY;
+    }
+    tile = dq->tiles[t];
+    if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)){
+        return STEAL_ABORT;
+    }
+    return tile;
+}
+
+/* compute (or, with --active-tiles, possibly skip) one tile
+ * returns: the number of live cells in the tile after this round */
+static long run_tile(struct gol_data *data, int tile){
+    int ty, tx, r, r0, r1, c0, c1, changed;
+    long live;
+
+    ty = tile / data->tile_cols;
+    tx = tile % data->tile_cols;
+    if (data->track_tiles && !tile_active(data, ty, tx)){
+        data->tiles_skipped++;
+        return data->tile_live[tile];
+    }
+    r0 = ty * data->tile_size;
+    r1 = (r0 + data->tile_size - 1 < data->rows - 1) ? r0 + data->tile_size - 1 : data->rows - 1;
+    c0 = tx * data->tile_size;
+    c1 = (c0 + data->tile_size - 1 < data->cols - 1) ? c0 + data->tile_size - 1 : data->cols - 1;
+    changed = 0;
+    live = 0;
+    for (r = r0; r <= r1; ++r){
+        live += step_dense_row(data, r, c0, c1, &changed);
+    }
+    if (changed && data->track_tiles){
+        __atomic_store_n(&data->tile_changed[data->round & 1][tile], data->round, __ATOMIC_RELAXED);
+    }
+    data->tile_live[tile] = live;
+    data->tiles_computed++;
+    return live;
+}
+
+/* compute one round: the caller's own tiles first, then whatever it can
+ * steal from the others
+ * data: pointer to gol_data struct of the calling thread
+ * returns: the number of live cells in the tiles this thread computed
+ */
+long step_dense_steal(struct gol_data *data){
+    int tile, victim, i, busy;
+    long cell;
+
+    cell = 0;
+    while ((tile = pop_tile(&data->deques[data->thread_id])) != STEAL_EMPTY){
+        cell += run_tile(data, tile);
+    }
+    do{
+        busy = 0;
+        for (i = 1; i < data->num_threads; ++i){
+            victim = (data->thread_id + i) % data->num_threads;
+            tile = steal_tile(&data->deques[victim]);
+            while (tile >= 0){
+                cell += run_tile(data, tile);
+                data->tiles_stolen++;
+                tile = steal_tile(&data->deques[victim]);
+            }
+            if (tile == STEAL_ABORT){
+                busy = 1;
+            }
+        }
+    } while (busy);
+    return cell;
+}
@@ -0,0 +1,473 @@
+/*
+ * Row-span stencil kernels for the dense engine. The board holds one byte
+ * per cell (0 dead, 1 alive), so the eight neighbors of 16 or 32 cells can
+ * be summed with byte adds and the rule applied with compares, replacing
+ * the per-cell check_alive_cells/set_cell_cond calls. The board carries a
+ * one-cell halo border (see refresh_halo), so every row is computed with
+ * straight unit-stride loads and no wrap-around arithmetic. The AVX2 or
+ * SSE2 version is picked at startup from what the CPU supports.
+ *
+ * Every kernel is compiled once per rule kind: the common rules get their
+ * rule as a few compares folded into the loop, any other rule goes through
+ * the table kernels (a table lookup per cell, or pshufb with AVX2).
+ * Kernels of the same width pack a row into the bits of 64-bit words (for
+ * --record).
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "gol.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+/* computes out[start..end] of one row from the rows above, at and below it.
+ * Reads one cell past both ends of the span, which the halo provides.
+ * Sets *changed to 1 if any cell of the span differs from mid. table is
+ * the rule of the board, gol_rule.next (only the RULE_TABLE kernels read it).
+ * returns: the number of live cells written */
+typedef long (*span_fn)(const uint8_t (*table)[16], const uint8_t *up, const uint8_t *mid,
+                        const uint8_t *down, uint8_t *out, int start, int end,
+                        int *changed);
+/* packs whole 64-cell words of a row, of the same width as the span kernel */
+typedef void (*pack_fn)(const uint8_t *cells, uint64_t *bits, int w_first, int w_last);
+
+/* one instance of a span kernel for every rule kind, in RULE_* order */
+#define SPAN_KERNELS(name, attr) \
+    attr static long name##_table(const uint8_t (*table)[16], const uint8_t *up, const uint8_t *mid, \
+        const uint8_t *down, uint8_t *out, int start, int end, int *changed){ \
+        return name(RULE_TABLE, table, up, mid, down, out, start, end, changed); } \
+    attr static long name##_life(const uint8_t (*table)[16], const uint8_t *up, const uint8_t *mid, \
+        const uint8_t *down, uint8_t *out, int start, int end, int *changed){ \
+        return name(RULE_LIFE, table, up, mid, down, out, start, end, changed); } \
+    attr static long name##_highlife(const uint8_t (*table)[16], const uint8_t *up, const uint8_t *mid, \
+        const uint8_t *down, uint8_t *out, int start, int end, int *changed){ \
+        return name(RULE_HIGHLIFE, table, up, mid, down, out, start, end, changed); } \
+    attr static long name##_daynight(const uint8_t (*table)[16], const uint8_t *up, const uint8_t *mid, \
+        const uint8_t *down, uint8_t *out, int start, int end, int *changed){ \
+        return name(RULE_DAYNIGHT, table, up, mid, down, out, start, end, changed); } \
+    attr static long name##_seeds(const uint8_t (*table)[16], const uint8_t *up, const uint8_t *mid, \
+        const uint8_t *down, uint8_t *out, int start, int end, int *changed){ \
+        return name(RULE_SEEDS, table, up, mid, down, out, start, end, changed); } \
+    static const span_fn name##_kernels[RULE_KINDS] = { \
+        name##_table, name##_life, name##_highlife, name##_daynight, name##_seeds};
+
+/* the next state of one cell (kind is a constant in every instance) */
+static ALWAYS_INLINE int next_scalar(int kind, const uint8_t (*table)[16], int sum, int alive){
+    switch (kind){
+    case RULE_LIFE:
+        return (sum == 3) | (alive & (sum == 2));
+    case RULE_HIGHLIFE:
+        return (sum == 3) | (alive & (sum == 2)) | ((alive ^ 1) & (sum == 6));
+    case RULE_DAYNIGHT:
+        return (sum == 3) | (sum >= 6) | (alive & (sum == 4));
+    case RULE_SEEDS:
+        return (alive ^ 1) & (sum == 2);
+    default:
+        return table[alive][sum];
+    }
+}
+
+/* the scalar kernel, also used for the tails the vector kernels leave over */
+static ALWAYS_INLINE long span_scalar(int kind, const uint8_t (*table)[16], const uint8_t *up,
+                                      const uint8_t *mid, const uint8_t *down, uint8_t *out,
+                                      int start, int end, int *changed){
+    int c, sum, next, live, diff;
+    live = 0;
+    diff = 0;
+    for (c = start; c <= end; ++c){
+        sum = up[c - 1] + up[c] + up[c + 1] + mid[c - 1] + mid[c + 1]
+            + down[c - 1] + down[c] + down[c + 1];
+        next = next_scalar(kind, table, sum, mid[c]);
+        out[c] = next;
+        live += next;
+        diff |= next ^ mid[c];
+    }
+    *changed |= diff;
+    return live;
+}
+SPAN_KERNELS(span_scalar, )
+
+/* pack whole words of cells, bit 0 of each byte: the low bits of 8 bytes
+ * gathered into one byte with a multiply */
+static void pack_scalar(const uint8_t *cells, uint64_t *bits, int w_first, int w_last){
+    uint64_t word, eight;
+    int w, i;
+
+    for (w = w_first; w <= w_last; ++w){
+        word = 0;
+        for (i = 0; i < 8; ++i){
+            memcpy(&eight, cells + 64 * w + 8 * i, sizeof(eight));
+            word |= (((eight & 0x0101010101010101ULL) * 0x0102040810204080ULL) >> 56) << (8 * i);
+        }
+        bits[w] = word;
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+/* the next state of 16 cells as 0xff (alive) or 0: sum holds the live
+ * neighbors, alive is 0xff where the cell is alive */
+static ALWAYS_INLINE __m128i next_sse2(int kind, const uint8_t (*table)[16], __m128i sum, __m128i alive){
+    __m128i next, birth, survive;
+    int n;
+
+    switch (kind){
+    case RULE_LIFE:
+        return _mm_or_si128(_mm_cmpeq_epi8(sum, _mm_set1_epi8(3)),
+                            _mm_and_si128(_mm_cmpeq_epi8(sum, _mm_set1_epi8(2)), alive));
+    case RULE_HIGHLIFE:
+        return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(sum, _mm_set1_epi8(3)),
+                                         _mm_and_si128(_mm_cmpeq_epi8(sum, _mm_set1_epi8(2)), alive)),
+                            _mm_andnot_si128(alive, _mm_cmpeq_epi8(sum, _mm_set1_epi8(6))));
+    case RULE_DAYNIGHT:
+        return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(sum, _mm_set1_epi8(3)),
+                                         _mm_cmpgt_epi8(sum, _mm_set1_epi8(5))),
+                            _mm_and_si128(_mm_cmpeq_epi8(sum, _mm_set1_epi8(4)), alive));
+    case RULE_SEEDS:
+        return _mm_andnot_si128(alive, _mm_cmpeq_epi8(sum, _mm_set1_epi8(2)));
+    default:
+        /* no byte shuffle in SSE2: compare against every count the rule has */
+        next = _mm_setzero_si128();
+        for (n = 0; n <= 8; ++n){
+            birth = _mm_set1_epi8(-(char)table[0][n]);
+            survive = _mm_set1_epi8(-(char)table[1][n]);
+            next = _mm_or_si128(next, _mm_and_si128(_mm_cmpeq_epi8(sum, _mm_set1_epi8(n)),
+                                                    _mm_or_si128(_mm_and_si128(alive, survive),
+                                                                 _mm_andnot_si128(alive, birth))));
+        }
+        return next;
+    }
+}
+
+/* 16 cells per step: sum the eight neighbor vectors bytewise, apply the
+ * rule with compares and count the live cells with psadbw against zero. */
+static ALWAYS_INLINE long span_sse2(int kind, const uint8_t (*table)[16], const uint8_t *up,
+                                    const uint8_t *mid, const uint8_t *down, uint8_t *out,
+                                    int start, int end, int *changed){
+    __m128i one = _mm_set1_epi8(1);
+    __m128i counts = _mm_setzero_si128();
+    __m128i diff = _mm_setzero_si128();
+    __m128i sum, next, alive;
+    int c, live;
+
+    for (c = start; c + 15 <= end; c += 16){
+        sum = _mm_add_epi8(_mm_loadu_si128((const __m128i *)(up + c - 1)),
+                           _mm_loadu_si128((const __m128i *)(up + c)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(up + c + 1)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(mid + c - 1)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(mid + c + 1)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(down + c - 1)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(down + c)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(down + c + 1)));
+        alive = _mm_loadu_si128((const __m128i *)(mid + c));
+        next = next_sse2(kind, table, sum, _mm_cmpeq_epi8(alive, one));
+        next = _mm_and_si128(next, one);
+        _mm_storeu_si128((__m128i *)(out + c), next);
+        counts = _mm_add_epi64(counts, _mm_sad_epu8(next, _mm_setzero_si128()));
+        diff = _mm_or_si128(diff, _mm_xor_si128(next, alive));
+    }
+    live = (int)(_mm_cvtsi128_si64(counts) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(counts, counts)));
+    *changed |= (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff);
+    return live + span_scalar(kind, table, up, mid, down, out, c, end, changed);
+}
+SPAN_KERNELS(span_sse2, )
+
+/* the same 16 cells at a time: bit 0 of each byte shifted up to bit 7,
+ * where movemask takes it */
+static void pack_sse2(const uint8_t *cells, uint64_t *bits, int w_first, int w_last){
+    uint64_t word;
+    int w, i;
+
+    for (w = w_first; w <= w_last; ++w){
+        word = 0;
+        for (i = 0; i < 4; ++i){
+            word |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_slli_epi16(
+                _mm_loadu_si128((const __m128i *)(cells + 64 * w + 16 * i)), 7)) << (16 * i);
+        }
+        bits[w] = word;
+    }
+}
+
+/* the same for 32 cells; the table rule is two pshufb lookups of the
+ * birth and survival halves of the table, one picked by the cell state */
+__attribute__((target("avx2")))
+static ALWAYS_INLINE __m256i next_avx2(int kind, const uint8_t (*table)[16], __m256i sum, __m256i alive){
+    switch (kind){
+    case RULE_LIFE:
+        return _mm256_or_si256(_mm256_cmpeq_epi8(sum, _mm256_set1_epi8(3)),
+                               _mm256_and_si256(_mm256_cmpeq_epi8(sum, _mm256_set1_epi8(2)), alive));
+    case RULE_HIGHLIFE:
+        return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(sum, _mm256_set1_epi8(3)),
+                                               _mm256_and_si256(_mm256_cmpeq_epi8(sum, _mm256_set1_epi8(2)), alive)),
+                               _mm256_andnot_si256(alive, _mm256_cmpeq_epi8(sum, _mm256_set1_epi8(6))));
+    case RULE_DAYNIGHT:
+        return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(sum, _mm256_set1_epi8(3)),
+                                               _mm256_cmpgt_epi8(sum, _mm256_set1_epi8(5))),
+                               _mm256_and_si256(_mm256_cmpeq_epi8(sum, _mm256_set1_epi8(4)), alive));
+    case RULE_SEEDS:
+        return _mm256_andnot_si256(alive, _mm256_cmpeq_epi8(sum, _mm256_set1_epi8(2)));
+    default:
+        return _mm256_blendv_epi8(
+            _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table[0])), sum),
+            _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table[1])), sum),
+            alive);
+    }
+}
+
+__attribute__((target("avx2")))
+static ALWAYS_INLINE long span_avx2(int kind, const uint8_t (*table)[16], const uint8_t *up,
+                                    const uint8_t *mid, const uint8_t *down, uint8_t *out,
+                                    int start, int end, int *changed){
+    __m256i one = _mm256_set1_epi8(1);
+    __m256i counts = _mm256_setzero_si256();
+    __m256i diff = _mm256_setzero_si256();
+    __m256i sum, next, alive;
+    int c;
+    long long live;
+
+    for (c = start; c + 31 <= end; c += 32){
+        sum = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(up + c - 1)),
+                              _mm256_loadu_si256((const __m256i *)(up + c)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(up + c + 1)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(mid + c - 1)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(mid + c + 1)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(down + c - 1)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(down + c)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(down + c + 1)));
+        alive = _mm256_loadu_si256((const __m256i *)(mid + c));
+        next = next_avx2(kind, table, sum, _mm256_cmpeq_epi8(alive, one));
+        next = _mm256_and_si256(next, one);
+        _mm256_storeu_si256((__m256i *)(out + c), next);
+        counts = _mm256_add_epi64(counts, _mm256_sad_epu8(next, _mm256_setzero_si256()));
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(next, alive));
+    }
+    live = _mm256_extract_epi64(counts, 0) + _mm256_extract_epi64(counts, 1)
+         + _mm256_extract_epi64(counts, 2) + _mm256_extract_epi64(counts, 3);
+    *changed |= !_mm256_testz_si256(diff, diff);
+    return (int)live + span_scalar(kind, table, up, mid, down, out, c, end, changed);
+}
+SPAN_KERNELS(span_avx2, __attribute__((target("avx2"))))
+
+__attribute__((target("avx2")))
+static void pack_avx2(const uint8_t *cells, uint64_t *bits, int w_first, int w_last){
+    uint32_t lo, hi;
+    int w;
+
+    for (w = w_first; w <= w_last; ++w){
+        lo = _mm256_movemask_epi8(_mm256_slli_epi16(
+            _mm256_loadu_si256((const __m256i *)(cells + 64 * w)), 7));
+        hi = _mm256_movemask_epi8(_mm256_slli_epi16(
+            _mm256_loadu_si256((const __m256i *)(cells + 64 * w + 32)), 7));
+        bits[w] = lo | ((uint64_t)hi << 32);
+    }
+}
+#endif
+
+/* the kernels of every width, in KERNEL_* order (only the scalar ones
+ * off x86) */
+static const span_fn *const span_families[KERNELS] = {
+    span_scalar_kernels,
+#ifdef HAVE_X86_SIMD
+    span_sse2_kernels, span_avx2_kernels
+#endif
+};
+static const pack_fn pack_families[KERNELS] = {
+    pack_scalar,
+#ifdef HAVE_X86_SIMD
+    pack_sse2, pack_avx2
+#endif
+};
+static const char *const kernel_names[KERNELS] = { "scalar", "sse2", "avx2" };
+
+/* pick the row-span kernels of a board, before any of its threads start
+ * (the rule kind picks the instance at every call)
+ * data: pointer to gol_data struct
+ * name: "avx2", "sse2" or "scalar" to force a kernel, NULL to use the
+ *       widest one the CPU supports
+ * returns: 0 on success, 1 if the requested kernel is not available
+ */
+int init_stencil(struct gol_data *data, const char *name){
+    long l2 = -1;
+
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    if (l2 <= 0){
+        l2 = 256 * 1024;
+    }
+    /* a strip of world and next_world rows, with room to spare: 1/16 of
+     * L2 per row, whole cache lines */
+    data->strip_cols = (int)(l2 / 16) & ~63;
+    if (data->strip_cols < 1024){
+        data->strip_cols = 1024;
+    }
+    data->kernel = KERNEL_SCALAR;
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (name == NULL || strcmp(name, "avx2") == 0){
+        if (__builtin_cpu_supports("avx2")){
+            data->kernel = KERNEL_AVX2;
+            return 0;
+        }
+        if (name != NULL){
+            return 1;
+        }
+    }
+    if (name == NULL || strcmp(name, "sse2") == 0){
+        data->kernel = KERNEL_SSE2;
+        return 0;
+    }
+#endif
+    if (name == NULL || strcmp(name, "scalar") == 0){
+        return 0;
+    }
+    return 1;
+}
+
+/* the name of the kernel init_stencil picked for a board */
+const char *stencil_name(struct gol_data *data){
+    return kernel_names[data->kernel];
+}
+
+/* compute one row of next_world from world for the columns col_start..col_end
+ * data: pointer to gol_data struct
+ * row: the row to compute
+ * col_start: first column of the span
+ * col_end: last column of the span
+ * changed: set to 1 if any cell of the span changed state (left alone otherwise)
+ * returns: the number of live cells in the computed span
+ */
+long step_dense_row(struct gol_data *data, int row, int col_start, int col_end,
+                    int *changed){
+    size_t mid;
+
+    if (col_start > col_end){
+        return 0;
+    }
+    mid = dense_index(data, row, 0);
+    return span_families[data->kernel][data->rule.kind](
+        (const uint8_t (*)[16])data->rule.next, data->world + mid - data->stride, data->world + mid,
+        data->world + mid + data->stride, data->next_world + mid, col_start, col_end, changed);
+}
+
+/* compute the thread's block of next_world from world, strip by strip:
+ * each strip of columns is computed down all the rows of the block, so
+ * the rows above and below a row are still in L2 when it is computed
+ * (a row of a wide board would not be). Strips start on cache lines.
+ * data: pointer to gol_data struct
+ * returns: the number of live cells in the block
+ */
+long step_dense_block(struct gol_data *data){
+    int row, start, end, changed = 0;
+    long live = 0;
+
+    for (start = data->thread_col_start; start <= data->thread_col_end; start = end + 1){
+        end = ((start + 1 + data->strip_cols) & ~63) - 2; // the next strip starts at byte 64k
+        if (end > data->thread_col_end){
+            end = data->thread_col_end;
+        }
+        for (row = data->thread_row_start; row <= data->thread_row_end; ++row){
+            live += step_dense_row(data, row, start, end, &changed);
+        }
+    }
+    return live;
+}
+
+/* compute one whole row of a board from explicit row pointers, for
+ * buffers other than world/next_world (each row needs its two halo cells)
+ * data: pointer to gol_data struct of the board
+ * up, mid, down: column 0 of the rows above, at and below the row
+ * out: column 0 of the row to write
+ * returns: the number of live cells written
+ */
+long step_span(struct gol_data *data, const uint8_t *up, const uint8_t *mid,
+               const uint8_t *down, uint8_t *out){
+    int changed = 0;
+    return span_families[data->kernel][data->rule.kind](
+        (const uint8_t (*)[16])data->rule.next, up, mid, down, out, 0, data->cols - 1, &changed);
+}
+
+/* pack bit 0 of the cells of a row (the alive bit, also of the delta
+ * engine's bytes) into 64-bit words, bit i of word w cell 64 * w + i
+ * data: pointer to gol_data struct of the board (the last word of a row
+ *       may be short)
+ * cells: column 0 of the row
+ * bits: word 0 of the packed row
+ * w_first, w_last: the words to write
+ * returns: none
+ */
+void pack_dense_row(struct gol_data *data, const uint8_t *cells, uint64_t *bits,
+                    int w_first, int w_last){
+    uint64_t word;
+    int c, cols = data->cols;
+
+    if (w_first <= w_last && w_last == cols / 64){ // the short last word of a row
+        word = 0;
+        for (c = 64 * w_last; c < cols; ++c){
+            word |= (uint64_t)(cells[c] & 1) << (c % 64);
+        }
+        bits[w_last--] = word;
+    }
+    if (w_first <= w_last){
+        pack_families[data->kernel](cells, bits, w_first, w_last);
+    }
+}
+
+/* copy the cells of one owned rectangle of the board into the halo around
+ * the board, so the rows and columns just outside the board hold the
+ * opposite edges. Each thread calls this on its own rectangle; every halo
+ * cell is written by the thread owning the cell it copies, so the threads
+ * never write the same byte. With BOUNDARY_DEAD the halo stays all dead.
+ * data: pointer to gol_data struct
+ * row_start, row_end: the rows owned by the caller
+ * col_start, col_end: the columns owned by the caller
+ * returns: none
+ */
+void refresh_halo(struct gol_data *data, int row_start, int row_end,
+                  int col_start, int col_end){
+    uint8_t *world = data->world;
+    int rows = data->rows;
+    int cols = data->cols;
+    int r;
+
+    if (data->boundary == BOUNDARY_DEAD || row_start > row_end || col_start > col_end){
+        return;
+    }
+    /* halo rows above and below the board */
+    if (row_start == 0){
+        memcpy(world + dense_index(data, rows, col_start),
+               world + dense_index(data, 0, col_start), col_end - col_start + 1);
+    }
+    if (row_end == rows - 1){
+        memcpy(world + dense_index(data, -1, col_start),
+               world + dense_index(data, rows - 1, col_start), col_end - col_start + 1);
+    }
+    /* halo columns left and right of the board */
+    if (col_start == 0){
+        for (r = row_start; r <= row_end; ++r){
+            world[dense_index(data, r, cols)] = world[dense_index(data, r, 0)];
+        }
+    }
+    if (col_end == cols - 1){
+        for (r = row_start; r <= row_end; ++r){
+            world[dense_index(data, r, -1)] = world[dense_index(data, r, cols - 1)];
+        }
+    }
+    /* the four corners, each from the diagonally opposite cell */
+    if (row_start == 0 && col_start == 0){
+        world[dense_index(data, rows, cols)] = world[dense_index(data, 0, 0)];
+    }
+    if (row_start == 0 && col_end == cols - 1){
+        world[dense_index(data, rows, -1)] = world[dense_index(data, 0, cols - 1)];
+    }
+    if (row_end == rows - 1 && col_start == 0){
+        world[dense_index(data, -1, cols)] = world[dense_index(data, rows - 1, 0)];
+    }
+    if (row_end == rows - 1 && col_end == cols - 1){
+        world[dense_index(data, -1, -1)] = world[dense_index(data, rows - 1, cols - 1)];
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * Temporal blocking for the dense engine (--temporal-depth k). Instead of
+ * one round per pass over the board, each thread advances its band of rows
+ * k rounds before meeting the others at the barriers, so a block of k
+ * rounds costs two barrier waits and one read of world plus one write of
+ * next_world.
+ *
+ * To compute its band k rounds ahead without hearing from its neighbors,
+ * a thread reads k extra rows of world above and below the band and
+ * recomputes the shrinking overlap itself. The rounds are swept as a
+ * wavefront down the band: every time one more row of world is read, each
+ * intermediate round computes the row it now has all three inputs for.
+ * An intermediate round only ever needs the last three rows it produced,
+ * so they live in a small per-thread ring of 3 rows per round that stays
+ * in cache, and only round k is written to next_world.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "gol.h"
+
+/****************** Function Prototypes **********************/
+/* a row (column 0, halo at -1 and cols) of round level of the block */
+static uint8_t *wave_row(struct gol_data *data, int level, int steps, int row, int base);
+
+/* advance the calling thread's band of rows several rounds: reads world
+ * (and its k rows of overlap), writes only the last round to next_world.
+ * data: pointer to gol_data struct of the calling thread
+ * steps: the number of rounds to advance, at most temporal_depth
+ * returns: the number of live cells in the band after the last round
+ */
+long step_dense_temporal(struct gol_data *data, int steps){
+    int rs = data->thread_row_start;
+    int re = data->thread_row_end;
+    int base = rs - steps; // the first row of world read
+    int cols = data->cols;
+    int t, j, y;
+    long live, cell;
+    uint8_t *out;
+
+    if (rs > re){
+        return 0;
+    }
+    if (data->wave == NULL){
+        /* 3 rows for every intermediate round, plus an all dead row */
+        data->wave = calloc((size_t)(3 * (data->temporal_depth - 1) + 1) * data->stride,
+                            sizeof(uint8_t));
+        if (data->wave == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+    }
+
+    cell = 0;
+    for (t = base; t <= re + steps; ++t){
+        /* row t of world is in: every round j computes its row t - j */
+        for (j = 1; j <= steps; ++j){
+            y = t - j;
+            if (y < rs - steps + j || y > re + steps - j){
+                continue; // rows j or more away from the band are wrong by round j
+            }
+            if (data->boundary == BOUNDARY_DEAD && (y < 0 || y >= data->rows)){
+                continue; // outside the board, stays dead
+            }
+            out = wave_row(data, j, steps, y, base);
+            live = step_span(data, wave_row(data, j - 1, steps, y - 1, base),
+                             wave_row(data, j - 1, steps, y, base),
+                             wave_row(data, j - 1, steps, y + 1, base), out);
+            if (j == steps){
+                cell += live;
+            }
+            else if (data->boundary == BOUNDARY_TORUS){
+                out[-1] = out[cols - 1];
+                out[cols] = out[0];
+            }
+            else{
+                out[-1] = 0;
+                out[cols] = 0;
+            }
+        }
+    }
+    return cell;
+}
+
+/* rows of round 0 come from world and rows of the last round go to
+ * next_world; the rounds in between use ring slot (row - base) % 3. Rows
+ * off the board wrap around to the other edge, or are all dead. */
+static uint8_t *wave_row(struct gol_data *data, int level, int steps, int row, int base){
+    int off_board = (row < 0 || row >= data->rows);
+
+    if (off_board && data->boundary == BOUNDARY_DEAD){
+        return data->wave + (size_t)3 * (data->temporal_depth - 1) * data->stride + 1;
+    }
+    if (level == 0){
+        if (off_board){
+            row = ((row % data->rows) + data->rows) % data->rows;
+        }
+        return data->world + dense_index(data, row, 0);
+    }
+    if (level == steps){
+        return data->next_world + dense_index(data, row, 0);
+    }
+    return data->wave + (size_t)(3 * (level - 1) + (row - base) % 3) * data->stride + 1;
+}
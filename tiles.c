@@ -0,0 +1,131 @@
+/*
+ * Active-region tracking for the dense engine. The board is cut into
+ * square tiles of --active-tiles cells and every tile records the last
+ * round in which one of its cells changed. A tile whose own cells and
+ * whose eight neighbor tiles did not change last round cannot change this
+ * round either, so it is skipped: next_world still holds the previous
+ * round there, which is the same as this one.
+ *
+ * A thread's partition does not have to line up with the tiles; it
+ * computes the pieces where its rectangle and the tiles overlap and
+ * remembers the live count of each piece for the rounds it skips it.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "gol.h"
+
+/* allocate the per-tile change records shared by all threads
+ * data: pointer to gol_data struct with rows, cols, tile_size and round set
+ * returns: 0 on success, 1 on error
+ */
+int init_tiles(struct gol_data *data){
+    int i, n;
+
+    data->tile_rows = (data->rows + data->tile_size - 1) / data->tile_size;
+    data->tile_cols = (data->cols + data->tile_size - 1) / data->tile_size;
+    n = data->tile_rows * data->tile_cols;
+    for (i = 0; i < 2; ++i){
+        data->tile_changed[i] = malloc(sizeof(long) * n);
+        if (data->tile_changed[i] == NULL){
+            return 1;
+        }
+    }
+    for (i = 0; i < n; ++i){
+        // changed just before the first round, so that round computes every tile
+        data->tile_changed[0][i] = data->round - 1;
+        data->tile_changed[1][i] = data->round - 1;
+    }
+    return 0;
+}
+
+/* free the per-tile change records */
+void free_tiles(struct gol_data *data){
+    free(data->tile_changed[0]);
+    free(data->tile_changed[1]);
+}
+
+/* did tile ty, tx or one of its neighbors change last round?
+ * data: pointer to gol_data struct
+ * ty, tx: the tile
+ * returns: 1 if the tile has to be computed this round, 0 otherwise
+ */
+int tile_active(struct gol_data *data, int ty, int tx){
+    const long *last = data->tile_changed[(data->round - 1) & 1];
+    int dy, dx, y, x;
+
+    if (data->round == 0){
+        return 1;
+    }
+    for (dy = -1; dy <= 1; ++dy){
+        for (dx = -1; dx <= 1; ++dx){
+            y = ty + dy;
+            x = tx + dx;
+            if (data->boundary == BOUNDARY_TORUS){
+                y = (y + data->tile_rows) % data->tile_rows;
+                x = (x + data->tile_cols) % data->tile_cols;
+            }
+            else if (y < 0 || y >= data->tile_rows || x < 0 || x >= data->tile_cols){
+                continue;
+            }
+            if (__atomic_load_n(&last[y * data->tile_cols + x], __ATOMIC_RELAXED) == data->round - 1){
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* compute one round of the caller's rectangle tile by tile, skipping the
+ * tiles that cannot change
+ * data: pointer to gol_data struct of the calling thread
+ * returns: the number of live cells in the rectangle after this round
+ */
+long step_dense_tiles(struct gol_data *data){
+    int ty, tx, r, r0, r1, c0, c1, piece, changed;
+    long live, cell;
+    int size = data->tile_size;
+    long *now = data->tile_changed[data->round & 1];
+
+    if (data->thread_row_start > data->thread_row_end || data->thread_col_start > data->thread_col_end){
+        return 0;
+    }
+    if (data->piece_live == NULL){
+        /* one slot per tile the rectangle overlaps */
+        data->piece_live = calloc((size_t)(data->thread_row_end / size - data->thread_row_start / size + 1)
+                                  * (data->thread_col_end / size - data->thread_col_start / size + 1),
+                                  sizeof(long));
+        if (data->piece_live == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+    }
+
+    cell = 0;
+    piece = 0;
+    for (ty = data->thread_row_start / size; ty <= data->thread_row_end / size; ++ty){
+        r0 = (ty * size > data->thread_row_start) ? ty * size : data->thread_row_start;
+        r1 = (ty * size + size - 1 < data->thread_row_end) ? ty * size + size - 1 : data->thread_row_end;
+        for (tx = data->thread_col_start / size; tx <= data->thread_col_end / size; ++tx, ++piece){
+            if (!tile_active(data, ty, tx)){
+                data->tiles_skipped++;
+                cell += data->piece_live[piece];
+                continue;
+            }
+            c0 = (tx * size > data->thread_col_start) ? tx * size : data->thread_col_start;
+            c1 = (tx * size + size - 1 < data->thread_col_end) ? tx * size + size - 1 : data->thread_col_end;
+            changed = 0;
+            live = 0;
+            for (r = r0; r <= r1; ++r){
+                live += step_dense_row(data, r, c0, c1, &changed);
+            }
+            if (changed){
+                __atomic_store_n(&now[ty * data->tile_cols + tx], data->round, __ATOMIC_RELAXED);
+            }
+            data->piece_live[piece] = live;
+            data->tiles_computed++;
+            cell += live;
+        }
+    }
+    return cell;
+}
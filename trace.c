@@ -0,0 +1,245 @@
+/*
+ * Per-round instrumentation of the game loops (built with make TRACE=1,
+ * turned on with --trace FILE). The loops mark the end of every phase of
+ * a round with TRACE_MARK: the time and the phase go into the thread's
+ * own ring of TRACE_EVENTS events, allocated and touched before the first
+ * round, so a mark is a clock read and three stores. A phase lasts from
+ * the mark before it to its own; a TRACE_START mark (the start of a
+ * batch) only sets the time the next phase starts at.
+ *
+ * After the run write_trace turns the rings into Chrome trace events (one
+ * row per worker, open the file in chrome://tracing or Perfetto) and
+ * prints how long each thread spent in each phase, and how far apart the
+ * threads' compute times were (the load imbalance the barriers wait out).
+ * Without GOL_TRACE the marks compile to nothing and --trace is an error.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "gol.h"
+
+static const char *phase_names[TRACE_PHASES] = {
+    "start", "compute", "barrier wait", "serial (thread 0)", "halo",
+    "release wait", "copy"
+};
+
+/****************** Function Prototypes **********************/
+/* the first event of a ring still held, and one past the last */
+static void ring_span(const struct trace_ring *ring, unsigned long *first, unsigned long *end);
+/* print the phase totals and the load imbalance */
+static void print_summary(struct gol_data *data, double phase_ms[][TRACE_PHASES]);
+
+/* allocate one ring per thread for --trace and touch its pages, so the
+ * rounds never fault on them
+ * data: pointer to gol_data struct, with the thread configuration set
+ * returns: 0 on success, 1 on error
+ */
+int init_trace(struct gol_data *data){
+    int j;
+
+    data->trace = calloc(data->num_threads, sizeof(struct trace_ring));
+    if (data->trace == NULL){
+        printf("Error: malloc failed\n");
+        return 1;
+    }
+    for (j = 0; j < data->num_threads; ++j){
+        data->trace[j].events = malloc(sizeof(struct trace_event) * TRACE_EVENTS);
+        if (data->trace[j].events == NULL){
+            printf("Error: malloc failed\n");
+            free_trace(data);
+            return 1;
+        }
+        memset(data->trace[j].events, 0, sizeof(struct trace_event) * TRACE_EVENTS);
+    }
+    return 0;
+}
+
+/* forget the events recorded so far (a new board was loaded)
+ * data: pointer to gol_data struct
+ * returns: none
+ */
+void clear_trace(struct gol_data *data){
+    int j;
+
+    for (j = 0; data->trace != NULL && j < data->num_threads; ++j){
+        data->trace[j].next = 0;
+    }
+}
+
+/* free the rings
+ * data: pointer to gol_data struct
+ * returns: none
+ */
+void free_trace(struct gol_data *data){
+    int j;
+
+    if (data->trace == NULL){
+        return;
+    }
+    for (j = 0; j < data->num_threads; ++j){
+        free(data->trace[j].events);
+    }
+    free(data->trace);
+    data->trace = NULL;
+}
+
+/* write the recorded rounds to the --trace file as Chrome trace events
+ * and (verbose) print the time of each phase by thread and the load
+ * imbalance
+ * sim: the simulation, no rounds running
+ * verbose: 1 to print the summary
+ * returns: 0 on success, 1 on error
+ */
+int write_trace(struct gol_sim *sim, int verbose){
+    struct gol_data *data = &sim->data;
+    double (*phase_ms)[TRACE_PHASES];
+    const struct trace_event *event, *prev;
+    unsigned long first, end, i;
+    long long t0 = -1;
+    FILE *outfile;
+    int j, comma = 0;
+
+    if (data->trace == NULL){
+        return 0;
+    }
+    for (j = 0; j < data->num_threads; ++j){ // the time of the earliest event
+        ring_span(&data->trace[j], &first, &end);
+        if (first < end){
+            event = &data->trace[j].events[first & (TRACE_EVENTS - 1)];
+            if (t0 < 0 || event->ns < t0){
+                t0 = event->ns;
+            }
+        }
+    }
+    phase_ms = calloc(data->num_threads, sizeof(*phase_ms));
+    outfile = fopen(data->trace_file, "w");
+    if (phase_ms == NULL || outfile == NULL){
+        free(phase_ms);
+        if (outfile != NULL){
+            fclose(outfile);
+        }
+        return 1;
+    }
+
+    fprintf(outfile, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    for (j = 0; j < data->num_threads; ++j){
+        fprintf(outfile, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                "\"args\": {\"name\": \"worker %d\"}}", comma ? ",\n" : "", j, j);
+        comma = 1;
+        ring_span(&data->trace[j], &first, &end);
+        prev = NULL;
+        for (i = first; i < end; ++i){
+            event = &data->trace[j].events[i & (TRACE_EVENTS - 1)];
+            if (prev != NULL && event->phase != TRACE_START){
+                phase_ms[j][event->phase] += (event->ns - prev->ns) / 1e6;
+                fprintf(outfile, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                        "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"round\": %ld}}",
+                        phase_names[event->phase], j, (prev->ns - t0) / 1e3,
+                        (event->ns - prev->ns) / 1e3, event->round);
+            }
+            prev = event;
+        }
+    }
+    fprintf(outfile, "\n]}\n");
+    if (fclose(outfile) != 0){
+        free(phase_ms);
+        return 1;
+    }
+    if (verbose){
+        print_summary(data, phase_ms);
+    }
+    free(phase_ms);
+    return 0;
+}
+
+static void ring_span(const struct trace_ring *ring, unsigned long *first, unsigned long *end){
+    *end = ring->next;
+    *first = (ring->next > TRACE_EVENTS) ? ring->next - TRACE_EVENTS : 0;
+}
+
+static void print_summary(struct gol_data *data, double phase_ms[][TRACE_PHASES]){
+    const struct trace_event *event, *prev;
+    unsigned long first, end, i;
+    double *compute, total, mean, max, sum_ratio = 0, worst = 0, wait = 0, all = 0;
+    long round_lo = -1, round_hi = -1, worst_round = 0;
+    int j, p, r, n, rounds, measured = 0;
+
+    /* the rounds every ring still holds the compute phase of */
+    for (j = 0; j < data->num_threads; ++j){
+        ring_span(&data->trace[j], &first, &end);
+        for (i = first; i < end; ++i){
+            event = &data->trace[j].events[i & (TRACE_EVENTS - 1)];
+            if (round_lo < 0 || event->round < round_lo){
+                round_lo = event->round;
+            }
+            if (event->round > round_hi){
+                round_hi = event->round;
+            }
+        }
+    }
+    if (round_lo < 0){
+        printf("Trace: no rounds recorded\n");
+        return;
+    }
+    rounds = round_hi - round_lo + 1;
+    compute = calloc((size_t)rounds * data->num_threads, sizeof(double));
+    if (compute == NULL){
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    for (j = 0; j < data->num_threads; ++j){
+        ring_span(&data->trace[j], &first, &end);
+        prev = NULL;
+        for (i = first; i < end; ++i){
+            event = &data->trace[j].events[i & (TRACE_EVENTS - 1)];
+            if (prev != NULL && event->phase == TRACE_COMPUTE){
+                compute[(size_t)(event->round - round_lo) * data->num_threads + j] =
+                    (event->ns - prev->ns) / 1e6;
+            }
+            prev = event;
+        }
+    }
+
+    printf("Trace: %s (rounds %ld to %ld)\n", data->trace_file, round_lo, round_hi);
+    printf("tid %12s %12s %12s %12s %12s %12s  (ms)\n", "compute", "barrier", "serial",
+           "halo", "release", "copy");
+    for (j = 0; j < data->num_threads; ++j){
+        printf("%3d", j);
+        for (p = TRACE_COMPUTE; p < TRACE_PHASES; ++p){
+            printf(" %12.3f", phase_ms[j][p]);
+            all += phase_ms[j][p];
+        }
+        printf("\n");
+        wait += phase_ms[j][TRACE_BARRIER] + phase_ms[j][TRACE_RELEASE];
+    }
+
+    /* per round: the slowest thread's compute time over the mean of the
+     * threads that computed it (hashlife runs on thread 0 alone) */
+    for (r = 0; r < rounds; ++r){
+        total = max = 0;
+        n = 0;
+        for (j = 0; j < data->num_threads; ++j){
+            total += compute[(size_t)r * data->num_threads + j];
+            n += (compute[(size_t)r * data->num_threads + j] > 0);
+            if (compute[(size_t)r * data->num_threads + j] > max){
+                max = compute[(size_t)r * data->num_threads + j];
+            }
+        }
+        if (total <= 0){
+            continue; // not a round of its own (inside a temporal block) or overwritten
+        }
+        mean = total / n;
+        sum_ratio += max / mean;
+        measured++;
+        if (max / mean > worst){
+            worst = max / mean;
+            worst_round = round_lo + r;
+        }
+    }
+    if (measured > 0){
+        printf("Load imbalance: slowest thread over the mean compute time %.2fx on average, "
+               "%.2fx at worst (round %ld)\n", sum_ratio / measured, worst, worst_round);
+    }
+    printf("Barrier wait: %.1f%% of the threads' time\n", (all > 0) ? 100.0 * wait / all : 0.0);
+    free(compute);
+}
@@ -0,0 +1,237 @@
+/*
+ * The ParaVis animation (output mode 2), decoupled from the rounds. The
+ * workers no longer draw: when the animation asks for a new round, every
+ * worker copies its part of the board it just computed into the back slot
+ * of a triple buffer (one byte per cell), and the last one done publishes
+ * the slot. A thread of its own, the only one registered with
+ * ParaVis, takes the latest published board at --fps frames a second,
+ * colors it and calls draw_ready. The rounds published in between are
+ * skipped (dropped), so a big run is watched at full speed.
+ *
+ * run_animation shows as many frames as it is told; the visi thread is
+ * told the number of rounds, shows at most one frame per round, and after
+ * the last round hands over the frames left without waiting.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "gol.h"
+#include "colors.h"
+
+#define VISI_FRESH (4) // latest holds a slot the visi thread has not taken
+
+struct gol_visi{
+    pthread_t thread;
+    uint8_t *slots[3];  // boards, cell r, c at r * cols + c
+    long slot_round[3]; // the round each slot holds
+    int back;           // the workers' slot (swapped by the last to copy)
+    int latest;         // the last published slot, | VISI_FRESH
+    int front;          // the visi thread's slot
+    int want;           // the visi thread wants a new round copied
+    int copying;        // the workers copy the round they just computed
+    long copy_round;
+    int copies_left;    // workers still copying, the last one publishes
+    long last_round;    // the round the run ends at
+    long frames;        // the frames run_animation shows
+    long shown;         // rounds drawn
+    long long interval; // ns between frames
+};
+
+/****************** Function Prototypes **********************/
+/* the visi thread */
+static void *visi_main(void *arg);
+/* make the back slot the latest */
+static void visi_publish(struct gol_visi *v);
+/* color the image buffer from a board, each part in its worker's color */
+static void update_colors(struct gol_sim *sim, const uint8_t *board);
+
+/* start the visi thread for the rounds of one run (the animation was set
+ * up with one ParaVis thread, handle and image_buff are in sim->data)
+ * sim: the simulation, with a board loaded and no rounds running
+ * frames: the frames run_animation is asked to show, the rounds of the run
+ * returns: 0 on success, 1 on error
+ */
+int start_visi(struct gol_sim *sim, long frames){
+    struct gol_data *data = &sim->data;
+    struct gol_visi *v;
+    int i;
+
+    v = calloc(1, sizeof(struct gol_visi));
+    if (v == NULL){
+        printf("Error: malloc failed\n");
+        return 1;
+    }
+    for (i = 0; i < 3; ++i){
+        v->slots[i] = calloc((size_t)data->rows * data->cols, sizeof(uint8_t));
+        if (v->slots[i] == NULL){
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+    }
+    v->back = 0;
+    v->latest = 1;
+    v->front = 2;
+    v->want = 1;
+    v->frames = frames;
+    v->last_round = data->round + frames;
+    v->interval = 1000000000LL / data->visi_fps;
+    sim->visi = v;
+    if (pthread_create(&v->thread, NULL, visi_main, sim) != 0){
+        printf("Error: failed to start the visi thread\n");
+        sim->visi = NULL;
+        for (i = 0; i < 3; ++i){
+            free(v->slots[i]);
+        }
+        free(v);
+        return 1;
+    }
+    return 0;
+}
+
+/* thread 0, between the barriers of a round: decide whether the workers
+ * copy this round (the visi thread asked for it, or it is the last one)
+ * data: thread 0's struct gol_data
+ * steps: the rounds the workers just advanced
+ * returns: none
+ */
+void visi_round(struct gol_data *data, int steps){
+    struct gol_visi *v = data->sim->visi;
+
+    if (v == NULL){
+        return;
+    }
+    if (__atomic_exchange_n(&v->want, 0, __ATOMIC_ACQ_REL) || data->round + steps >= v->last_round){
+        v->copying = 1;
+        v->copy_round = data->round + steps;
+        v->copies_left = data->num_threads;
+    }
+}
+
+/* every worker, after the second barrier of a round: copy its part of
+ * the board into the back slot if thread 0 said so. Nobody writes the
+ * current board during the next round, so it is read while the next
+ * round is computed. The last worker to finish publishes the slot; all
+ * of them are done before the next round's first barrier.
+ * data: the worker's struct gol_data
+ * returns: none
+ */
+void visi_copy(struct gol_data *data){
+    struct gol_visi *v = data->sim->visi;
+    uint8_t *slot;
+    int r, c;
+
+    if (v == NULL || !v->copying){
+        return;
+    }
+    slot = v->slots[v->back];
+    for (r = data->thread_row_start; r <= data->thread_row_end; ++r){
+        if (data->engine == ENGINE_DENSE){
+            memcpy(slot + (size_t)r * data->cols + data->thread_col_start,
+                   data->world + dense_index(data, r, data->thread_col_start),
+                   data->thread_col_end - data->thread_col_start + 1);
+            continue;
+        }
+        for (c = data->thread_col_start; c <= data->thread_col_end; ++c){
+            slot[(size_t)r * data->cols + c] = gol_cell(data, r, c);
+        }
+    }
+    if (__atomic_sub_fetch(&v->copies_left, 1, __ATOMIC_ACQ_REL) == 0){
+        visi_publish(v);
+    }
+}
+
+/* wait for the visi thread to show its frames and free it
+ * sim: the simulation, the rounds of the run done
+ * rounds: set to the rounds the run advanced
+ * dropped: set to the rounds that were never drawn
+ * returns: none
+ */
+void stop_visi(struct gol_sim *sim, long *rounds, long *dropped){
+    struct gol_visi *v = sim->visi;
+    int i;
+
+    if (v == NULL){
+        return;
+    }
+    pthread_join(v->thread, NULL);
+    *rounds = v->frames;
+    *dropped = v->frames - v->shown;
+    for (i = 0; i < 3; ++i){
+        free(v->slots[i]);
+    }
+    free(v);
+    sim->visi = NULL;
+}
+
+/* hand the copied round to the visi thread: the back slot becomes the
+ * latest, the slot it replaces the new back one */
+static void visi_publish(struct gol_visi *v){
+    v->slot_round[v->back] = v->copy_round;
+    v->copying = 0;
+    v->back = __atomic_exchange_n(&v->latest, v->back | VISI_FRESH, __ATOMIC_ACQ_REL) & 3;
+}
+
+static void *visi_main(void *arg){
+    struct gol_sim *sim = arg;
+    struct gol_visi *v = sim->visi;
+    struct timespec next, now;
+    long frame, round = -1;
+    int latest;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (frame = 0; frame < v->frames; ++frame){
+        /* the next round not shown yet, at most one per interval */
+        while (round < v->last_round){
+            next.tv_nsec += v->interval;
+            while (next.tv_nsec >= 1000000000L){
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (now.tv_sec > next.tv_sec + 1){
+                next = now; // fell behind (a slow frame): no burst to catch up
+            }
+            latest = __atomic_load_n(&v->latest, __ATOMIC_ACQUIRE);
+            if (latest & VISI_FRESH){
+                v->front = __atomic_exchange_n(&v->latest, v->front, __ATOMIC_ACQ_REL) & 3;
+                round = v->slot_round[v->front];
+                update_colors(sim, v->slots[v->front]);
+                v->shown++;
+                __atomic_store_n(&v->want, 1, __ATOMIC_RELEASE);
+                break;
+            }
+        }
+        draw_ready(sim->data.handle);
+    }
+    return NULL;
+}
+
+/* Describes how the pixels in the image buffer should be
+ * colored based on the data in the grid: live cells black, dead
+ * cells in the color of the worker owning them.
+ * sim: the simulation
+ * board: the board to show, one byte per cell
+ * returns: none
+ */
+static void update_colors(struct gol_sim *sim, const uint8_t *board){
+    struct gol_data *data;
+    color3 *buff = sim->data.image_buff;
+    int i, j, t, buff_i;
+
+    for (t = 0; t < sim->data.num_threads; ++t){
+        data = &sim->threads[t];
+        for (i = data->thread_row_start; i <= data->thread_row_end; ++i){
+            for (j = data->thread_col_start; j <= data->thread_col_end; ++j){
+                buff_i = (data->rows - (i + 1)) * data->cols + j;
+                if (board[(size_t)i * data->cols + j]){
+                    buff[buff_i] = c3_black;
+                }
+                else{
+                    buff[buff_i] = colors[t % 8];
+                }
+            }
+        }
+    }
+}